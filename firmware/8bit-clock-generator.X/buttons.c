@@ -9,91 +9,114 @@
 #include "buttons.h"
 #include "types.h"
 
+#if BUTTON_LONGPRESS_CNT > 15
+#error "BUTTON_LONGPRESS_CNT does not fit the 4 bit counter"
+#endif
+
+// held scans of every button as a vertical counter: bit n of countX is
+// bit X of the count of the button on RAn, all buttons count in parallel
+static uint8_t count0 = 0;
+static uint8_t count1 = 0;
+static uint8_t count2 = 0;
+static uint8_t count3 = 0;
+
+// buttons pressed by an edge since the last scan (their bits), and the
+// ones pressed or released before it (their bits >> LOCKED_SHIFT, below
+// RA3): their contacts may still bounce, the scans keep their state and
+// the edges skip them
+#define LOCKED_SHIFT            3
+#define _LOCKED_OUT()           ((uint8_t)(lockout | (lockout << LOCKED_SHIFT)) & BUTTONS_MASK)
+
+#if (BUTTONS_MASK & (BUTTONS_MASK >> LOCKED_SHIFT)) != 0
+#error "the locked buttons overlap the ones locking in one byte"
+#endif
+
+static uint8_t lockout = 0;
 
 buttons_state_t buttons = {
-    .buttonUp = {
-        .pressedCounter = 0,
-        .clicked = FALSE,
-        .pressed = FALSE,
-        .longPressed = FALSE,
-        .lastPinState = BUTTON_RELEASED
-    },
-    .buttonDown = {
-        .pressedCounter = 0,
-        .clicked = FALSE,
-        .pressed = FALSE,
-        .longPressed = FALSE,
-        .lastPinState = BUTTON_RELEASED
-    },
-    .buttonMode = {
-        .pressedCounter = 0,
-        .clicked = FALSE,
-        .pressed = FALSE,
-        .longPressed = FALSE,
-        .lastPinState = BUTTON_RELEASED
-    }
+    .pressed = 0,
+    .clicked = 0,
+    .longPressed = 0
 };
 
+// buttons whose count equals the constant n
+#define _COUNT_BIT(counter, n, bit)     ((((n) >> (bit)) & 1) ? (counter) : (uint8_t)~(counter))
+#define _COUNT_EQUALS(n)                (_COUNT_BIT(count0, n, 0) & _COUNT_BIT(count1, n, 1) \
+                                        & _COUNT_BIT(count2, n, 2) & _COUNT_BIT(count3, n, 3))
+
 
 /**
  * 
- * @param buttonState
- * @param pinHwState
+ * @return buttons_state_t *
  */
-static void _updateState(button_state_t * buttonState, uint8_t pinHwState)
+inline buttons_state_t * buttons_getState(void)
 {
-    // if button is pressed, it will read 0
-    if (pinHwState == BUTTON_PRESSED) {
-        if (buttonState->pressedCounter < BUTTON_LONGPRESS_CNT) {
-            buttonState->pressedCounter++;
-        }
-        if (buttonState->pressedCounter == BUTTON_PRESS_CNT) {
-            buttonState->pressed = TRUE;
-        }
-        if (buttonState->pressedCounter == BUTTON_LONGPRESS_CNT) {
-            buttonState->longPressed = TRUE;
-        }
-    } else {
-        if (buttonState->pressedCounter >= BUTTON_PRESS_CNT
-            && buttonState->pressedCounter < BUTTON_LONGPRESS_CNT
-        ) {
-            buttonState->clicked = TRUE;
-        }
-        
-        buttonState->pressedCounter = 0;
-    }
+    return &buttons;
 }
 
-
 /**
  * 
- * @return buttons_state_t *
+ * @return TRUE if the last scan saw all buttons released
  */
-inline buttons_state_t * buttons_getState(void)
+uint8_t buttons_areReleased(void)
 {
-    return &buttons;
+    return (count0 | count1 | count2 | count3 | lockout) == 0;
 }
 
 /**
- * 
- * @param name
- * @param state
+ * A TMR0 tick (~33ms) is longer than the contact bounce, so one sample per
+ * tick is the debounce. A button is pressed on the first scan it reads 0,
+ * long pressed on the BUTTON_LONGPRESS_CNT-th and clicked when released
+ * before that. A locked out button keeps its state.
+ */
+void buttons_scan(void)
+{
+    uint8_t held = count0 | count1 | count2 | count3;
+    uint8_t keep = _LOCKED_OUT();
+    uint8_t down = ((uint8_t)~PORTA & BUTTONS_MASK & (uint8_t)~keep)   // pressed buttons read 0
+        | (held & keep);
+    uint8_t longHeld = _COUNT_EQUALS(BUTTON_LONGPRESS_CNT);
+    uint8_t carry;
+
+    buttons.pressed = down & (uint8_t)~held;
+    buttons.clicked = held & (uint8_t)~down & (uint8_t)~longHeld;
+
+    // count up the held buttons, stop at BUTTON_LONGPRESS_CNT
+    carry = down & (uint8_t)~longHeld;
+    count0 ^= carry;
+    carry &= (uint8_t)~count0;
+    count1 ^= carry;
+    carry &= (uint8_t)~count1;
+    count2 ^= carry;
+    carry &= (uint8_t)~count2;
+    count3 ^= carry;
+
+    // released buttons start from 0
+    count0 &= down;
+    count1 &= down;
+    count2 &= down;
+    count3 &= down;
+
+    buttons.longPressed = _COUNT_EQUALS(BUTTON_LONGPRESS_CNT) & (uint8_t)~longHeld;
+
+    // the edges since the last scan and the buttons released now are
+    // locked out for the next full tick
+    lockout = (uint8_t)(((lockout & BUTTONS_MASK) | (held & (uint8_t)~down)) >> LOCKED_SHIFT);
+}
+
+/**
+ * The RA interrupt on change is already the debounce of the first edge -
+ * a contact that closes is a press, the lockout takes the bounce after it.
+ * Only the buttons down that are neither held nor locked out are pressed.
  */
-void buttons_updateButtonState(button_name_t name, uint8_t state)
+void buttons_edge(void)
 {
-    switch (name)
-    {
-        case BUTTON_UP:
-            _updateState(&buttons.buttonUp, state);
-            break;
-        case BUTTON_DOWN:
-            _updateState(&buttons.buttonDown, state);
-            break;
-        case BUTTON_MODE:
-            _updateState(&buttons.buttonMode, state);
-            break;
-        default:
-            // invalid name - skip
-            break;
-    }
+    uint8_t down = (uint8_t)~PORTA & BUTTONS_MASK
+        & (uint8_t)~(count0 | count1 | count2 | count3 | _LOCKED_OUT());
+
+    buttons.pressed = down;
+    buttons.clicked = 0;
+    buttons.longPressed = 0;
+    count0 |= down;             // count 1, the first held scan
+    lockout |= down;
 }
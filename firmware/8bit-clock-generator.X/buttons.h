@@ -12,55 +12,49 @@
 extern "C" {
 #endif
 
-#define BUTTON_UP_PIN           RA4
-#define BUTTON_DOWN_PIN         RA5
-#define BUTTON_MODE_PIN         RA3
+// all buttons are sampled with one PORTA read, a button is its PORTA bit
+#define BUTTON_UP               0b00010000      // RA4
+#define BUTTON_DOWN             0b00100000      // RA5
+#define BUTTON_MODE             0b00001000      // RA3
+#define BUTTONS_MASK            (BUTTON_UP | BUTTON_DOWN | BUTTON_MODE)
 
-
-#define BUTTON_PRESSED          0
-#define BUTTON_RELEASED         1
-#define BUTTON_PRESS_CNT        1
+// scans (TMR0 ticks) until a held button is long pressed, at most 15
 #define BUTTON_LONGPRESS_CNT    10
 
-// struct of a single button
-typedef struct {
-    uint8_t lastPinState:1;
-    uint8_t pressed:1;
-    uint8_t pressedCounter;
-    uint8_t longPressed:1;
-    uint8_t clicked:1;
-} button_state_t;
-
-
-// struct for all buttons
+// events of the last scan, one bit per button
 typedef struct {
-    button_state_t buttonUp;
-    button_state_t buttonDown;
-    button_state_t buttonMode;
+    uint8_t pressed;            // went down
+    uint8_t clicked;            // released before the long press
+    uint8_t longPressed;        // held for BUTTON_LONGPRESS_CNT scans
 } buttons_state_t;
 
 /**
- * 
+ * Sample and debounce all buttons, called once per TMR0 tick
  */
-typedef enum {
-    BUTTON_UP,
-    BUTTON_DOWN,
-    BUTTON_MODE
-} button_name_t;
+void buttons_scan(void);
 
 /**
- * 
- * @param name
- * @param state
+ * A button went down between two scans (RA interrupt on change): report
+ * it pressed right away, without waiting for the TMR0 tick. The edge is
+ * the first held scan of the button. Until the end of the next full tick
+ * the scans keep it held and further edges are ignored - the lockout
+ * that covers the contact bounce. A button released at a scan is locked
+ * out until the next one.
  */
-void buttons_updateButtonState(button_name_t name, uint8_t state);
+void buttons_edge(void);
 
 /**
- * 
+ * Events of the last buttons_scan(), valid until the next scan
  * @return 
  */
 inline buttons_state_t * buttons_getState(void);
 
+/**
+ * No button is held or locked out - nothing left to debounce
+ * @return 
+ */
+uint8_t buttons_areReleased(void);
+
 #ifdef	__cplusplus
 }
 #endif
@@ -0,0 +1,265 @@
+/**
+ * File:   calibration.c
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ */
+
+#include <xc.h>
+#include "types.h"
+#include "generator.h"
+#include "interrupts.h"
+#include "settings.h"
+#include "uart.h"
+#include "calibration.h"
+
+// TMR1 at 1:8 from Fosc/4, on
+#define CALIBRATION_T1CON           0b00110001
+// an interval off by more than 1/8 is not the reference
+#define CALIBRATION_ERROR_MAX       ((int16_t)(CALIBRATION_TICKS / 8))
+// nor is one at the best trim off its first interval by more than about
+// 2000 ppm - CALIBRATION_PERIODS_MAX of them still add up in 16 bits
+#define CALIBRATION_SPREAD_MAX      ((int16_t)(32767 / CALIBRATION_PERIODS_MAX))
+// OSCTUNE TUN<4:0>, two's complement
+#define TRIM_MIN                    (-16)
+#define TRIM_MAX                    15
+#define TRIM_MASK                   0x1F
+
+__near volatile uint8_t calibrationArmed = FALSE;
+// TMR1 at the last falling edge of RA1, RA1 level at the last change
+static volatile uint16_t capture;
+static uint8_t referenceLevel;
+
+static calibration_state_t calibrationState = CALIBRATION_IDLE;
+static int8_t trim = 0;
+// trim restored on a failure
+static int8_t startTrim;
+// trim with the smallest error so far and that error, TMR1 counts of one
+// interval off CALIBRATION_TICKS
+static int8_t bestTrim;
+static int16_t bestError;
+// trim step of the walk, 0 - nothing measured yet
+static int8_t direction;
+// FALSE - the final measurement at bestTrim
+static uint8_t walking;
+static uint8_t finalPeriods;
+// intervals left at this trim and their counts off the nominal so far -
+// at the best trim the counts off bestError, the result is kept in both
+static uint8_t periodsLeft;
+static int16_t errorSum;
+static uint16_t lastCapture;
+static uint8_t haveEdge;
+static uint8_t timeoutTicks;
+
+static void _setTrim(int8_t value);
+static void _measure(uint8_t periods);
+static void _finish(calibration_state_t state);
+static int16_t _magnitude(int16_t value);
+
+/**
+ * @param value
+ */
+static void _setTrim(int8_t value)
+{
+    trim = value;
+    OSCTUNE = (uint8_t)value & TRIM_MASK;
+}
+
+/**
+ * Measure from the edge just taken
+ * @param periods
+ */
+static void _measure(uint8_t periods)
+{
+    periodsLeft = periods;
+    errorSum = 0;
+}
+
+/**
+ * TMR1 is stopped unless the generator took it over
+ * @param state
+ */
+static void _finish(calibration_state_t state)
+{
+    calibrationArmed = FALSE;
+    if (generator_isIdle()) {
+        T1CON = 0;
+    }
+    calibrationState = state;
+}
+
+/**
+ * @param value
+ * @return int16_t
+ */
+static int16_t _magnitude(int16_t value)
+{
+    return value < 0 ? -value : value;
+}
+
+void calibration_init(void)
+{
+    _setTrim(settings_loadTrim());
+}
+
+/**
+ * TMR1 is not used in the idle manual mode, it runs free from here on
+ * @param periods
+ * @return uint8_t
+ */
+uint8_t calibration_start(uint8_t periods)
+{
+    if (!generator_isIdle() || calibrationState == CALIBRATION_RUNNING) {
+        return FALSE;
+    }
+    startTrim = trim;
+    bestTrim = trim;
+    direction = 0;
+    walking = TRUE;
+    finalPeriods = periods;
+    haveEdge = FALSE;
+    timeoutTicks = CALIBRATION_TIMEOUT_TICKS;
+    _measure(1);
+    T1CON = CALIBRATION_T1CON;
+    referenceLevel = PORTA & UART_RX_MASK;
+    calibrationState = CALIBRATION_RUNNING;
+    calibrationArmed = TRUE;
+    return TRUE;
+}
+
+/**
+ * TMR1 keeps running while its bytes are read - the high byte is read
+ * again until it held
+ */
+inline void calibration_edgeCallback(uint8_t port)
+{
+    uint8_t level = port & UART_RX_MASK;
+    uint8_t high;
+    uint8_t low;
+
+    if (referenceLevel && !level) {
+        do {
+            high = TMR1H;
+            low = TMR1L;
+        } while (high != TMR1H);
+        capture = ((uint16_t)high << 8) | low;
+        INTERRUPT_RAISE(EVENT_REFERENCE);
+    }
+    referenceLevel = level;
+}
+
+/**
+ * A trim is set at the edge that starts its interval, the few hundred us
+ * the main loop takes to get here are below one TMR1 count of error
+ * @return uint8_t
+ */
+uint8_t calibration_edge(void)
+{
+    uint16_t captured;
+    int16_t error;
+
+    if (calibrationState != CALIBRATION_RUNNING) {
+        return FALSE;
+    }
+    di();
+    captured = capture;
+    ei();
+    error = (int16_t)(uint16_t)(captured - lastCapture - (uint16_t)CALIBRATION_TICKS);
+    lastCapture = captured;
+    if (!haveEdge || error > CALIBRATION_ERROR_MAX || error < -CALIBRATION_ERROR_MAX) {
+        // the first edge, or the one before was not the reference
+        haveEdge = TRUE;
+        _measure(walking ? 1 : finalPeriods);
+        return FALSE;
+    }
+    if (!walking) {
+        // both within CALIBRATION_ERROR_MAX, the difference is taken unsigned
+        uint16_t spread = (uint16_t)error - (uint16_t)bestError;
+        if ((uint16_t)(spread + CALIBRATION_SPREAD_MAX) > 2 * CALIBRATION_SPREAD_MAX) {
+            _measure(finalPeriods);
+            return FALSE;
+        }
+        error = (int16_t)spread;
+    }
+    timeoutTicks = CALIBRATION_TIMEOUT_TICKS;
+    errorSum += error;
+    if (--periodsLeft) {
+        return FALSE;
+    }
+
+    if (!walking) {
+        settings_saveTrim(trim);
+        _finish(CALIBRATION_DONE);
+        return TRUE;
+    }
+
+    // walk on while the error shrinks, against its sign
+    if (direction == 0 || _magnitude(errorSum) < _magnitude(bestError)) {
+        int8_t next;
+
+        if (direction == 0) {
+            direction = errorSum > 0 ? -1 : 1;
+        }
+        bestTrim = trim;
+        bestError = errorSum;
+        next = trim + direction;
+        if (errorSum != 0 && next >= TRIM_MIN && next <= TRIM_MAX) {
+            _setTrim(next);
+            _measure(1);
+            return FALSE;
+        }
+    }
+    _setTrim(bestTrim);
+    walking = FALSE;
+    _measure(finalPeriods);
+    return FALSE;
+}
+
+/**
+ * TMR1 stopped or taken over, the mode changed or the reference is gone
+ * @return uint8_t
+ */
+uint8_t calibration_tick(void)
+{
+    if (calibrationState != CALIBRATION_RUNNING) {
+        return FALSE;
+    }
+    if (!generator_isIdle() || T1CON != CALIBRATION_T1CON || --timeoutTicks == 0) {
+        _setTrim(startTrim);
+        _finish(CALIBRATION_FAILED);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ *
+ * @return calibration_state_t
+ */
+calibration_state_t calibration_getState(void)
+{
+    return calibrationState;
+}
+
+/**
+ *
+ * @return int8_t
+ */
+int8_t calibration_getTrim(void)
+{
+    return trim;
+}
+
+/**
+ * Mean of the final intervals, from the sum of their counts off bestError
+ * @return int32_t
+ */
+int32_t calibration_getError(void)
+{
+    if (calibrationState != CALIBRATION_DONE) {
+        return 0;
+    }
+    int32_t counts = (int32_t)bestError * finalPeriods + errorSum;
+
+    return counts * (int32_t)(1000000UL / CALIBRATION_TICKS) / finalPeriods;
+}
@@ -0,0 +1,109 @@
+/*
+ * File:   calibration.h
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ *
+ * HFINTOSC calibration against a 1 Hz reference on RA1, the serial RX
+ * pin: one falling edge a second, for example an open collector GPS PPS
+ * output. The serial port is paused while the reference is measured.
+ *
+ * TMR1 counts Fosc/4 at 1:8 between the reference edges, 250000 counts a
+ * second at 8 MHz. Only the low 16 bits are captured - an interval is the
+ * count next to 250000 with those bits, which holds within +-12.5 %, the
+ * OSCTUNE range. A longer or shorter interval is not the reference (a
+ * serial frame, a glitch) and restarts the measurement at its edge.
+ *
+ * Starting from the current OSCTUNE, one interval is measured per trim
+ * step, walking against the error while it shrinks. The best trim is then
+ * measured over the requested number of intervals, the residual error in
+ * ppm is reported and the trim is saved to the data EEPROM for the next
+ * power-on. The steps of OSCTUNE are not exactly known, so they are
+ * measured rather than computed.
+ *
+ * It runs in the idle manual mode only, TMR1 is free there. A pulse, a
+ * mode change, an nHALT stop or no reference for CALIBRATION_TIMEOUT_TICKS
+ * fails it and restores the trim it started with.
+ */
+
+#ifndef CALIBRATION_H
+#define	CALIBRATION_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+// TMR1 counts in one reference interval at 8 MHz, 1:8
+#define CALIBRATION_TICKS           250000UL
+// intervals measured at the best trim, at most
+#define CALIBRATION_PERIODS_MAX     60
+// ~5 s of 32.768 ms button ticks without a reference interval, the first
+// edge included
+#define CALIBRATION_TIMEOUT_TICKS   153
+
+typedef enum {
+    CALIBRATION_IDLE = 0,       // no calibration since power-on
+    CALIBRATION_RUNNING,
+    CALIBRATION_DONE,
+    CALIBRATION_FAILED
+} calibration_state_t;
+
+// RA1 falling edges are captured - tested by every RA branch, __near
+extern __near volatile uint8_t calibrationArmed;
+
+/**
+ * Apply the trim saved by the last calibration, at power-on
+ */
+void calibration_init(void);
+
+/**
+ * Start measuring RA1, the serial port must be paused
+ * @param periods intervals measured at the best trim, 1 - CALIBRATION_PERIODS_MAX
+ * @return FALSE when the generator is not the idle manual mode
+ */
+uint8_t calibration_start(uint8_t periods);
+
+/**
+ * RA1 interrupt on change while armed, captures TMR1 at a falling edge,
+ * called from the ISR
+ * @param port PORTA read by the ISR
+ */
+inline void calibration_edgeCallback(uint8_t port);
+
+/**
+ * Take the captured reference edge, called from the main loop
+ * @return TRUE when the calibration ended at this edge
+ */
+uint8_t calibration_edge(void);
+
+/**
+ * Check the running calibration for a takeover or a lost reference,
+ * called at the TMR0 tick rate
+ * @return TRUE when the calibration ended at this tick
+ */
+uint8_t calibration_tick(void);
+
+/**
+ *
+ * @return calibration_state_t
+ */
+calibration_state_t calibration_getState(void);
+
+/**
+ * OSCTUNE in use, -16 - 15
+ * @return int8_t
+ */
+int8_t calibration_getTrim(void);
+
+/**
+ * Error of the clock after the last calibration that was done
+ * @return int32_t ppm, positive - the clock runs fast
+ */
+int32_t calibration_getError(void);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CALIBRATION_H */
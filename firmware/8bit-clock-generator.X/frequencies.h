@@ -0,0 +1,126 @@
+/*
+ * File:   frequencies.h
+ *
+ * Generated by tools/freqtable.c for FOSC 8000000 Hz, do not edit.
+ * Regenerate with "make frequencies".
+ *
+ * step          target Hz          actual Hz    error ppm   jitter ns  setup
+ * 10mHz             0.010           0.010000         0.00           0  TMR1 1:8, 62500 x 200
+ * 20mHz             0.020           0.020000         0.00           0  TMR1 1:8, 62500 x 100
+ * 50mHz             0.050           0.050000         0.00           0  TMR1 1:8, 62500 x 40
+ * 100mHz            0.100           0.100000         0.00           0  TMR1 1:8, 62500 x 20
+ * 200mHz            0.200           0.200000         0.00           0  TMR1 1:8, 62500 x 10
+ * 500mHz            0.500           0.500000         0.00           0  TMR1 1:8, 62500 x 4
+ * 1Hz               1.000           1.000000         0.00           0  TMR1 1:8, 62500 x 2
+ * 2Hz               2.000           2.000000         0.00           0  TMR1 1:8, 62500 x 1
+ * 5Hz               5.000           5.000000         0.00           0  TMR1 1:4, 50000 x 1
+ * 10Hz             10.000          10.000000         0.00           0  TMR1 1:2, 50000 x 1
+ * 20Hz             20.000          20.000000         0.00           0  TMR1 1:1, 50000 x 1
+ * 50Hz             50.000          50.000000         0.00           0  TMR1 1:1, 20000 x 1
+ * 100Hz           100.000         100.000000         0.00           0  TMR1 1:1, 10000 x 1
+ * 200Hz           200.000         200.000000         0.00           0  TMR1 1:1, 5000 x 1
+ * 500Hz           500.000         500.000000         0.00           0  TMR2 1:16, PR2 249
+ * 1KHz           1000.000        1000.000000         0.00           0  TMR2 1:16, PR2 124
+ * 2KHz           2000.000        2000.000000         0.00           0  TMR2 1:4, PR2 249
+ * 5KHz           5000.000        5000.000000         0.00           0  TMR2 1:4, PR2 99
+ * 10KHz         10000.000       10000.000000         0.00           0  TMR2 1:1, PR2 199
+ * 20KHz         20000.000       20000.000000         0.00           0  TMR2 1:1, PR2 99
+ * 50KHz         50000.000       50000.000000         0.00           0  TMR2 1:1, PR2 39
+ * 100KHz       100000.000      100000.000000         0.00           0  TMR2 1:1, PR2 19
+ * 200KHz       200000.000      200000.000000         0.00           0  TMR2 1:1, PR2 9
+ * 500KHz       500000.000      500000.000000         0.00           0  TMR2 1:1, PR2 3
+ * 1MHz        1000000.000     1000000.000000         0.00           0  TMR2 1:1, PR2 1
+ * 2MHz        2000000.000     2000000.000000         0.00           0  TMR2 1:1, PR2 0
+ */
+
+#ifndef FREQUENCIES_H
+#define	FREQUENCIES_H
+
+#include <stdint.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    FREQ_10mHz,
+    FREQ_20mHz,
+    FREQ_50mHz,
+    FREQ_100mHz,
+    FREQ_200mHz,
+    FREQ_500mHz,
+    FREQ_1Hz,
+    FREQ_2Hz,
+    FREQ_5Hz,
+    FREQ_10Hz,
+    FREQ_20Hz,
+    FREQ_50Hz,
+    FREQ_100Hz,
+    FREQ_200Hz,
+    FREQ_500Hz,
+    FREQ_1KHz,
+    FREQ_2KHz,
+    FREQ_5KHz,
+    FREQ_10KHz,
+    FREQ_20KHz,
+    FREQ_50KHz,
+    FREQ_100KHz,
+    FREQ_200KHz,
+    FREQ_500KHz,
+    FREQ_1MHz,
+    FREQ_2MHz
+} frequency_value_t;
+
+#define FREQ_COUNT              26
+#define FREQ_DEFAULT            FREQ_2Hz
+// last step generated by TMR1 + CCP1 compare, the rest is PWM
+#define FREQ_SLOW_LAST          FREQ_200Hz
+// last step the LEDs follow the output
+#define FREQ_BLINK_LAST         FREQ_10Hz
+
+// target frequencies and names, for the host tools
+#define FREQ_TARGETS_HZ         {0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000, 2000000}
+#define FREQ_NAMES              {"10mHz", "20mHz", "50mHz", "100mHz", "200mHz", "500mHz", "1Hz", "2Hz", "5Hz", "10Hz", "20Hz", "50Hz", "100Hz", "200Hz", "500Hz", "1KHz", "2KHz", "5KHz", "10KHz", "20KHz", "50KHz", "100KHz", "200KHz", "500KHz", "1MHz", "2MHz"}
+
+typedef struct {
+    uint8_t timerControl;       // T1CON (slow) / T2CON (fast)
+    uint8_t period;             // PR2
+    uint16_t compareStep;       // TMR1 ticks between compare matches
+    uint16_t compareChunks;     // compare matches per half period
+    uint16_t fraction;          // dithering, 1/65536 TMR1 / TMR2 tick, 0 - exact
+} frequency_setup_t;
+
+static const frequency_setup_t frequencyTable[FREQ_COUNT] = {
+    {0x31, 0x00, 62500, 200,     0},     // 10mHz
+    {0x31, 0x00, 62500, 100,     0},     // 20mHz
+    {0x31, 0x00, 62500,  40,     0},     // 50mHz
+    {0x31, 0x00, 62500,  20,     0},     // 100mHz
+    {0x31, 0x00, 62500,  10,     0},     // 200mHz
+    {0x31, 0x00, 62500,   4,     0},     // 500mHz
+    {0x31, 0x00, 62500,   2,     0},     // 1Hz
+    {0x31, 0x00, 62500,   1,     0},     // 2Hz
+    {0x21, 0x00, 50000,   1,     0},     // 5Hz
+    {0x11, 0x00, 50000,   1,     0},     // 10Hz
+    {0x01, 0x00, 50000,   1,     0},     // 20Hz
+    {0x01, 0x00, 20000,   1,     0},     // 50Hz
+    {0x01, 0x00, 10000,   1,     0},     // 100Hz
+    {0x01, 0x00,  5000,   1,     0},     // 200Hz
+    {0x7E, 0xF9,     0,   0,     0},     // 500Hz
+    {0x7E, 0x7C,     0,   0,     0},     // 1KHz
+    {0x7D, 0xF9,     0,   0,     0},     // 2KHz
+    {0x7D, 0x63,     0,   0,     0},     // 5KHz
+    {0x7C, 0xC7,     0,   0,     0},     // 10KHz
+    {0x7C, 0x63,     0,   0,     0},     // 20KHz
+    {0x7C, 0x27,     0,   0,     0},     // 50KHz
+    {0x7C, 0x13,     0,   0,     0},     // 100KHz
+    {0x7C, 0x09,     0,   0,     0},     // 200KHz
+    {0x7C, 0x03,     0,   0,     0},     // 500KHz
+    {0x7C, 0x01,     0,   0,     0},     // 1MHz
+    {0x7C, 0x00,     0,   0,     0},     // 2MHz
+};
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* FREQUENCIES_H */
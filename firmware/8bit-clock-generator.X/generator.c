@@ -5,49 +5,217 @@
  * Created on 09.12.2024
  */
 #include <xc.h>
+#include <stddef.h>
 #include "types.h"
 #include "generator.h"
+#include "frequencies.h"
 #include "leds.h"
+#include "hardware.h"
+#include "uart.h"
 
 
 generator_state_t generatorState = GEN_STATE_MANUAL_LOW;
 generator_mode_t generatorMode = GEN_MODE_MANUAL;
 
-volatile uint8_t timer1Counter = 0;
 
-typedef enum {
-    FREQ_500mHz,
-    FREQ_2Hz,
-    FREQ_10Hz,
-    FREQ_50Hz,
-    FREQ_200Hz,
-    FREQ_1KHz,
-    FREQ_5KHz,
-    FREQ_20KHz,
-    FREQ_100KHz,
-    FREQ_500KHz,
-    FREQ_1MHz,
-    FREQ_2MHz
-} frequency_value_t;
-
-enum timer1_prescaler {
-    TMR1_PRESCALE_1 = 0,
-    TMR1_PRESCALE_2 = 1,
-    TMR1_PRESCALE_4 = 2,
-    TMR1_PRESCALE_8 = 3
+enum ccp1_mode {
+    CCP1_OFF = 0b0000,
+    CCP1_COMPARE_SET = 0b1000,          // output low, set on match
+    CCP1_COMPARE_CLEAR = 0b1001,        // output high, clear on match
+    CCP1_COMPARE_SOFTWARE = GENERATOR_CCP1_RELEASE, // only CCP1IF on match, pin is PORTC
+    CCP1_PWM = 0b1100,
+    CCP1_HALF_BRIDGE = 0b10000000       // PWM P1M=10 - P1B the complement of P1A, dead band
 };
 
-enum timer2_prescaler {
-    TMR2_PRESCALE_1 = 0,
-    TMR2_PRESCALE_4 = 1,
-    TMR2_PRESCALE_16 = 2
+frequency_value_t generatorFrequency = FREQ_DEFAULT;
+
+// falling edges of RC5 seen by the firmware - slow and manual edges, the
+// cycles of a burst. A running PWM step is not counted.
+volatile uint32_t cycleCount = 0;
+
+__near volatile generator_flags_t generatorFlags = {
+    .slowEngine = FALSE,
+    .switchPending = FALSE,
+    .halvesBusy = FALSE,
+    .phaseHigh = FALSE,
+    .haltResume = FALSE,
+    .haltHeld = FALSE,
+    .lowClock = FALSE,
+    .burstDone = FALSE
 };
 
-uint16_t timer1ReloadValue = 0;
-frequency_value_t generatorFrequency;
+// SLOW generation - TMR1 runs free, CCP1 compare switches RC5 in hardware.
+// A half period is chunks * step TMR1 ticks, the matches before the last
+// one of the half period only advance CCPR1 - a 16-bit postscaler, the
+// edges stay on the TMR1 count and never drift. The high and the low half
+// differ for a duty cycle other than 50 %.
+typedef struct {
+    uint16_t step;              // TMR1 ticks between compare matches
+    uint16_t fraction;          // dithering, 1/65536 tick per match
+    uint16_t chunks;            // compare matches per half period
+} slow_half_t;
+
+// running half - halvesBusy while stepSetup is not the running step
+uint16_t compareStep = 0;
+uint16_t compareChunks = 0;
+volatile uint16_t compareRemaining = 0;
+volatile uint16_t compareNext = 0;
+
+// FAST generation - 10 bit duty cycle CCPR1L:DC1B for PR2 = period and,
+// for a dithered step, PR2 = period + 1.
+typedef struct {
+    uint8_t dutyCycle;          // CCPR1L
+    uint8_t ccpControl;         // CCP1CON, PWM mode and DC1B
+} pwm_duty_t;
+
+// prepared step, one copy in the 128 bytes of RAM - the halves of a slow
+// step ([0] low, [1] high) or the duty cycles of a PWM step. They are
+// rewritten for the next step before the switch: the slow edges meanwhile
+// repeat the running half (halvesBusy, compareChunks), the dither
+// interrupt is off.
+typedef union {
+    slow_half_t halves[2];
+    pwm_duty_t duty[2];
+} step_setup_t;
+
+step_setup_t stepSetup;
+
+// high time in percent of the period. A slow half is never shorter than
+// DUTY_COMPARE_MIN_TCY, every compare match has to be served before the
+// next one. The serial port holds the peripheral interrupts off over a
+// received or sent character (PEIE, uart.c): a match waits up to one
+// frame (~520 Tcy) and the bit interrupt that runs it. A PWM high and low
+// time is at least one Tosc * prescaler.
+#define DUTY_DEFAULT                50
+#define DUTY_MIN                    1
+#define DUTY_MAX                    99
+#define DUTY_COMPARE_MIN_TCY        1000UL
+
+uint8_t generatorDuty = DUTY_DEFAULT;
+
+// TWO-PHASE output - RC4 (P1B) is the complement of RC5 (P1A), each one
+// rises phaseDead Tcy after the other fell. The PWM steps run the ECCP
+// half-bridge, its PWM1CON dead band delays the rising edge of both. The
+// slow steps keep the RC5 edges on the compare matches, RC4 is switched
+// by the interrupt of a guard match phaseTicks before the rising and
+// after the falling edge. The guard is the dead time plus PHASE_GUARD_TCY
+// for the interrupt latency up to the RC4 write and the arming of the
+// edge match. When the serial port held the interrupt off, the edge
+// match moves to phaseLateTicks from now, the next ones keep their
+// schedule. RC4 is LOW while the generator does not run.
+#define PHASE_GUARD_TCY             64
+#define PHASE_LATE_TCY              16
+
+typedef enum {
+    PHASE_GUARD_NONE,
+    PHASE_GUARD_RISE,           // RC4 falls, the next match is the rising edge
+    PHASE_GUARD_FALL            // RC4 rises after the falling edge
+} phase_guard_t;
+
+// the PWM1CON dead band of a PWM step is derived from phaseDead when it
+// starts (_pwmDeadBand()), the guard of a slow step by _startSlow()
+uint8_t phaseDead = 0;
+// running slow step, TMR1 ticks
+uint16_t phaseTicks = 0;
+uint8_t phaseLateTicks = 0;
+uint16_t phaseMatch = 0;
+volatile phase_guard_t phaseGuard = PHASE_GUARD_NONE;
+
+// RESUMABLE HALT - nHALT holds the auto mode LOW instead of stopping it.
+// The PWM steps are held by the ECCP auto-shutdown, PRSEN restarts them
+// at the first period start after nHALT rose, the TMR2 phase is kept. The
+// slow steps stop TMR1 with RC5 / RC4 at the PORTC latch (LOW), nHALT
+// rising restores both levels and starts TMR1 again - the running half
+// period is longer by the halt. INTEDG follows the held state.
+#define PWM1CON_PRSEN               0b10000000
+
+// LOW CLOCK - a slow step with a TMR1 prescaler above 1:1 runs the core
+// at 8 MHz >> T1CKPS and TMR1 at 1:1, the TMR1 tick and the output edges
+// stay the same. The clock is switched by _startSlow() with TMR1 stopped,
+// only while the serial port is idle, not for the two-phase output (its
+// guard is in 8 MHz Tcy). Every other engine and the manual mode run at
+// 8 MHz. The interrupt latencies grow by the same factor.
+#define T1CON_T1CKPS_MASK           0b00110000
+
+// Dithering (phase accumulator) for steps no register value hits exactly.
+// The fraction of a TMR1 / TMR2 tick is added up, every carry makes one
+// compare step (slow) or one group of PWM periods (fast) a tick longer.
+uint16_t ditherFraction = 0;
+volatile uint16_t ditherPhase = 0;
+uint8_t ditherPeriod = 0;
+
+// MANUAL pulse - same TMR1 + CCP1 compare, the trailing edge is done by
+// the hardware one pulse width after the leading one. Every pulse is
+// followed by a gap of at least the same width, presses during a pulse
+// are queued.
+typedef enum {
+    PULSE_IDLE,
+    PULSE_OUT,
+    PULSE_GAP
+} pulse_phase_t;
+
+typedef struct {
+    uint8_t timerControl;       // T1CON
+    uint16_t ticks;             // CCPR1, pulse width in TMR1 ticks
+} pulse_setup_t;
+
+static const pulse_setup_t pulseSetups[PULSE_WIDTH_COUNT] = {
+    {0x01,     2},      // 1us      1:1
+    {0x01,    20},      // 10us     1:1
+    {0x01,   200},      // 100us    1:1
+    {0x01,  2000},      // 1ms      1:1
+    {0x01, 20000},      // 10ms     1:1
+    {0x21, 50000},      // 100ms    1:4
+};
+
+pulse_width_t pulseWidth = PULSE_WIDTH_10ms;
+volatile pulse_phase_t pulsePhase = PULSE_IDLE;
+volatile uint8_t pulsesQueued = 0;
+uint8_t pulseShown = TRUE;
+
+// BURST - a given number of cycles at the current frequency, then stop.
+// Slow steps count the falling edges in the compare interrupt. Fast steps
+// start TMR2 a fixed time after TMR1, TMR1 overflows in the middle of the
+// last PWM period and its interrupt sets the duty cycle latched at the
+// next period start to 0. BURST_STOP_LATENCY_TCY is the time from the
+// TMR1 overflow to the CCPR1L write minus the time from the T1CON write
+// to the T2CON write, in instruction cycles. The overflow has to come
+// after the T2CON write, so a fast burst lasts at least about 14 us.
+#define BURST_CYCLES_DEFAULT        64
+#define BURST_START_DELAY_TCY       64
+#define BURST_START_MARGIN_TCY      4
+#define BURST_STOP_LATENCY_TCY      24
+
+uint16_t burstCycles = BURST_CYCLES_DEFAULT;
+volatile uint16_t burstRemaining = 0;
+volatile uint16_t burstOverflows = 0;
 
 static void _updateHardwareSetupForGeneration(void);
-static void _slowGeneratorToggle(void);
+static uint16_t _dutyScale(uint8_t percent);
+static void _prepareHalf(slow_half_t * half, const frequency_setup_t * setup, uint16_t scale);
+static void _preparePwm(pwm_duty_t * duty, uint8_t period, uint8_t percent);
+static uint16_t _slowScale(const frequency_setup_t * setup);
+static void _prepareSetup(void);
+static void _changeSetup(void);
+static void _loadHalf(void);
+static void _startSlow(uint8_t high);
+static void _startFast(uint8_t preload);
+static uint8_t _stopFastAtBoundary(void);
+static void _switchFrequency(void);
+static uint8_t _pwmDeadBand(const frequency_setup_t * setup, const pwm_duty_t * duty);
+static uint16_t _nextMatch(void);
+static uint16_t _readTimer1(void);
+static void _writeCompare(uint16_t match);
+static void _writeGuarded(uint16_t served, uint16_t match);
+static void _selectCompareAction(void);
+static void _setOutput(uint8_t high);
+static void _setPhase(uint8_t high);
+static void _holdClock(void);
+static void _releaseClock(void);
+static void _startPulse(void);
+static void _stopPulse(void);
+static uint32_t _fastBurstTicks(const frequency_setup_t * setup);
+static void _startFastBurst(const frequency_setup_t * setup, uint32_t ticks);
 
 /**
  * 
@@ -56,123 +224,147 @@ void _updateHardwareSetupForGeneration(void)
 {
     // stop all timers and CCP if manual mode
     if (generatorMode == GEN_MODE_MANUAL) {        
+        CCP1IE = 0;     // disable CCP1 interrupt
+        TMR2IE = 0;     // disable TMR2 interrupt
+        TMR1IE = 0;     // disable TMR1 interrupt
         T1CON = 0;      // stop timer 1
         T2CON = 0;      // stop timer 2
         CCP1CON = 0;    // stop CCP
+        hardware_setClock(0);
+        _setPhase(0);
+        pulsePhase = PULSE_IDLE;
+        pulsesQueued = 0;
+        generatorFlags.switchPending = FALSE;
+        generatorFlags.slowEngine = FALSE;
+        phaseGuard = PHASE_GUARD_NONE;
 
         return;
     }
     
     // generator is in AUTO mode - continue
-    uint8_t prescaller = 0;     // 1:1
-    
-    if (generatorFrequency <= FREQ_200Hz) {
-        // SLOW generation mode - use TMR1 -> interrupt logic -> RC5
-
-        // stop CCP
-        CCP1CON = 0;
-
-        prescaller = TMR1_PRESCALE_1;     // 1:1
-        switch (generatorFrequency)
-        {
-            case FREQ_500mHz:
-                prescaller = TMR1_PRESCALE_8;     // 1:8
-                timer1ReloadValue = (0xFFFF - 62500);
-                break;
-            case FREQ_2Hz:
-                prescaller = TMR1_PRESCALE_8;     // 1:8
-                timer1ReloadValue = (0xFFFF - 62500);
-                break;
-            case FREQ_10Hz:
-                prescaller = TMR1_PRESCALE_4;     // 1:4
-                timer1ReloadValue = (0xFFFF - 25000);
-                break;
-            case FREQ_50Hz:
-                timer1ReloadValue = (0xFFFF - 20000);
-                break;
-            case FREQ_200Hz:
-                timer1ReloadValue = (0xFFFF - 5000);
-                break;
-            default:
-                return;     // not supported
-                break;
-        }
-        
-        // configure TIMER1 module
-        TMR1    = timer1ReloadValue;            // reset counter
-        //            xx            T1CKPS=3    1:1-1:8 prescaler
-        //               0          nT1SYNC=0   synchronize
-        //                0         TMR1CS=0    source Internal clock (FOSC/4)
-        //                 1        TMR1ON=1    disable Timer 1
-        T1CON   = 0b00000001 | (uint8_t)(prescaller << 4);
-        
-        // enable TMR1 interrupt
-        TMR1IE = 1;
-        
+    if (generatorFrequency <= FREQ_SLOW_LAST) {
+        // SLOW generation mode - use TMR1 -> CCP1 compare -> RC5
+
+        // stop TMR2 and CCP, output low
+        CCP1IE = 0;
+        TMR2IE = 0;
+        TMR1IE = 0;
+        T2CON = 0;
+        T1CON = 0;
+        CCP1CON = CCP1_OFF;
+        _setOutput(0);
+
+        // first edge (LOW -> HIGH) after a half period
+        _prepareSetup();
+        _startSlow(FALSE);
+
         return;
     }
     
     // FAST generation mode - use TMR2 -> CCP1 -> RC5
 
-    // disable TMR1 interrupt
+    // disable CCP1 interrupt, TMR1 is not used
+    CCP1IE = 0;
+    TMR2IE = 0;
     TMR1IE = 0;
-    
-    uint8_t timer2Period = 0xFF;
-    uint8_t pulseWith   = 0x7F;
-    prescaller = TMR2_PRESCALE_1;     // 1:1
-    switch (generatorFrequency)
-    {
-        case FREQ_1KHz:
-            prescaller = TMR2_PRESCALE_16;
-            timer2Period = 125;
-            break;
-        case FREQ_5KHz:
-            prescaller = TMR2_PRESCALE_4;
-            timer2Period = 100;
-            break;
-        case FREQ_20KHz:
-            timer2Period = 100;
-            break;
-        case FREQ_100KHz:
-            timer2Period = 20;
-            break;
-        case FREQ_500KHz:
-            timer2Period = 4;
-            break;
-        case FREQ_1MHz:
-            timer2Period = 2;
-            break;
-        case FREQ_2MHz:
-            timer2Period = 1;
-            break;
-       default:
-            return;     // not supported
-            break;
+    T1CON = 0;
+
+    // first period right away
+    _prepareSetup();
+    _startFast(frequencyTable[generatorFrequency].period);
+}
+
+/**
+ * SLOW generation - TMR1 -> CCP1 compare -> RC5. The current output
+ * level (high) lasts a full half period from now.
+ */
+static void _startSlow(uint8_t high)
+{
+    const frequency_setup_t * setup = &frequencyTable[generatorFrequency];
+    uint8_t control = setup->timerControl;
+    uint8_t shift = (control & T1CON_T1CKPS_MASK) >> 4;
+
+    T1CON = 0;
+    // guard and late margin in TMR1 ticks of the step (T1CKPS)
+    phaseTicks = 0;
+    phaseLateTicks = (uint8_t)(((PHASE_LATE_TCY - 1) >> shift) + 1);
+    if (phaseDead != 0) {
+        phaseTicks = (uint16_t)(((phaseDead + PHASE_GUARD_TCY - 1) >> shift) + 1);
     }
-    
-    pulseWith = timer2Period >> 1;
 
-    uint8_t pwmPrecise = 0;
-    if (pulseWith == 0) {
-        pwmPrecise = 2;
+    if (generatorFlags.lowClock && generatorMode == GEN_MODE_AUTO && phaseDead == 0 && uart_isIdle()) {
+        control &= (uint8_t)~T1CON_T1CKPS_MASK;
+    } else {
+        shift = 0;
     }
-    
+    hardware_setClock(shift);
+    ditherPhase = 0;
+    generatorFlags.halvesBusy = FALSE;
+    phaseGuard = PHASE_GUARD_NONE;
+
+    generatorState = high ? GEN_STATE_SLOW_AUTO_HIGH : GEN_STATE_SLOW_AUTO_LOW;
+    _loadHalf();
+    compareNext = compareStep;
+    TMR1 = 0;
+    // RC4 is low in the high half, it rises a guard after a low start
+    _setPhase(0);
+    if (phaseTicks != 0 && !high) {
+        phaseGuard = PHASE_GUARD_FALL;
+        _writeCompare(phaseTicks);
+    } else {
+        _writeCompare(_nextMatch());
+    }
+    _selectCompareAction();
+
+    // configure TIMER1 module
+    //            xx            T1CKPS      1:1-1:8 prescaler (table), 1:1 at the low clock
+    //               0          nT1SYNC=0   synchronize
+    //                0         TMR1CS=0    source Internal clock (FOSC/4)
+    //                 1        TMR1ON=1    enable Timer 1, held by nHALT - at the release
+    T1CON   = generatorFlags.haltHeld ? (uint8_t)(control & 0xFE) : control;
+
+    // enable CCP1 interrupt
+    CCP1IF = 0;
+    CCP1IE = 1;
+    generatorFlags.slowEngine = TRUE;
+}
+
+/**
+ * FAST generation - TMR2 -> CCP1 PWM -> RC5. The output stays low until
+ * TMR2 counts from preload up to PR2 and the first period starts.
+ */
+static void _startFast(uint8_t preload)
+{
+    const frequency_setup_t * setup = &frequencyTable[generatorFrequency];
+
+    T2CON = 0;
+    hardware_setClock(0);
+    PR2 = setup->period;
+
+    // duty cycle (8 MSbs)
+    CCPR1L = stepSetup.duty[0].dutyCycle;
+
     // start CCP1
-    //          00              P1M=b0       Single output; P1A modulated; P1B, P1C, P1D assigned as port pins
-    //            00            DC1B=b00     These bits are the two LSbs of the PWM duty cycle. The eight MSbs are found in CCPR1L.
+    //          x0              P1M          00 single output - P1B is a port pin (RC4 LOW),
+    //                                       10 half-bridge - P1B the complement of P1A (prepared)
+    //            xx            DC1B         These bits are the two LSbs of the PWM duty cycle (prepared)
     //              1100        CCP1M=b1100  PWM mode; P1A, P1C active-high; P1B, P1D active-high
-    CCP1CON = 0b00001100 | (uint8_t)(pwmPrecise << 4);
-    
-    // configure TIMER2 module (used by CCP module for freq. gen.)
-    //          x
-    //           1111           TOUTPS      postscaler 1:16
-    //               1          TMR2ON      TIMER2 ON
-    //                00        T2CKPS      prescaler 1:1
-    T2CON   = 0b01111100 | prescaller;
-    PR2     = (timer2Period - 1);
-    
-    // set 50% as duty cycle
-    CCPR1L = pulseWith;
+    _setPhase(0);
+    CCP1CON = stepSetup.duty[0].ccpControl;
+    // dead band of the half-bridge, restart after a resumable halt
+    //          x               PRSEN       1 - auto-shutdown ends with nHALT high, 0 - cleared by software
+    //           xxxxxxx        PDC         Tcy from an edge of one phase to the rising edge of the other
+    PWM1CON = (uint8_t)(_pwmDeadBand(setup, &stepSetup.duty[0]) | (generatorFlags.haltResume ? PWM1CON_PRSEN : 0));
+    TMR2 = preload;
+
+    // dithered step - TMR2 interrupt selects PR2 for the next periods
+    ditherFraction = setup->fraction;
+    ditherPhase = 0;
+    ditherPeriod = setup->period;
+    if (ditherFraction != 0) {
+        TMR2IF = 0;
+        TMR2IE = 1;
+    }
     
     // setup auto-shutdown
     //         0                ECCPASE=0   ECCP outputs are operating
@@ -181,62 +373,670 @@ void _updateHardwareSetupForGeneration(void)
     //               00         PSSBD=00    Drive pins P1B and P1D to '0'
     ECCPAS = 0b01000000;
 
-    // set yellow light
-    leds_setState(LEDS_AUTO_YELLOW);
+    generatorState = GEN_STATE_FAST_AUTO;
+
+    // configure TIMER2 module (used by CCP module for freq. gen.), last
+    //          x
+    //           1111           TOUTPS      postscaler 1:16
+    //               1          TMR2ON      TIMER2 ON
+    //                xx        T2CKPS      prescaler (table)
+    T2CON   = setup->timerControl;
+    generatorFlags.slowEngine = FALSE;
 }
 
 /**
- * 
+ * Let the running PWM period finish and keep the output low: 0 % duty
+ * cycle is latched at the next period start, TMR2 is stopped after it.
+ * nHALT stops TMR2 in the ISR, the period never ends then.
+ * @return FALSE - stopped by nHALT, no engine may start
  */
-void _slowGeneratorToggle(void)
+static uint8_t _stopFastAtBoundary(void)
 {
-    static leds_state_t ledState = LEDS_OFF;
-    if (generatorState == GEN_STATE_SLOW_AUTO_LOW) {
-        // set it to HIGH
-        generatorState = GEN_STATE_SLOW_AUTO_HIGH;
-        RC5 = 1;
-        ledState = LEDS_AUTO_GREEN;
+    TMR2IE = 0;
+    // postscaler 1:1, TMR2IF at every period start
+    T2CON &= 0b00000111;
+    // DC1B first - if the period ends in between, it is half a tick shorter.
+    // The half-bridge stays, RC4 follows as the complement.
+    CCP1CON &= (uint8_t)(CCP1_HALF_BRIDGE | CCP1_PWM);
+    CCPR1L = 0;
+    TMR2IF = 0;
+    while (!TMR2IF && TMR2ON) {
+    }
+    if (!TMR2ON) {
+        return FALSE;
+    }
+    T2CON = 0;
+    return TRUE;
+}
+
+/**
+ * Move the running engine to generatorFrequency. The slow engine
+ * switches in the compare interrupt at its next edge, the fast one at
+ * the end of the running period, so every high / low time around the
+ * change lies between the shorter half period of the two steps and the
+ * sum of both.
+ */
+static void _switchFrequency(void)
+{
+    // no switch by the interrupt while deciding
+    CCP1IE = 0;
+    if (generatorFlags.slowEngine) {
+        generatorFlags.switchPending = TRUE;
+        // a PWM step keeps the running half up to the switch
+        generatorFlags.halvesBusy = (generatorFrequency > FREQ_SLOW_LAST);
+        CCP1IE = 1;
+        return;
+    }
+
+    if (!_stopFastAtBoundary()) {
+        // the main loop takes the stop
+        return;
+    }
+    if (generatorFrequency <= FREQ_SLOW_LAST) {
+        CCP1CON = CCP1_OFF;
+        _setOutput(0);
+        _startSlow(FALSE);
     } else {
-        // set it to LOW
-        generatorState = GEN_STATE_SLOW_AUTO_LOW;
-        RC5 = 0;
-        ledState = LEDS_AUTO_RED;
+        _startFast(frequencyTable[generatorFrequency].period);
     }
-    if (generatorFrequency > FREQ_10Hz) {
-        ledState = LEDS_AUTO_YELLOW;
+}
+
+/**
+ * Percent as a fraction of 65536
+ * @param percent
+ * @return uint16_t
+ */
+static uint16_t _dutyScale(uint8_t percent)
+{
+    return (uint16_t)(((uint32_t)percent << 16) / 100);
+}
+
+/**
+ * One slow half period, scale / 65536 of the step period. A half longer
+ * than a TMR1 period is made of twice the compare matches.
+ * @param half
+ * @param setup
+ * @param scale
+ */
+static void _prepareHalf(slow_half_t * half, const frequency_setup_t * setup, uint16_t scale)
+{
+    uint32_t ticks;
+
+    half->chunks = setup->compareChunks;
+    if (scale == 0x8000) {
+        // 50 % - the table values, bit exact
+        half->step = setup->compareStep;
+        half->fraction = setup->fraction;
+        return;
     }
-    // update LEDs state
-    leds_setState(ledState);
+
+    // half of the step, 16.16 TMR1 ticks per match
+    ticks = (uint32_t)setup->compareStep * scale + (((uint32_t)setup->fraction * scale) >> 16);
+    if (ticks & 0x80000000UL) {
+        half->chunks <<= 1;
+    } else {
+        ticks <<= 1;
+    }
+    half->step = (uint16_t)(ticks >> 16);
+    half->fraction = (uint16_t)ticks;
+}
+
+/**
+ * 10 bit duty cycle for PR2 = period, at least one step high and low
+ * @param duty
+ * @param period
+ * @param percent
+ */
+static void _preparePwm(pwm_duty_t * duty, uint8_t period, uint8_t percent)
+{
+    // the period in duty cycle steps (Tosc * prescaler)
+    uint16_t steps = ((uint16_t)period + 1) << 2;
+    uint16_t value = (uint16_t)(((uint32_t)steps * _dutyScale(percent) + 0x8000) >> 16);
+
+    if (value == 0) {
+        value = 1;
+    } else if (value >= steps) {
+        value = steps - 1;
+    }
+    duty->dutyCycle = (uint8_t)(value >> 2);
+    duty->ccpControl = CCP1_PWM | (uint8_t)((value & 0x03) << 4);
 }
 
+/**
+ * PWM1CON dead band of a PWM step, at most half the shorter phase. Also
+ * called by the compare interrupt when it starts a PWM step.
+ * @param setup
+ * @param duty
+ * @return uint8_t
+ */
+static uint8_t _pwmDeadBand(const frequency_setup_t * setup, const pwm_duty_t * duty)
+{
+    // the shorter phase in duty cycle steps (Tosc * prescaler)
+    uint16_t shorter = ((uint16_t)duty->dutyCycle << 2) | ((duty->ccpControl >> 4) & 0x03);
+    uint16_t other = (((uint16_t)setup->period + 1) << 2) - shorter;
+
+    if (other < shorter) {
+        shorter = other;
+    }
+    // duty cycle steps of Tosc * prescaler to Tcy, half of it
+    shorter = (uint16_t)((shorter << ((setup->timerControl & 0x03) << 1)) >> 3);
+    return (phaseDead < shorter) ? phaseDead : (uint8_t)shorter;
+}
 
 /**
- * 
+ * generatorDuty of a slow step as a fraction of 65536, no half shorter
+ * than DUTY_COMPARE_MIN_TCY
+ * @param setup
+ * @return uint16_t
  */
-inline void generator_timer1Callback(void)
+static uint16_t _slowScale(const frequency_setup_t * setup)
 {
-    if (timer1ReloadValue != 0) {
-        TMR1 += timer1ReloadValue;
+    uint8_t shift = (setup->timerControl >> 4) & 0x03;
+    uint8_t percent = generatorDuty;
+
+    // shortest half in percent, the step at 50 % in Tcy is 1 %
+    uint32_t stepTcy = (uint32_t)setup->compareStep << shift;
+    uint32_t minimum = (DUTY_COMPARE_MIN_TCY * DUTY_DEFAULT + stepTcy - 1) / stepTcy;
+    if (minimum >= DUTY_DEFAULT) {
+        percent = DUTY_DEFAULT;
+    } else if (percent < minimum) {
+        percent = (uint8_t)minimum;
+    } else if (percent > 100 - minimum) {
+        percent = (uint8_t)(100 - minimum);
     }
-    
-    if (generatorFrequency == FREQ_500mHz) {
-        if (++timer1Counter >= 4) {
-            timer1Counter = 0;
-            _slowGeneratorToggle();
+    return _dutyScale(percent);
+}
+
+/**
+ * Engine values of generatorFrequency at generatorDuty and phaseDead,
+ * taken by the next _startSlow() / _startFast(). Called from the main
+ * loop only, the divisions stay out of the interrupts. A running dithered
+ * PWM step loses its interrupt, the switch stops it next.
+ */
+static void _prepareSetup(void)
+{
+    const frequency_setup_t * setup = &frequencyTable[generatorFrequency];
+
+    TMR2IE = 0;
+    if (generatorFrequency > FREQ_SLOW_LAST) {
+        _preparePwm(&stepSetup.duty[0], setup->period, generatorDuty);
+        _preparePwm(&stepSetup.duty[1], setup->period + 1, generatorDuty);
+        if (phaseDead != 0) {
+            stepSetup.duty[0].ccpControl |= CCP1_HALF_BRIDGE;
+            stepSetup.duty[1].ccpControl |= CCP1_HALF_BRIDGE;
         }
-    } else if (generatorFrequency <= FREQ_200Hz) {
-        _slowGeneratorToggle();
+        return;
     }
+
+    // both halves add up to the period, the low one takes the rounding
+    uint16_t scale = _slowScale(setup);
+    _prepareHalf(&stepSetup.halves[0], setup, (uint16_t)(0 - scale));
+    _prepareHalf(&stepSetup.halves[1], setup, scale);
 }
 
+/**
+ * New step or duty cycle, the auto mode switches to it. A burst keeps
+ * its step, every start prepares the step it runs.
+ */
+static void _changeSetup(void)
+{
+    if (generatorMode != GEN_MODE_AUTO) {
+        return;
+    }
+    if (generatorFlags.slowEngine) {
+        // the interrupt must not start a half prepared step, its edges
+        // repeat the running half while the halves are rewritten
+        CCP1IE = 0;
+        generatorFlags.switchPending = FALSE;
+        generatorFlags.halvesBusy = TRUE;
+        CCP1IE = 1;
+    }
+    _prepareSetup();
+    _switchFrequency();
+}
 
 /**
- * 
+ * Select what the next TMR1 == CCPR1 match does with RC5.
+ * The RC5 latch is kept LOW, so nHALT only has to take CCP1 off the pin.
+ * A match that is no edge raises only the interrupt while the output is
+ * LOW, the pin is the latch then. A high half keeps the set mode of its
+ * rising edge - a new compare mode would start the pin LOW. Only a high
+ * half resumed after a halt is held by the latch, until its edge.
+ */
+static void _selectCompareAction(void)
+{
+    uint8_t mode;
+
+    if (generatorFlags.haltHeld) {
+        // RC5 stays at the LOW latch until nHALT rises
+        mode = CCP1_COMPARE_SOFTWARE;
+    } else if (compareRemaining == 1 && phaseGuard == PHASE_GUARD_NONE) {
+        // this match is the edge
+        mode = (generatorState == GEN_STATE_SLOW_AUTO_LOW) ? CCP1_COMPARE_SET : CCP1_COMPARE_CLEAR;
+    } else if (generatorState == GEN_STATE_SLOW_AUTO_LOW) {
+        mode = CCP1_COMPARE_SOFTWARE;
+    } else if (CCP1CON == CCP1_COMPARE_SET) {
+        return;
+    } else {
+        _setOutput(1);
+        mode = CCP1_COMPARE_SOFTWARE;
+    }
+
+    if (CCP1CON != mode) {
+        CCP1CON = mode;
+        if (mode == CCP1_COMPARE_CLEAR) {
+            // a resumed high half is on CCP1 again
+            _setOutput(0);
+        }
+    }
+}
+
+/**
+ * Port latch of the output, used while CCP1 does not drive RC5
+ * @param high
+ */
+static void _setOutput(uint8_t high)
+{
+    hardware_writePortC(GENERATOR_OUT_MASK, high ? GENERATOR_OUT_MASK : 0);
+}
+
+/**
+ * Port latch of the second phase, used while the half-bridge does not
+ * drive RC4. Held by nHALT, the level is only kept for the release.
+ * @param high
+ */
+static void _setPhase(uint8_t high)
+{
+    generatorFlags.phaseHigh = high;
+    if (!generatorFlags.haltHeld) {
+        hardware_writePortC(GENERATOR_PHASE_MASK, high ? GENERATOR_PHASE_MASK : 0);
+    }
+}
+
+/**
+ * Next compare match of the slow engine - compareNext, or the guard
+ * before it when it is the rising edge of a two-phase output
+ * @return uint16_t
+ */
+static uint16_t _nextMatch(void)
+{
+    if (phaseTicks != 0 && compareRemaining == 1 && generatorState == GEN_STATE_SLOW_AUTO_LOW) {
+        phaseGuard = PHASE_GUARD_RISE;
+        phaseMatch = compareNext - phaseTicks;
+        return phaseMatch;
+    }
+    return compareNext;
+}
+
+/**
+ * TMR1 while it runs, the high byte read again in case the low one wrapped
+ * @return uint16_t
+ */
+static uint16_t _readTimer1(void)
+{
+    uint8_t high;
+    uint8_t low;
+
+    do {
+        high = TMR1H;
+        low = TMR1L;
+    } while (high != TMR1H);
+    return ((uint16_t)high << 8) | low;
+}
+
+/**
+ * @param match
+ */
+static void _writeCompare(uint16_t match)
+{
+    // high byte first, so the half written value is never a near match
+    CCPR1H = (uint8_t)(match >> 8);
+    CCPR1L = (uint8_t)match;
+}
+
+/**
+ * Next match of a two-phase output, served is the match the interrupt
+ * runs for. When the serial port held the interrupt off until the next
+ * match is too close, it moves to phaseLateTicks from now - a guard or
+ * an edge comes late, the schedule stays.
+ * @param served
+ * @param match
+ */
+static void _writeGuarded(uint16_t served, uint16_t match)
+{
+    uint16_t elapsed = _readTimer1() - served;
+
+    if ((uint16_t)(elapsed + phaseLateTicks) >= (uint16_t)(match - served)) {
+        match = served + elapsed + phaseLateTicks;
+        if (phaseGuard == PHASE_GUARD_FALL) {
+            phaseMatch = match;
+        }
+    }
+    _writeCompare(match);
+}
+
+
+/**
+ * CCP1 compare match (called from the ISR). RC5 has already been switched
+ * by the hardware, here only the next match is scheduled.
+ */
+inline void generator_compareCallback(void)
+{
+    uint16_t phase = ditherPhase;
+    uint8_t fell = FALSE;
+
+    if (generatorMode == GEN_MODE_MANUAL) {
+        // next match one pulse width from now
+        TMR1H = 0;
+        if (pulsePhase == PULSE_OUT) {
+            // trailing edge is done, RC5 back to the PORTC latch
+            pulsePhase = PULSE_GAP;
+            cycleCount++;
+            CCP1CON = CCP1_COMPARE_SOFTWARE;
+        } else if (pulsesQueued) {
+            // queued press - leading edge
+            pulsesQueued--;
+            pulsePhase = PULSE_OUT;
+            CCP1CON = (generatorState == GEN_STATE_MANUAL_LOW)
+                ? CCP1_COMPARE_CLEAR
+                : CCP1_COMPARE_SET;
+        } else {
+            pulsePhase = PULSE_IDLE;
+            T1CON = 0;
+            CCP1IE = 0;
+            CCP1CON = CCP1_OFF;
+        }
+        TMR1L = 0;
+        return;
+    }
+
+    if (phaseGuard != PHASE_GUARD_NONE) {
+        // RC4 edge, then the match it guards
+        uint16_t guard = phaseMatch;
+        uint16_t match = compareNext;
+        if (phaseGuard == PHASE_GUARD_RISE) {
+            _setPhase(0);
+            phaseGuard = PHASE_GUARD_NONE;
+        } else {
+            _setPhase(1);
+            phaseGuard = PHASE_GUARD_NONE;
+            match = _nextMatch();
+        }
+        _writeGuarded(guard, match);
+        _selectCompareAction();
+        return;
+    }
+
+    if (--compareRemaining == 0) {
+        // this match was an edge
+        if (generatorState == GEN_STATE_SLOW_AUTO_LOW) {
+            generatorState = GEN_STATE_SLOW_AUTO_HIGH;
+        } else {
+            generatorState = GEN_STATE_SLOW_AUTO_LOW;
+            fell = TRUE;
+            cycleCount++;
+            if (generatorMode == GEN_MODE_BURST && --burstRemaining == 0) {
+                // last falling edge - stop with the output low
+                T1CON = 0;
+                CCP1IE = 0;
+                _setOutput(0);
+                CCP1CON = CCP1_OFF;
+                generatorFlags.burstDone = 1;
+                return;
+            }
+        }
+
+        if (generatorFlags.switchPending) {
+            if (generatorFrequency <= FREQ_SLOW_LAST) {
+                // new half period starts with this edge
+                generatorFlags.switchPending = FALSE;
+                _startSlow(generatorState == GEN_STATE_SLOW_AUTO_HIGH);
+                return;
+            }
+            if (generatorState == GEN_STATE_SLOW_AUTO_LOW) {
+                // PWM from this falling edge, first period after a half period
+                generatorFlags.switchPending = FALSE;
+                CCP1IE = 0;
+                T1CON = 0;
+                _startFast((uint8_t)((frequencyTable[generatorFrequency].period + 1) >> 1));
+                return;
+            }
+        }
+        _loadHalf();
+    }
+
+    uint16_t served = compareNext;
+    compareNext += compareStep;
+    ditherPhase += ditherFraction;
+    if (ditherPhase < phase) {
+        // accumulator carry - one tick longer
+        compareNext++;
+    }
+    if (phaseTicks == 0) {
+        _writeCompare(compareNext);
+    } else if (fell) {
+        // RC4 rises a guard after this edge
+        phaseGuard = PHASE_GUARD_FALL;
+        phaseMatch = served + phaseTicks;
+        _writeGuarded(served, phaseMatch);
+    } else {
+        _writeGuarded(served, _nextMatch());
+    }
+
+    _selectCompareAction();
+}
+
+/**
+ * Step, dithering and match count of the half period generatorState
+ * starts, called at an edge. The running half again while the halves
+ * are rewritten.
  */
-inline void generator_init(void)
+static void _loadHalf(void)
 {
-    // set default frequency
-    generatorFrequency = FREQ_2Hz;
+    const slow_half_t * half = &stepSetup.halves[generatorState == GEN_STATE_SLOW_AUTO_HIGH];
+
+    if (!generatorFlags.halvesBusy) {
+        compareStep = half->step;
+        ditherFraction = half->fraction;
+        compareChunks = half->chunks;
+    }
+    compareRemaining = compareChunks;
+}
+
+/**
+ * TMR2 postscaler match of a dithered PWM step (called from the ISR).
+ * Sets the period (PR2) and the duty cycle of the next group of periods
+ * to either ditherPeriod + 1 or ditherPeriod + 2 TMR2 ticks.
+ */
+inline void generator_ditherCallback(void)
+{
+    uint16_t phase = ditherPhase;
+    uint8_t period = ditherPeriod;
+    const pwm_duty_t * duty = &stepSetup.duty[0];
+
+    ditherPhase += ditherFraction;
+    if (ditherPhase < phase) {
+        period++;
+        duty = &stepSetup.duty[1];
+    }
+
+    // a shorter period must not be written while TMR2 is already past it
+    while (TMR2 >= period) {
+    }
+    PR2 = period;
+
+    CCPR1L = duty->dutyCycle;
+    CCP1CON = duty->ccpControl;
+}
+
+/**
+ * TMR1 overflow during a fast burst (called from the ISR). The first
+ * write after the last overflow is done a fixed time after it, inside
+ * the last period of the burst.
+ */
+inline uint8_t generator_burstCallback(void)
+{
+    if (--burstOverflows != 0) {
+        if (burstOverflows == 1) {
+            // nothing may delay the interrupt of the last overflow
+            T0IE = 0;
+        }
+        return FALSE;
+    }
+
+    // duty cycle 0 latched at the next period start, a half-bridge stays
+    CCPR1L = 0;
+    CCP1CON &= (uint8_t)(CCP1_HALF_BRIDGE | CCP1_PWM);
+    TMR1IE = 0;
+    T1CON = 0;
+    generatorFlags.burstDone = 1;
+    cycleCount += burstCycles;
+    return TRUE;
+}
+
+/**
+ * Outputs LOW until nHALT rises. A PWM step is already shut down by the
+ * ECCP, a slow step stops TMR1 where it is.
+ */
+static void _holdClock(void)
+{
+    generatorFlags.haltHeld = TRUE;
+    hardware_clearPortCCallback(GENERATOR_OUT_MASK | GENERATOR_PHASE_MASK);
+    if (generatorFlags.slowEngine) {
+        TMR1ON = 0;
+        CCP1CON = CCP1_COMPARE_SOFTWARE;
+    }
+}
+
+/**
+ * Slow step from where it was held, RC5 and RC4 back at their levels. A
+ * PWM step is restarted by PRSEN at its next period.
+ */
+static void _releaseClock(void)
+{
+    generatorFlags.haltHeld = FALSE;
+    if (generatorFlags.slowEngine) {
+        _selectCompareAction();
+        TMR1ON = 1;
+        if (phaseTicks != 0) {
+            _setPhase(generatorFlags.phaseHigh);
+        }
+    }
+}
+
+/**
+ * nHALT edge (called from the ISR). The level of RA2 decides, an edge
+ * that came while INTEDG was changed is taken right away.
+ * @return FALSE - no resumable halt, the ISR stops the generator
+ */
+inline uint8_t generator_haltCallback(void)
+{
+    if (!generatorFlags.haltHeld && (!generatorFlags.haltResume || generatorMode != GEN_MODE_AUTO)) {
+        return FALSE;
+    }
+    do {
+        if (generatorFlags.haltHeld) {
+            _releaseClock();
+        } else {
+            _holdClock();
+        }
+        // held - wait for the rising edge
+        INTEDG = generatorFlags.haltHeld;
+        INTF = 0;
+    } while (RA2 == generatorFlags.haltHeld);
+    return TRUE;
+}
+
+/**
+ * Called from the main loop after a slow output edge or an engine switch
+ */
+void generator_clockEdgeCallback(void)
+{
+    if (generatorFlags.burstDone) {
+        // burst complete - clock stopped LOW
+        generator_stop();
+    }
+}
+
+/**
+ * LEDs follow the generator, called from the main loop once per TMR0 tick
+ * (and before SLEEP) instead of on every output edge. The LED write is
+ * skipped by the PORTC layer while nothing changes.
+ */
+void generator_refreshLeds(void)
+{
+    leds_state_t ledState;
+
+    if (generatorMode == GEN_MODE_MANUAL) {
+        uint8_t high = (generatorState == GEN_STATE_MANUAL_HIGH);
+        // a pulse shows the opposite level for at least one refresh
+        if (pulsePhase == PULSE_OUT || pulseShown == FALSE) {
+            high = !high;
+        }
+        pulseShown = TRUE;
+        ledState = high ? LEDS_MANUAL_GREEN : LEDS_MANUAL_RED;
+    } else if (generatorFlags.haltHeld) {
+        ledState = LEDS_AUTO_RED;
+    } else if (generatorFrequency > FREQ_BLINK_LAST) {
+        ledState = LEDS_AUTO_YELLOW;
+    } else if (generatorState == GEN_STATE_SLOW_AUTO_HIGH) {
+        ledState = LEDS_AUTO_GREEN;
+    } else {
+        ledState = LEDS_AUTO_RED;
+    }
+    leds_setState(ledState);
+}
+
+/**
+ * Manual pulse - leading edge now, the trailing one by CCP1 compare.
+ * The compare mode written to CCP1CON initialises the output to the
+ * opposite of the match action, which is the pulse level.
+ */
+static void _startPulse(void)
+{
+    const pulse_setup_t * setup = &pulseSetups[pulseWidth];
+
+    T1CON = 0;
+    TMR1 = 0;
+    CCPR1H = (uint8_t)(setup->ticks >> 8);
+    CCPR1L = (uint8_t)setup->ticks;
+    pulsePhase = PULSE_OUT;
+    pulseShown = FALSE;
+    CCP1IF = 0;
+    CCP1IE = 1;
+
+    if (generatorState == GEN_STATE_MANUAL_LOW) {
+        CCP1CON = CCP1_COMPARE_CLEAR;
+    } else {
+        CCP1CON = CCP1_COMPARE_SET;
+    }
+    T1CON = setup->timerControl;
+}
+
+/**
+ * Drop the running pulse and the queued ones, RC5 back to the PORTC latch
+ */
+static void _stopPulse(void)
+{
+    CCP1IE = 0;
+    T1CON = 0;
+    CCP1CON = CCP1_OFF;
+    pulsePhase = PULSE_IDLE;
+    pulsesQueued = 0;
+}
+
+
+/**
+ * The settings of the last session are set already, an unknown mode
+ * starts the auto mode
+ * @param mode
+ */
+inline void generator_init(generator_mode_t mode)
+{
+    if (mode == GEN_MODE_MANUAL) {
+        // manual LOW - the power-on state of the output
+        return;
+    }
     // set state auto
     generator_setAutoMode();
 }
@@ -256,7 +1056,8 @@ void generator_toggleMode(void)
 
 void generator_stopFast(void)
 {
-    RC5 = 0;            // set output low
+    // both phases low
+    hardware_writePortC(GENERATOR_OUT_MASK | GENERATOR_PHASE_MASK, 0);
     T2CON = 0;          // stop timer 0
     T1CON = 0;          // stop timer 1
     CCP1CON = 0;        // stop CCP
@@ -268,7 +1069,13 @@ void generator_stopFast(void)
 void generator_stop(void)
 {
     generator_stopFast();
-    leds_setState(LEDS_MANUAL_RED);
+    _stopPulse();
+    hardware_setClock(0);
+    TMR1IE = 0;
+    T0IE = 1;
+    generatorFlags.burstDone = 0;
+    generatorFlags.switchPending = FALSE;
+    generatorFlags.slowEngine = FALSE;
     generatorMode = GEN_MODE_MANUAL;
     generatorState = GEN_STATE_MANUAL_LOW;
 }
@@ -283,6 +1090,33 @@ inline generator_mode_t generator_getMode(void)
     return generatorMode;
 }
 
+/**
+ * 
+ * @return generator_state_t
+ */
+generator_state_t generator_getState(void)
+{
+    return generatorState;
+}
+
+/**
+ * Manual mode with no pulse running or queued - no timer is needed
+ * @return TRUE when the core may SLEEP
+ */
+uint8_t generator_isIdle(void)
+{
+    return generatorMode == GEN_MODE_MANUAL && pulsePhase == PULSE_IDLE;
+}
+
+/**
+ * 
+ * @return uint8_t
+ */
+uint8_t generator_isHeld(void)
+{
+    return generatorFlags.haltHeld;
+}
+
 /**
  * 
  */
@@ -295,16 +1129,6 @@ void generator_setAutoMode(void)
         generatorState = GEN_STATE_MANUAL_LOW;
         // update hardware depending on the mode
         _updateHardwareSetupForGeneration();
-        _slowGeneratorToggle();
-    }
-}
-
-void _toggleDelay(void)
-{
-    uint16_t counter = 0;
-    
-    while(counter++ < 10000) {
-        asm("NOP");
     }
 }
 
@@ -314,38 +1138,176 @@ void _toggleDelay(void)
  */
 void generator_setManualState(uint8_t manualState)
 {
+    uint8_t modeChanged = FALSE;
+
     if (generatorMode != GEN_MODE_MANUAL) {
         // update generator state
         generatorMode = GEN_MODE_MANUAL;
+        modeChanged = TRUE;
         // update hardware depending on the mode
         _updateHardwareSetupForGeneration();
     }
     
-    if (manualState == 0) {
-        // desired level is LOW
-        if (generatorState == GEN_STATE_MANUAL_LOW) {
-            // if the state is the same, toggle clock once
-            leds_setState(LEDS_MANUAL_GREEN);
-            GENERATOR_OUT_PIN = 1;
-            _toggleDelay();
+    if (!modeChanged && manualState == generatorState) {
+        // if the state is the same, toggle clock once (or queue the toggle)
+        CCP1IE = 0;
+        if (pulsePhase == PULSE_IDLE) {
+            _startPulse();
+        } else {
+            if (pulsesQueued < 0xFF) {
+                pulsesQueued++;
+            }
+            CCP1IE = 1;
         }
+        return;
+    }
+
+    _stopPulse();
+    if (manualState == 0) {
         // set state low
-        generatorState = GEN_STATE_MANUAL_LOW;
-        leds_setState(LEDS_MANUAL_RED);
-        GENERATOR_OUT_PIN = 0;
-    } else {
-        // desired level is HIGH
         if (generatorState == GEN_STATE_MANUAL_HIGH) {
-            // if the state is the same, toggle clock once
-            leds_setState(LEDS_MANUAL_RED);
-            GENERATOR_OUT_PIN = 0;
-            _toggleDelay();
+            cycleCount++;
         }
+        generatorState = GEN_STATE_MANUAL_LOW;
+        _setOutput(0);
+    } else {
         // set state high
         generatorState = GEN_STATE_MANUAL_HIGH;
-        leds_setState(LEDS_MANUAL_GREEN);
-        GENERATOR_OUT_PIN = 1;
+        _setOutput(1);
+    }
+}
+
+/**
+ * Select the width of the manual pulse
+ * @param width
+ */
+void generator_setPulseWidth(pulse_width_t width)
+{
+    if (width < PULSE_WIDTH_COUNT) {
+        pulseWidth = width;
+    }
+}
+
+/**
+ * 
+ * @return pulse_width_t
+ */
+pulse_width_t generator_getPulseWidth(void)
+{
+    return pulseWidth;
+}
+
+/**
+ * Number of cycles of the next burst
+ * @param cycles
+ */
+void generator_setBurstCycles(uint16_t cycles)
+{
+    if (cycles != 0) {
+        burstCycles = cycles;
+    }
+}
+
+/**
+ * 
+ * @return uint16_t
+ */
+uint16_t generator_getBurstCycles(void)
+{
+    return burstCycles;
+}
+
+/**
+ * Falling edges since power-on, called from the main loop
+ * @return uint32_t
+ */
+uint32_t generator_getCycles(void)
+{
+    uint32_t cycles;
+
+    di();
+    cycles = cycleCount;
+    ei();
+    return cycles;
+}
+
+/**
+ * Emit burstCycles cycles at the current frequency, then stop LOW in
+ * manual mode. Dithered fast steps have no fixed period and fast bursts
+ * shorter than the stop interrupt latency can not be timed, both are
+ * ignored.
+ */
+void generator_startBurst(void)
+{
+    const frequency_setup_t * setup = &frequencyTable[generatorFrequency];
+    uint32_t ticks = 0;
+
+    if (generatorFrequency > FREQ_SLOW_LAST) {
+        ticks = _fastBurstTicks(setup);
+        if (setup->fraction != 0 || ticks < BURST_START_DELAY_TCY + BURST_START_MARGIN_TCY) {
+            return;
+        }
     }
+
+    // stop whatever runs, output low
+    generatorMode = GEN_MODE_MANUAL;
+    _updateHardwareSetupForGeneration();
+    _setOutput(0);
+    generatorMode = GEN_MODE_BURST;
+    generatorFlags.burstDone = 0;
+
+    if (generatorFrequency <= FREQ_SLOW_LAST) {
+        burstRemaining = burstCycles;
+        _updateHardwareSetupForGeneration();
+    } else {
+        _prepareSetup();
+        _startFastBurst(setup, ticks);
+    }
+}
+
+/**
+ * TMR1 ticks from the start of a fast burst to the last overflow, the
+ * overflow falls in the middle of period burstCycles.
+ */
+static uint32_t _fastBurstTicks(const frequency_setup_t * setup)
+{
+    // T2CKPS 00 = 1:1, 01 = 1:4, 1x = 1:16
+    uint8_t prescale = (uint8_t)(1 << ((setup->timerControl & 0x03) << 1));
+    uint16_t period = (uint16_t)(setup->period + 1) * prescale;
+
+    // the first period starts with the first TMR2 tick
+    return (uint32_t)(burstCycles - 1) * period + (period >> 1)
+        + prescale + BURST_START_DELAY_TCY - BURST_STOP_LATENCY_TCY;
+}
+
+/**
+ * Fast burst - PWM from the table, TMR1 times the burst in Tcy
+ */
+static void _startFastBurst(const frequency_setup_t * setup, uint32_t ticks)
+{
+    burstOverflows = (uint16_t)((ticks - 1) >> 16) + 1;
+
+    // PWM ready, TMR2 stopped at PR2 - the first tick starts a period
+    T2CON = 0;
+    PR2 = setup->period;
+    TMR2 = setup->period;
+    CCPR1L = stepSetup.duty[0].dutyCycle;
+    _setPhase(0);
+    CCP1CON = stepSetup.duty[0].ccpControl;
+    PWM1CON = _pwmDeadBand(setup, &stepSetup.duty[0]);
+    generatorState = GEN_STATE_FAST_AUTO;
+
+    if (burstOverflows == 1) {
+        // nothing may delay the interrupt of the last overflow
+        T0IE = 0;
+    }
+    TMR1 = (uint16_t)(0 - ticks);
+    TMR1IF = 0;
+    TMR1IE = 1;
+
+    T1CON = 0b00000001;
+    _delay(BURST_START_DELAY_TCY);
+    T2CON = setup->timerControl;
 }
 
 /**
@@ -353,9 +1315,9 @@ void generator_setManualState(uint8_t manualState)
  */
 void generator_increaseFrequency(void)
 {
-    if (generatorFrequency < FREQ_2MHz) {
+    if (generatorFrequency < FREQ_COUNT - 1) {
         generatorFrequency++;
-        _updateHardwareSetupForGeneration();
+        _changeSetup();
     }
 }
 
@@ -364,9 +1326,180 @@ void generator_increaseFrequency(void)
  */
 void generator_decreaseFrequency(void)
 {
-    if (generatorFrequency > FREQ_500mHz) {
+    if (generatorFrequency > 0) {
         generatorFrequency--;
-        _updateHardwareSetupForGeneration();
+        _changeSetup();
+    }
+}
+
+/**
+ * Select a step directly, the auto mode switches to it like on a button
+ * press. In the other modes the step is used by the next auto mode or
+ * burst.
+ * @param frequency
+ */
+void generator_setFrequency(uint8_t frequency)
+{
+    if (frequency >= FREQ_COUNT || frequency == generatorFrequency) {
+        return;
+    }
+    generatorFrequency = frequency;
+    _changeSetup();
+}
+
+/**
+ * 
+ * @return uint8_t
+ */
+uint8_t generator_getFrequency(void)
+{
+    return generatorFrequency;
+}
+
+/**
+ * High time in percent of the period, the auto mode switches to it like
+ * to a new step. The slow steps keep every half period above the serial
+ * hold-off, the PWM at least one duty cycle step high and low.
+ * @param percent DUTY_MIN .. DUTY_MAX
+ */
+void generator_setDuty(uint8_t percent)
+{
+    if (percent < DUTY_MIN || percent > DUTY_MAX || percent == generatorDuty) {
+        return;
+    }
+    generatorDuty = percent;
+    _changeSetup();
+}
+
+/**
+ * 
+ * @return uint8_t
+ */
+uint8_t generator_getDuty(void)
+{
+    return generatorDuty;
+}
+
+/**
+ * High and low time of the current step at the current duty cycle, as
+ * generated - after the limits, to the nearest timer tick. A dithered
+ * PWM step reports its shorter period.
+ * @param high  Tosc (125 ns)
+ * @param low   Tosc (125 ns)
+ */
+void generator_getTimes(uint32_t * high, uint32_t * low)
+{
+    const frequency_setup_t * setup = &frequencyTable[generatorFrequency];
+    uint8_t shift;
+
+    if (generatorFrequency > FREQ_SLOW_LAST) {
+        pwm_duty_t duty;
+        _preparePwm(&duty, setup->period, generatorDuty);
+        // duty cycle steps of Tosc * prescaler (T2CKPS 00 = 1:1, 01 = 1:4, 1x = 1:16)
+        uint16_t steps = ((uint16_t)setup->period + 1) << 2;
+        uint16_t value = ((uint16_t)duty.dutyCycle << 2) | ((duty.ccpControl >> 4) & 0x03);
+        shift = (uint8_t)((setup->timerControl & 0x03) << 1);
+        *high = (uint32_t)value << shift;
+        *low = (uint32_t)(steps - value) << shift;
+        if (phaseDead != 0) {
+            // the dead band delays the rising edge of RC5
+            uint8_t band = _pwmDeadBand(setup, &duty);
+            *high -= (uint32_t)band << 2;
+            *low += (uint32_t)band << 2;
+        }
+        return;
+    }
+
+    // TMR1 ticks of Tcy * prescaler (T1CKPS), Tcy = 4 Tosc
+    shift = (uint8_t)(((setup->timerControl >> 4) & 0x03) + 2);
+    uint16_t scale = _slowScale(setup);
+    for (uint8_t i = 0; i < 2; i++) {
+        slow_half_t half;
+        _prepareHalf(&half, setup, i ? scale : (uint16_t)(0 - scale));
+        uint32_t ticks = (uint32_t)half.step * half.chunks
+            + (((uint32_t)half.fraction * half.chunks + 0x8000) >> 16);
+        *(i ? high : low) = ticks << shift;
     }
 }
 
+/**
+ * Two-phase output with deadTime Tcy between the phases, 0 - RC5 only.
+ * The auto mode switches to it like to a new step.
+ * @param deadTime
+ */
+void generator_setDeadTime(uint8_t deadTime)
+{
+    if (GENERATOR_PHASE_MASK == 0 || deadTime > GENERATOR_DEAD_MAX || deadTime == phaseDead) {
+        return;
+    }
+    phaseDead = deadTime;
+    _changeSetup();
+}
+
+/**
+ * 
+ * @return uint8_t
+ */
+uint8_t generator_getDeadTime(void)
+{
+    return phaseDead;
+}
+
+/**
+ * The setting on a PWM step, limited to half the shorter phase. A slow
+ * step keeps at least the setting, the interrupt latency decides how much
+ * of the guard is left.
+ * @return uint32_t Tosc (125 ns)
+ */
+uint32_t generator_getStepDeadTime(void)
+{
+    if (generatorFrequency > FREQ_SLOW_LAST && phaseDead != 0) {
+        const frequency_setup_t * setup = &frequencyTable[generatorFrequency];
+        pwm_duty_t duty;
+        _preparePwm(&duty, setup->period, generatorDuty);
+        return (uint32_t)_pwmDeadBand(setup, &duty) << 2;
+    }
+    return (uint32_t)phaseDead << 2;
+}
+
+/**
+ * A running PWM step takes PRSEN right away, a slow one reads the setting
+ * at the next halt
+ * @param enable
+ */
+void generator_setHaltResume(uint8_t enable)
+{
+    generatorFlags.haltResume = (enable != FALSE);
+    PRSEN = generatorFlags.haltResume;
+}
+
+/**
+ * 
+ * @return uint8_t
+ */
+uint8_t generator_getHaltResume(void)
+{
+    return generatorFlags.haltResume;
+}
+
+/**
+ * A running slow step switches at its next edge, like a new step
+ * @param enable
+ */
+void generator_setLowClock(uint8_t enable)
+{
+    if ((enable != FALSE) == generatorFlags.lowClock) {
+        return;
+    }
+    generatorFlags.lowClock = (enable != FALSE);
+    _changeSetup();
+}
+
+/**
+ * 
+ * @return uint8_t
+ */
+uint8_t generator_getLowClock(void)
+{
+    return generatorFlags.lowClock;
+}
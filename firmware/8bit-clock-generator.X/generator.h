@@ -12,9 +12,35 @@
 extern "C" {
 #endif
     
-#define GENERATOR_OUT_PIN               RC5
+#define GENERATOR_OUT_MASK              0b00100000      // RC5 in PORTC
+#ifndef GENERATOR_TRACE
+#define GENERATOR_PHASE_MASK            0b00010000      // RC4 in PORTC, second phase
+#else
+#define GENERATOR_PHASE_MASK            0               // RC4 is the trace pin
+#endif
+// longest two-phase dead time, PWM1CON PDC in Tcy
+#define GENERATOR_DEAD_MAX              127
+// CCP1CON that gives RC5 back to its PORTC latch - compare, CCP1IF only
+#define GENERATOR_CCP1_RELEASE          0b00001010
     
 
+// one-bit state of the engines, one byte asked for in common RAM
+// (__near) - the INT branch tests slowEngine and haltHeld first. Single
+// bits are set and cleared by BSF / BCF, the ISR and the main loop share
+// the byte.
+typedef struct {
+    uint8_t slowEngine : 1;     // slow auto step running - RC5 is the CCP1 compare output, its latch LOW
+    uint8_t switchPending : 1;  // frequency change the running engine still has to make
+    uint8_t halvesBusy : 1;     // the prepared step is not the running slow step
+    uint8_t phaseHigh : 1;      // RC4 level of the running slow step, restored after a halt
+    uint8_t haltResume : 1;     // nHALT holds the auto mode instead of stopping it
+    uint8_t haltHeld : 1;       // nHALT holds it now
+    uint8_t lowClock : 1;       // slow steps may run the core below 8 MHz
+    uint8_t burstDone : 1;      // the last cycle of a burst ended
+} generator_flags_t;
+
+extern __near volatile generator_flags_t generatorFlags;
+
 typedef enum {
     GEN_STATE_MANUAL_LOW = 0,
     GEN_STATE_MANUAL_HIGH,
@@ -25,15 +51,59 @@ typedef enum {
 
 typedef enum {
     GEN_MODE_MANUAL,
-    GEN_MODE_AUTO
+    GEN_MODE_AUTO,
+    GEN_MODE_BURST
 } generator_mode_t;
 
-inline void generator_timer1Callback(void);
+typedef enum {
+    PULSE_WIDTH_1us = 0,
+    PULSE_WIDTH_10us,
+    PULSE_WIDTH_100us,
+    PULSE_WIDTH_1ms,
+    PULSE_WIDTH_10ms,
+    PULSE_WIDTH_100ms,
+    PULSE_WIDTH_COUNT
+} pulse_width_t;
 
 /**
- * 
+ * CCP1 compare match, called from the ISR
+ */
+inline void generator_compareCallback(void);
+
+/**
+ * TMR2 postscaler match of a dithered PWM step, called from the ISR
+ */
+inline void generator_ditherCallback(void);
+
+/**
+ * TMR1 overflow of a fast burst, called from the ISR
+ * @return TRUE at the last overflow, the burst is done
+ */
+inline uint8_t generator_burstCallback(void);
+
+/**
+ * nHALT edge, called from the ISR. Holds or releases the auto mode when
+ * the resumable halt is on.
+ * @return FALSE when the ISR has to stop the generator
+ */
+inline uint8_t generator_haltCallback(void);
+
+/**
+ * Slow output edge, called from the main loop
+ */
+void generator_clockEdgeCallback(void);
+
+/**
+ * Set the LEDs from the generator state, called at the TMR0 tick rate
+ */
+void generator_refreshLeds(void);
+
+/**
+ * Start in the mode of the last session, its settings are set before
+ * (settings_load())
+ * @param mode
  */
-inline void generator_init(void);
+inline void generator_init(generator_mode_t mode);
 
 /**
  * 
@@ -45,6 +115,21 @@ void generator_toggleMode(void);
  */
 inline generator_mode_t generator_getMode(void);
 
+/**
+ * 
+ */
+generator_state_t generator_getState(void);
+
+/**
+ * Nothing is generated and no manual pulse is pending
+ */
+uint8_t generator_isIdle(void);
+
+/**
+ * The auto mode is held LOW by nHALT and resumes when it rises
+ */
+uint8_t generator_isHeld(void);
+
 /**
  * 
  */
@@ -66,6 +151,39 @@ void generator_stop(void);
  */
 void generator_setManualState(uint8_t manualState);
 
+/**
+ * Width of the manual mode pulse (button pressed at the current level)
+ * @param width
+ */
+void generator_setPulseWidth(pulse_width_t width);
+
+/**
+ * 
+ */
+pulse_width_t generator_getPulseWidth(void);
+
+/**
+ * Number of cycles emitted by generator_startBurst()
+ * @param cycles
+ */
+void generator_setBurstCycles(uint16_t cycles);
+
+/**
+ * 
+ */
+uint16_t generator_getBurstCycles(void);
+
+/**
+ * Falling edges of the clock output since power-on, a running PWM step
+ * is not counted
+ */
+uint32_t generator_getCycles(void);
+
+/**
+ * Emit a burst of cycles at the current frequency, then stop LOW
+ */
+void generator_startBurst(void);
+
 /**
  * 
  */
@@ -76,6 +194,84 @@ void generator_increaseFrequency(void);
  */
 void generator_decreaseFrequency(void);
 
+/**
+ * Select a frequency step, used right away in the auto mode
+ * @param frequency
+ */
+void generator_setFrequency(uint8_t frequency);
+
+/**
+ * 
+ */
+uint8_t generator_getFrequency(void);
+
+/**
+ * High time in percent of the period (1 - 99), 50 at power-on
+ * @param percent
+ */
+void generator_setDuty(uint8_t percent);
+
+/**
+ * 
+ * @return uint8_t
+ */
+uint8_t generator_getDuty(void);
+
+/**
+ * Generated high and low time of the current step, in Tosc (125 ns)
+ * @param high
+ * @param low
+ */
+void generator_getTimes(uint32_t * high, uint32_t * low);
+
+/**
+ * Two-phase output: RC4 (P1B) is the complement of RC5 (P1A), each phase
+ * rises deadTime Tcy after the other one fell. 0 - single output, RC4
+ * stays LOW. Not available in GENERATOR_TRACE builds.
+ * @param deadTime 0 .. GENERATOR_DEAD_MAX
+ */
+void generator_setDeadTime(uint8_t deadTime);
+
+/**
+ * 
+ * @return uint8_t
+ */
+uint8_t generator_getDeadTime(void);
+
+/**
+ * Dead time of the current step as generated, in Tosc (125 ns)
+ * @return uint32_t
+ */
+uint32_t generator_getStepDeadTime(void);
+
+/**
+ * Resumable halt: nHALT holds the auto mode LOW and it continues at the
+ * same step and phase when nHALT rises. Off - nHALT stops the generator
+ * in manual LOW. A pulse or a burst is always stopped.
+ * @param enable
+ */
+void generator_setHaltResume(uint8_t enable);
+
+/**
+ * 
+ * @return uint8_t
+ */
+uint8_t generator_getHaltResume(void);
+
+/**
+ * Low clock: the slow steps up to 10 Hz run the core at 1 - 4 MHz with the
+ * same output timing. The serial port is off while the clock is low - a
+ * step from 20 Hz up or the manual mode bring it back. Not saved.
+ * @param enable
+ */
+void generator_setLowClock(uint8_t enable);
+
+/**
+ * 
+ * @return uint8_t
+ */
+uint8_t generator_getLowClock(void);
+
 
 #ifdef	__cplusplus
 }
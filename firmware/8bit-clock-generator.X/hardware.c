@@ -8,38 +8,51 @@
 #include <xc.h>
 #include "hardware.h"
 
+// PORTC output latch - PORTC reads return the pins, RC5 may be driven by
+// CCP1, so the latch is never read back from the port
+static uint8_t portcShadow = 0;
+
+// OSCCON at 8 MHz (IRCF 111), OPTION_REG PS of the button tick at 8 MHz
+// (1:256), IOCA bit of the serial RX
+#define OSCCON_8MHZ                 0b01110000
+#define OPTION_PS_TICK              0b00000111
+#define IOCA_SERIAL_RX              0b00000010
+
+volatile uint8_t hardwareClockShift = 0;
+
 inline void harware_init(void)
 {
     // setup clock
     //          111             IRCF=b111   8MHz internal OSC
     //             xxx
     //                1         SCS=1       Internal oscillator is used for system clock
-    OSCCON = 0b01110000;
+    OSCCON = OSCCON_8MHZ;
     
     // disable analog hardware
     CMCON0  = 0x07;             // Comparators off. CxIN pins are configured as digital I/O
     ANSEL   = 0;                // digital I/O for all pins on PORTA and PORTC
     
     // setup PORT A functions
-    PORTA   = 0;                // clear PORTA value
+    PORTA   = 0b00000001;       // clear PORTA value, serial TX idles high
     //            1             RA5 in      Button UP
     //             1            RA4 in      Button DOWN
     //              1           RA3 in      HALT signal
     //               1          RA2 in      Button MODE
-    //                1         RA1 in      ICSP
-    //                 1        RA0 in      ICSP
-    TRISA   = 0b00111111;       // set A0-A5 as inputs
+    //                1         RA1 in      ICSP / serial RX
+    //                 0        RA0 out     ICSP / serial TX
+    TRISA   = 0b00111110;       // set A1-A5 as inputs
     WPUA    = 0b00110111;       // enable pullups on A5,A4,A2
     IOCA    = 0b00000000;       // setup interrupt on change - OFF
     
     // setup PORT C functions
     PORTC   = 0;                // clear PORTC value
     //            0             RC5 out     CCP1 - generator out signal
+    //             0            RC4 out     P1B - second phase (trace in GENERATOR_TRACE builds)
     //              0           RC3 out     LED Auto (green)
     //               0          RC2 out     LED Auto (red)
     //                0         RC1 out     LED Manual (green)
     //                 0        RC0 out     LED Manual (red)
-    TRISC   = 0b11010000;       // set C0-C3 as outputs for LEDs, C5 - out for CCP1
+    TRISC   = 0b11000000;       // set C0-C3 as outputs for LEDs, C4/C5 - out for P1B/P1A
     
     // configure TIMER0 module, pull-ups, INT signal
     TMR0 = 0;                   // reset counter
@@ -55,13 +68,103 @@ inline void harware_init(void)
     //              0           TMR1IE=0    enable timer 1 interrupt
     PIE1 = 0b00000000;
     
-    // setup interrupt on change
-    //           0              IOCA3=0     disable IOC on RA3    
-    IOCA = 0b00000000;
+    // setup interrupt on change - serial start bit, the first edge of a
+    // button is acted on right away and wakes the core from SLEEP
+    //            1             IOCA5=1     button DOWN
+    //             1            IOCA4=1     button UP
+    //              1           IOCA3=1     button MODE
+    //                1         IOCA1=1     serial RX
+    IOCA = 0b00111010;
+    (void)PORTA;                // no mismatch at start
     
     // enable interrupts
     //          1               PEIE=1      enable peripheral int
     //           1              T0IE=1      enable TMR0 int
     //            1             INTE        enable INT int
-    INTCON = 0b01110000;
-}
\ No newline at end of file
+    //              1           RAIE        enable interrupt on change
+    INTCON = 0b01111000;
+}
+
+/**
+ * Called with the interrupts disabled and the serial port idle. The core
+ * wakes up on INT (nHALT), a button change, a serial start bit or the end
+ * of an EEPROM write and continues after SLEEP, the pending interrupt is serviced when the caller
+ * enables the interrupts again. All timers stop in SLEEP.
+ * RAIE is set while the port is idle, a RAIF set here is a change after
+ * the caller disabled the interrupts - a start bit is not slept over.
+ */
+void hardware_sleep(void)
+{
+    (void)PORTA;                // latch the pins, ends an old IOC mismatch
+    if (RAIF) {
+        return;
+    }
+    RAIE = 1;
+    // a running EEPROM write goes on in SLEEP and wakes the core with EEIF
+    EEIF = 0;
+    EEIE = WR;
+    SLEEP();
+    NOP();                      // prefetched, executed on the wake-up
+    EEIE = 0;
+}
+
+/**
+ * IRCF and PS both count in powers of 2, one shift lowers both. The
+ * HFINTOSC keeps running, the postscaler switches without a stop.
+ * OPTION_REG and IOCA are read-modify-written with the interrupts
+ * disabled, the ISR writes them too.
+ * @param shift
+ */
+void hardware_setClock(uint8_t shift)
+{
+    uint8_t gie;
+
+    if (shift == hardwareClockShift) {
+        return;
+    }
+    hardwareClockShift = shift;
+    gie = GIE;
+    di();
+    OSCCON = (uint8_t)(OSCCON_8MHZ - (shift << 4));
+    OPTION_REG = (uint8_t)((OPTION_REG & (uint8_t)~OPTION_PS_TICK) | (OPTION_PS_TICK - shift));
+    if (shift == 0) {
+        (void)PORTA;            // no mismatch of the RA1 traffic missed
+        IOCA |= IOCA_SERIAL_RX;
+    } else {
+        IOCA &= (uint8_t)~IOCA_SERIAL_RX;
+    }
+    if (gie) {
+        ei();
+    }
+}
+
+/**
+ * Update the bits of the PORTC latch in mask, an unchanged latch is not
+ * written. Called from the main loop and from the ISR, the main loop part
+ * runs with the interrupts disabled.
+ */
+void hardware_writePortC(uint8_t mask, uint8_t value)
+{
+    uint8_t gie = GIE;
+    uint8_t latch;
+
+    di();
+    latch = (portcShadow & (uint8_t)~mask) | (value & mask);
+    if (latch != portcShadow) {
+        portcShadow = latch;
+        PORTC = latch;
+    }
+    if (gie) {
+        ei();
+    }
+}
+
+/**
+ * The interrupts are off in the ISR, the latch is written at once
+ * @param mask
+ */
+inline void hardware_clearPortCCallback(uint8_t mask)
+{
+    portcShadow &= (uint8_t)~mask;
+    PORTC = portcShadow;
+}
@@ -12,11 +12,44 @@
 extern "C" {
 #endif
 
+// core clock 8 MHz >> shift, HFINTOSC postscaler (IRCF 111 - shift). The
+// serial port only runs at 8 MHz.
+#define HARDWARE_CLOCK_SHIFT_MAX    3           // 1 MHz
 
+extern volatile uint8_t hardwareClockShift;
 
 
 inline void harware_init(void);
 
+/**
+ * Write the PORTC bits selected by mask, the only way PORTC is written
+ * @param mask
+ * @param value
+ */
+void hardware_writePortC(uint8_t mask, uint8_t value);
+
+/**
+ * Clear the PORTC bits in mask, called from the ISR - no GIE save and
+ * restore around the latch
+ * @param mask
+ */
+inline void hardware_clearPortCCallback(uint8_t mask);
+
+/**
+ * Stop the core until a button, the nHALT input or the serial RX changes,
+ * or the running EEPROM write is done
+ */
+void hardware_sleep(void);
+
+/**
+ * Core clock 8 MHz >> shift. The TMR0 prescaler follows, the button tick
+ * stays at 32.768 ms. Every other timer counts Tcy of the new clock - it
+ * is switched with TMR1 stopped and TMR2 unused. Below 8 MHz the RA1
+ * start bit interrupt is off.
+ * @param shift 0 - HARDWARE_CLOCK_SHIFT_MAX
+ */
+void hardware_setClock(uint8_t shift);
+
 
 #ifdef	__cplusplus
 }
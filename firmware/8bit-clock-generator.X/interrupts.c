@@ -6,44 +6,253 @@
  */
 
 #include <xc.h>
+#include "types.h"
 #include "interrupts.h"
+#include "buttons.h"
+#include "calibration.h"
 #include "generator.h"
+#include "hardware.h"
+#include "uart.h"
+#include "trace.h"
 
 
-volatile interrupt_flags_t interrupt_flags = {
-    .readButtons = 0,
-    .stopGenerator = 0,
-    .timer1Overflow = 0
-};
+__near volatile uint8_t eventsRaised[EVENT_BYTES];
+uint8_t eventsTaken[EVENT_BYTES];
+volatile uint8_t eventsDropped = 0;
+static uint8_t eventsLate = 0;
 
-volatile uint16_t timer1StartValue = 0;
 
+/**
+ * Catch up with the ISR - the byte raised is read at once. The nibble of
+ * the other source in eventsTaken is kept, the ISR never sees the byte
+ * half written.
+ * @param event
+ * @return uint8_t
+ */
+uint8_t interrupt_take(interrupt_event_t event)
+{
+    uint8_t raised = EVENT_NIBBLE(eventsRaised, event);
+    uint8_t pending = (uint8_t)(raised - EVENT_NIBBLE(eventsTaken, event)) & 0x0F;
+
+    if (event & 1) {
+        eventsTaken[event >> 1] = (uint8_t)((eventsTaken[event >> 1] & 0x0F) | (raised << 4));
+    } else {
+        eventsTaken[event >> 1] = (uint8_t)((eventsTaken[event >> 1] & 0xF0) | raised);
+    }
+    if (pending > 1) {
+        uint8_t late = (uint8_t)(eventsLate + pending - 1);
+        eventsLate = (late < eventsLate) ? 0xFF : late;
+    }
+    return pending;
+}
+
+/**
+ * 
+ * @return uint8_t
+ */
+uint8_t interrupt_getLate(void)
+{
+    return eventsLate;
+}
+
+/**
+ * One byte written by the ISR, read at once
+ * @return uint8_t
+ */
+uint8_t interrupt_getDropped(void)
+{
+    return eventsDropped;
+}
 
 /**
- * Interrupt routine
+ * RA1 / RA3-RA5 interrupt on change (called from the ISR), the start bit
+ * first. PORTA is read once for all of them.
+ */
+static inline void _portChange(void)
+{
+    uint8_t port;
+
+    TRACE_BEGIN();
+    port = PORTA;
+    uart_edgeCallback(port);
+    if (calibrationArmed) {
+        calibration_edgeCallback(port);
+    }
+    if ((port & BUTTONS_MASK) != BUTTONS_MASK) {
+        INTERRUPT_RAISE(EVENT_BUTTON);      // main loop acts on it right away
+    }
+    TRACE_END(TRACE_SERIAL);
+}
+
+/**
+ * Interrupt routine. INT and TMR1 come first for their latency, not their
+ * rate: nHALT stops the output within 20 us and the last burst overflow
+ * is timed to the cycle. The rest is ordered by rate - the RA1 start bit
+ * reloads TMR0 ahead of the bit clock it starts (38400 / s while a frame
+ * is on the line), then the engine interrupts (CCP1 for a slow step or
+ * TMR2 for a dithered fast one, never both) and the 30 Hz button tick
+ * last. The stop and the engine branches return at once, a flag still
+ * set enters again - cheaper than testing every flag after each of them.
+ * The cycles of every branch are checked against a budget in the cost
+ * model of the simulator (sim/bench.c), not in the XC8 listing.
  */
 void __interrupt() ISR(void)    
 {
-    // external INT signal - HALT the generator
+    uint8_t peripherals;
+
+    // external INT signal - HALT the generator, or hold / release a
+    // resumable halt
     if (INTF) {
-        RC5 = 0;            // set output low
-        T2CON = 0;          // stop timer 2
-        T1CON = 0;          // stop timer 1
-        CCP1CON = 0;        // stop CCP
+        TRACE_BEGIN();
+        // the compare modes have no auto-shutdown - a slow step drops RC5
+        // to its LOW latch first
+        if (generatorFlags.slowEngine) {
+            CCP1CON = GENERATOR_CCP1_RELEASE;
+        }
         INTF = 0;
-        interrupt_flags.stopGenerator = 1;        // set flag to stop generator
+        if (!generator_haltCallback()) {
+            hardware_clearPortCCallback(GENERATOR_OUT_MASK | GENERATOR_PHASE_MASK);  // set outputs low
+            T2CON = 0;          // stop timer 2
+            T1CON = 0;          // stop timer 1
+            CCP1CON = 0;        // stop CCP
+            CCP1IF = 0;         // no compare or dither update after the stop
+            TMR2IE = 0;
+            INTERRUPT_RAISE(EVENT_STOP);        // main loop stops the generator
+            TRACE_END(TRACE_INT);
+            return;
+        }
+        TRACE_END(TRACE_INT);
     }
-    
-    // timer 1 interrupt
-    if (TMR1IF) {
+
+    // timer 1 overflow - fast burst, kept right after INT for a fixed latency
+    if (TMR1IE && TMR1IF) {
+        TRACE_BEGIN();
         TMR1IF = 0;
-        // call generator timer1 callback
-        interrupt_flags.timer1Overflow = 1;
+        TRACE_MARK();
+        if (generator_burstCallback()) {
+            INTERRUPT_RAISE(EVENT_EDGE);        // main loop ends the burst
+        }
+        TRACE_MARK();
+        TRACE_END(TRACE_TMR1);
+    }
+
+    // serial start bit, calibration reference or a button edge
+    if (RAIE && RAIF) {
+        _portChange();
+    }
+
+    // timer 0 as the serial bit clock, ahead of the peripherals. No return
+    // - the compare interrupt held over the bits of a character runs in
+    // the entry of its stop bit, the next start bit may come before another
+    // one.
+    peripherals = PEIE;
+    if (uartFlags.clocked && TMR0IF) {
+        TRACE_BEGIN();
+        peripherals = uart_bitCallback();
+        TRACE_END(TRACE_SERIAL);
+    }
+    
+    // CCP1 compare - slow generator, RC5 is switched by the hardware. Held
+    // by PEIE over the bits of a serial character.
+    if (peripherals && CCP1IF) {
+        TRACE_BEGIN();
+        CCP1IF = 0;
+        TRACE_MARK();
+        generator_compareCallback();
+        TRACE_MARK();
+        INTERRUPT_RAISE(EVENT_EDGE);
+        TRACE_END(TRACE_CCP1);
+        // a start bit that came during the compare - one more entry would
+        // read RA1 after it
+        if (RAIE && RAIF) {
+            _portChange();
+        }
+        return;
+    }
+    
+    // timer 2 postscaler - dithered fast generator, next PWM period
+    if (peripherals && TMR2IE && TMR2IF) {
+        TRACE_BEGIN();
+        TMR2IF = 0;
+        TRACE_MARK();
+        generator_ditherCallback();
+        TRACE_MARK();
+        TRACE_END(TRACE_TMR2);
+        if (RAIE && RAIF) {
+            _portChange();
+        }
+        return;
     }
     
     // timer 0 interrupt
     if (TMR0IF) {
+        TRACE_BEGIN();
         TMR0IF = 0;
-        interrupt_flags.readButtons = 1;          // set flag to read buttons
+        INTERRUPT_RAISE(EVENT_TICK);        // main loop reads the buttons
+        TRACE_END(TRACE_TMR0);
     }
 }
+
+#ifdef GENERATOR_TRACE
+
+trace_stat_t traceStats[TRACE_COUNT];
+
+// TMR1 at the start of the running branch, RC4 level
+static uint16_t traceStart;
+static uint8_t traceValid;
+static uint8_t tracePin;
+
+static void _traceSample(trace_slot_t slot, uint16_t sample)
+{
+    trace_stat_t * stat = &traceStats[slot];
+
+    if (sample > stat->max) {
+        stat->max = sample;
+    }
+    stat->avg = stat->avg - (stat->avg >> 3) + (sample >> 3);
+}
+
+/**
+ * ISR branch entry - RC4 high, TMR1 time stamp
+ */
+void trace_begin(void)
+{
+    tracePin = TRACE_PIN_MASK;
+    hardware_writePortC(TRACE_PIN_MASK, tracePin);
+    traceValid = TMR1ON;
+    traceStart = TMR1;
+}
+
+/**
+ * Toggle RC4 around a callback
+ */
+void trace_mark(void)
+{
+    tracePin ^= TRACE_PIN_MASK;
+    hardware_writePortC(TRACE_PIN_MASK, tracePin);
+}
+
+/**
+ * ISR branch exit - cycles since trace_begin(), RC4 low. No sample when
+ * TMR1 was stopped or reloaded by the branch.
+ */
+void trace_end(trace_slot_t slot)
+{
+    uint16_t now = TMR1;
+
+    if (traceValid && TMR1ON && now >= traceStart) {
+        _traceSample(slot, (uint16_t)((now - traceStart) << ((T1CON >> 4) & 0x03)));
+    }
+    tracePin = 0;
+    hardware_writePortC(TRACE_PIN_MASK, tracePin);
+}
+
+/**
+ * Main loop picks up the TMR0 tick - TMR0 counts since the overflow
+ */
+void trace_backlog(void)
+{
+    _traceSample(TRACE_MAIN, TMR0);
+}
+
+#endif
@@ -12,13 +12,89 @@
 extern "C" {
 #endif
 
-typedef struct {
-    uint8_t readButtons:1;
-    uint8_t stopGenerator:1;
-    uint8_t timer1Overflow:1;
-} interrupt_flags_t;
+// Work the ISR hands to the main loop. Each source counts its events
+// raised (ISR) against the ones taken (main loop) in a nibble, two
+// sources to a byte - one writer per byte, so neither side waits for the
+// other. Up to 15 events of a source are pending, one more is dropped and
+// counted.
+typedef enum {
+    EVENT_TICK = 0,             // TMR0 tick, 32.768 ms - buttons, settings, sweep
+    EVENT_EDGE,                 // slow compare match or the end of a fast burst
+    EVENT_STOP,                 // nHALT stopped the generator
+    EVENT_BUTTON,               // a button went down, RA3-RA5 interrupt on change
+    EVENT_REFERENCE,            // calibration reference edge on RA1
+    EVENT_COUNT
+} interrupt_event_t;
 
-extern volatile interrupt_flags_t interrupt_flags;
+// raised only by the ISR (or with the interrupts disabled), taken only by
+// the main loop. eventsRaised is written by nearly every ISR branch and
+// is asked for in common RAM (__near, -maddrqual=request), with the flags
+// the branches test: generatorFlags, uartFlags and calibrationArmed.
+// Common RAM is 16 bytes and XC8 keeps its interrupt context there, the
+// debug build also reserves 0x70. Whether all of them got a place - a
+// request XC8 can not meet is dropped - is only in the map file of a
+// build, none was checked.
+#define EVENT_BYTES                 ((EVENT_COUNT + 1) / 2)
+
+extern __near volatile uint8_t eventsRaised[EVENT_BYTES];
+extern uint8_t eventsTaken[EVENT_BYTES];
+extern volatile uint8_t eventsDropped;
+
+// count of a source, the odd ones in the high nibble
+#define EVENT_NIBBLE(counts, event) \
+    ((uint8_t)((counts)[(event) >> 1] >> (((event) & 1) << 2)) & 0x0F)
+
+/**
+ * Count an event unless 15 of the source are pending, from the ISR or
+ * with the interrupts disabled. No call - the serial bit interrupt raises
+ * the tick within its bit time. The low nibble wraps without a carry into
+ * the high one.
+ */
+#define INTERRUPT_RAISE(event) \
+    do { \
+        if (((uint8_t)(EVENT_NIBBLE(eventsRaised, event) - EVENT_NIBBLE(eventsTaken, event)) & 0x0F) != 0x0F) { \
+            if ((event) & 1) { \
+                eventsRaised[(event) >> 1] += 0x10; \
+            } else { \
+                eventsRaised[(event) >> 1] = (uint8_t)((eventsRaised[(event) >> 1] & 0xF0) \
+                    | ((eventsRaised[(event) >> 1] + 1) & 0x0F)); \
+            } \
+        } else if (eventsDropped != 0xFF) { \
+            eventsDropped++; \
+        } \
+    } while (0)
+
+/**
+ * Take all pending events of a source, called from the main loop. All
+ * but one of them waited for a later one and count as late.
+ * @param event
+ * @return events since the last take, 0 - none
+ */
+uint8_t interrupt_take(interrupt_event_t event);
+
+/**
+ * Any event not taken yet - the core may not SLEEP. No call or loop, it is
+ * tested with the interrupts disabled and the serial bit interrupt waits.
+ * The unused nibble of the last byte stays 0 on both sides.
+ */
+#define INTERRUPT_IS_PENDING() \
+    (eventsRaised[0] != eventsTaken[0] \
+        || eventsRaised[1] != eventsTaken[1] \
+        || eventsRaised[2] != eventsTaken[2])
+
+/**
+ * Events the main loop took only after a later one of the same source,
+ * since power-on - it fell behind. Stops at 255.
+ * @return uint8_t
+ */
+uint8_t interrupt_getLate(void);
+
+/**
+ * Events lost with 15 of their source pending, since power-on. Stops at
+ * 255.
+ * @return uint8_t
+ */
+uint8_t interrupt_getDropped(void);
 
 #ifdef	__cplusplus
 }
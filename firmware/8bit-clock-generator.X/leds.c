@@ -7,6 +7,7 @@
 
 #include <xc.h>
 #include "leds.h"
+#include "hardware.h"
 
 // LEDs are connected on port bits 3-0
 #define LEDS_MASK               0x0F
@@ -17,8 +18,6 @@
  */
 void leds_setState(leds_state_t state)
 {
-    // first MASK the PORT value,
-    // then 'OR' the bits for the enabled LEDs
-    // depending on the state structure
-    PORTC = (PORTC & ~LEDS_MASK) | state;
+    // only the LED bits of the PORTC latch, RC5 is left alone
+    hardware_writePortC(LEDS_MASK, state);
 }
@@ -9,25 +9,45 @@
  * ****************************
  *
  * This project implements a clock generator with two operational modes:
- * Manual Mode and Auto Mode, controlled via the "mode" button.
+ * Manual Mode and Auto Mode, toggled by a click on the "mode" button.
  *
  * Behavior:
  * - Manual Mode:
  *   - "+/high" button: Sets the output clock HIGH.
  *   - "-/low" button: Sets the output clock LOW.
  *   - If the output clock is already in the desired state, clicking the respective button toggles
- *     the clock state momentarily before returning to the desired level.
+ *     the clock state momentarily before returning to the desired level. The pulse is timed by
+ *     TMR1 + CCP1 (1us - 100ms, default 10ms), clicks during a pulse are queued.
  *
  * - Auto Mode:
  *   - "+/high" button: Increases the output frequency to the next higher standard frequency.
  *   - "-/low" button: Decreases the output frequency to the next lower standard frequency.
- *   - Standard frequencies:
- *          1Hz, 4Hz, 20Hz, 100Hz, 500Hz,
- *          2KHz, 10KHz, 50KHz, 200KHz,
+ *   - Standard frequencies (1-2-5 ladder, see frequencies.h):
+ *          10mHz, 20mHz, 50mHz, 100mHz, 200mHz, 500mHz,
+ *          1Hz, 2Hz, 5Hz, 10Hz, 20Hz, 50Hz, 100Hz, 200Hz, 500Hz,
+ *          1KHz, 2KHz, 5KHz, 10KHz, 20KHz, 50KHz, 100KHz, 200KHz, 500KHz,
  *          1MHz, 2MHz.
+ *     Power-on frequency is 2Hz, or the one saved in the EEPROM.
+ *
+ * - Burst:
+ *   - holding "mode" emits 64 cycles at the selected frequency and stops in manual LOW,
+ *     the cycle count is exact on every non-dithered step up to 2MHz.
  *
  * Additional Features:
  * - Halt Signal: An active LOW input halts the generator and sets the clock output to manual LOW state.
+ *   With the resumable halt (serial r1) it only holds the auto mode LOW, the clock continues at the same
+ *   step and phase when the input rises. The buttons are ignored and serial commands wait while it is held.
+ * - Serial port: 38400 baud 8N1 on RA1 (RX) / RA0 (TX), one command per line (CR or LF), see _serialCommand().
+ * - Duty cycle: 1 - 99 % of the period over the serial port, 50 % at power-on. A slow half period
+ *   stays above the serial hold-off (see generator.c), the PWM keeps at least one step high and low.
+ * - Two-phase output: RC4 the complement of RC5 with a dead time between the phases, ECCP half-bridge
+ *   on the PWM steps, emulated by the compare interrupt on the slow steps.
+ * - Sweep: over the serial port the auto mode steps up the table from the current step with a dwell on
+ *   each one, until nHALT or a takeover fails a step - the step below it is kept (see sweep.h).
+ * - Calibration: over the serial port the internal oscillator is trimmed (OSCTUNE) against a 1 Hz
+ *   reference on RA1, the trim is kept in the data EEPROM (see calibration.h).
+ * - Settings: mode, frequency, duty cycle, dead time, halt resume, pulse width and burst length are kept
+ *   in the data EEPROM and restored at power-on, a change is saved once it stayed for about 2 seconds (see settings.h).
  *
  * Microcontroller IC: PIC16F684 (14 pin PDIP 8-bit microcontroller)
  * Documentation: https://ww1.microchip.com/downloads/en/DeviceDoc/41202F-print.pdf
@@ -42,14 +62,14 @@
  * PIN 3    RA4 - Button up             (internal pullup)
  * PIN 4    RA3 - Button MODE           (external pullup)
  * PIN 5    RC5 - CLK out
- * PIN 6    RC4 -
+ * PIN 6    RC4 - CLK out, second phase (trace out in GENERATOR_TRACE builds)
  * PIN 7    RC3 - LED Auto (green)
  * PIN 8    RC2 - LED Auto (red)
  * PIN 9    RC1 - LED Manual (green)
  * PIN 10   RC0 - LED Manual (red)
  * PIN 11   RA2 - nHALT input signal    (internal pullup)
- * PIN 12   RA1 - ICSP
- * PIN 13   RA0 - ICSP
+ * PIN 12   RA1 - ICSP / serial RX      (internal pullup)
+ * PIN 13   RA0 - ICSP / serial TX
  * PIN 14   VSS - GND
  *
  */
@@ -68,77 +88,514 @@
 
 
 #include <xc.h>
+#include "types.h"
 #include "buttons.h"
 #include "hardware.h"
 #include "interrupts.h"
 #include "leds.h"
 #include "generator.h"
+#include "uart.h"
+#include "settings.h"
+#include "sweep.h"
+#include "calibration.h"
+#include "trace.h"
+
+
+/**
+ * Send the generator state as one line:
+ *      <mode> <step> <output> <pulse width> <burst cycles> <cycles>
+ * mode M(anual), A(uto) or B(urst), step index of frequencies.h, output
+ * L(ow), H(igh) or P(WM), cycles - falling edges since power-on.
+ */
+static void _serialState(void)
+{
+    generator_mode_t mode = generator_getMode();
+    generator_state_t state = generator_getState();
+    char output = 'L';
+
+    if (state == GEN_STATE_FAST_AUTO) {
+        output = 'P';
+    } else if (state == GEN_STATE_MANUAL_HIGH || state == GEN_STATE_SLOW_AUTO_HIGH) {
+        output = 'H';
+    }
+
+    uart_putc(mode == GEN_MODE_MANUAL ? 'M' : (mode == GEN_MODE_AUTO ? 'A' : 'B'));
+    uart_putc(' ');
+    uart_putNumber(generator_getFrequency());
+    uart_putc(' ');
+    uart_putc(output);
+    uart_putc(' ');
+    uart_putNumber(generator_getPulseWidth());
+    uart_putc(' ');
+    uart_putNumber(generator_getBurstCycles());
+    uart_putc(' ');
+    uart_putNumber(generator_getCycles());
+    uart_puts("\r\n");
+}
+
+/**
+ * Time in ns from Tosc (125 ns), without the overflow of the product:
+ * whole microseconds first, the remaining 0 - 875 ns in three digits
+ * @param tosc
+ */
+static void _serialNanoseconds(uint32_t tosc)
+{
+    uint16_t rest = (uint16_t)(tosc & 0x07) * 125;
+
+    if ((tosc >> 3) == 0) {
+        uart_putNumber(rest);
+        return;
+    }
+    uart_putNumber(tosc >> 3);
+    uart_putc((char)('0' + rest / 100));
+    uart_putc((char)('0' + rest / 10 % 10));
+    uart_putc((char)('0' + rest % 10));
+}
+
+/**
+ * Send the duty cycle as one line:
+ *      <percent> <high ns> <low ns>
+ * high and low time as generated at the current step
+ */
+static void _serialDuty(void)
+{
+    uint32_t high;
+    uint32_t low;
+
+    generator_getTimes(&high, &low);
+    uart_putNumber(generator_getDuty());
+    uart_putc(' ');
+    _serialNanoseconds(high);
+    uart_putc(' ');
+    _serialNanoseconds(low);
+    uart_puts("\r\n");
+}
+
+/**
+ * Send the two-phase dead time as one line:
+ *      <setting Tcy> <dead ns>
+ * dead ns - as generated at the current step, 0 for the single output
+ */
+static void _serialDeadTime(void)
+{
+    uart_putNumber(generator_getDeadTime());
+    uart_putc(' ');
+    _serialNanoseconds(generator_getStepDeadTime());
+    uart_puts("\r\n");
+}
+
+/**
+ * Send the sweep result as one line:
+ *      <state> <step> <last good>
+ * state I(dle), R(unning), P(assed) or F(ailed), step running or the one
+ * the sweep ended at, last good - step that ran its dwell or "-"
+ */
+static void _serialSweep(void)
+{
+    static const char states[] = {'I', 'R', 'P', 'F'};
+    uint8_t lastGood = sweep_getLastGood();
+
+    uart_putc(states[sweep_getState()]);
+    uart_putc(' ');
+    uart_putNumber(sweep_getStep());
+    uart_putc(' ');
+    if (lastGood == SWEEP_NONE) {
+        uart_putc('-');
+    } else {
+        uart_putNumber(lastGood);
+    }
+    uart_puts("\r\n");
+}
+
+/**
+ * Send the calibration result as one line:
+ *      <state> <trim> <error ppm>
+ * state I(dle), R(unning), D(one) or F(ailed), trim - OSCTUNE in use,
+ * error - residual error of the clock, "-" unless done
+ */
+static void _serialCalibration(void)
+{
+    static const char states[] = {'I', 'R', 'D', 'F'};
+    calibration_state_t state = calibration_getState();
+    int8_t trim = calibration_getTrim();
+    int32_t error = calibration_getError();
+
+    uart_putc(states[state]);
+    uart_putc(' ');
+    if (trim < 0) {
+        uart_putc('-');
+    }
+    uart_putNumber((uint32_t)(trim < 0 ? -trim : trim));
+    uart_putc(' ');
+    if (state != CALIBRATION_DONE) {
+        uart_putc('-');
+    } else {
+        if (error < 0) {
+            uart_putc('-');
+        }
+        uart_putNumber((uint32_t)(error < 0 ? -error : error));
+    }
+    uart_puts("\r\n");
+}
+
+/**
+ * Calibration ended - the serial port takes RA1 back, the line is sent
+ */
+static void _calibrationEnd(void)
+{
+    uart_resume();
+    _serialCalibration();
+}
+
+/**
+ * Decimal number up to 65535
+ * @return 0 - no digits, 1 - number in value, -1 - not a number
+ */
+static int8_t _serialNumber(const char * text, uint16_t * value)
+{
+    uint16_t number = 0;
+
+    if (*text == 0) {
+        return 0;
+    }
+    while (*text) {
+        uint8_t digit = (uint8_t)(*text++ - '0');
+        if (digit > 9 || number > 6553 || (number == 6553 && digit > 5)) {
+            return -1;
+        }
+        number = number * 10 + digit;
+    }
+    *value = number;
+    return 1;
+}
+
+/**
+ * One command line from the serial port, answered with the state line
+ * or with "E" for a command not understood:
+ *      f<n>    frequency step n (0 - 10mHz, 1 - 20mHz ... see frequencies.h)
+ *      + -     next / previous frequency step
+ *      a       auto mode
+ *      h l     manual mode, output HIGH / LOW
+ *      s       single step - one manual pulse, from LOW out of the auto mode
+ *      w<n>    manual pulse width n (0 - 1us ... 5 - 100ms)
+ *      b<n>    burst length n cycles, b alone starts the burst
+ *      d<n>    duty cycle n % (1 - 99), d alone answers the duty line only
+ *      p<n>    two-phase output, n Tcy dead time (1 - 127), p0 RC5 only,
+ *              p alone answers the dead time line only
+ *      r<n>    resumable halt on (1) / off (0), answered with the setting
+ *      c<n>    low clock on (1) / off (0) for the slow steps up to 10 Hz,
+ *              answered with the setting before the serial port goes off
+ *      g<n>    sweep from the current step, n ms dwell on each step (1 - 65535),
+ *              g alone answers the sweep line only, it is sent at the end as well
+ *      o<n>    calibrate the oscillator against a 1 Hz reference on RA1, n reference
+ *              periods for the result (1 - 60), from the idle manual mode only.
+ *              Answered first, the serial port is back with the result line.
+ *              o alone answers the calibration line only
+ *      e       ISR events the main loop took late / dropped since power-on
+ *      ?       state only
+ *      t       trace statistics, max and avg per slot (GENERATOR_TRACE builds)
+ * A step selected outside the auto mode is used by the next auto mode or
+ * burst.
+ */
+static void _serialCommand(const char * line)
+{
+    uint16_t value = 0;
+    int8_t number = _serialNumber(line + 1, &value);
+    uint8_t frequency = generator_getFrequency();
+    uint8_t ok = (number == 0);
+
+    switch (line[0]) {
+        case 'f':
+            if (number == 1 && value <= 0xFF) {
+                generator_setFrequency((uint8_t)value);
+                ok = (generator_getFrequency() == value);
+            }
+            break;
+        case '+':
+        case '-':
+            // no step past either end of the table
+            if (ok) {
+                generator_setFrequency((line[0] == '+') ? frequency + 1 : frequency - 1);
+                ok = (generator_getFrequency() != frequency);
+            }
+            break;
+        case 'a':
+            generator_setAutoMode();
+            break;
+        case 'h':
+        case 'l':
+            if (ok) {
+                uint8_t state = (line[0] == 'h') ? GEN_STATE_MANUAL_HIGH : GEN_STATE_MANUAL_LOW;
+                // a button pulses at the same level, the command does not
+                if (generator_getMode() != GEN_MODE_MANUAL || generator_getState() != state) {
+                    generator_setManualState(state);
+                }
+            }
+            break;
+        case 's':
+            if (ok) {
+                if (generator_getMode() != GEN_MODE_MANUAL) {
+                    generator_setManualState(GEN_STATE_MANUAL_LOW);
+                }
+                generator_setManualState(generator_getState());
+            }
+            break;
+        case 'w':
+            if (number == 1 && value < PULSE_WIDTH_COUNT) {
+                generator_setPulseWidth((pulse_width_t)value);
+                ok = TRUE;
+            }
+            break;
+        case 'b':
+            if (number == 1 && value != 0) {
+                generator_setBurstCycles(value);
+                ok = TRUE;
+            } else if (ok) {
+                // answered first, nothing is sent during a fast burst
+                _serialState();
+                uart_pause();
+                generator_startBurst();
+                uart_resume();
+                return;
+            }
+            break;
+        case 'd':
+            if (number == 1 && value >= 1 && value <= 99) {
+                generator_setDuty((uint8_t)value);
+                ok = TRUE;
+            }
+            if (ok) {
+                _serialDuty();
+                return;
+            }
+            break;
+        case 'p':
+            if (number == 1 && value <= GENERATOR_DEAD_MAX) {
+                generator_setDeadTime((uint8_t)value);
+                ok = (generator_getDeadTime() == value);
+            }
+            if (ok) {
+                _serialDeadTime();
+                return;
+            }
+            break;
+        case 'r':
+            if (number == 1 && value <= 1) {
+                generator_setHaltResume((uint8_t)value);
+                ok = TRUE;
+            }
+            if (ok) {
+                uart_putNumber(generator_getHaltResume());
+                uart_puts("\r\n");
+                return;
+            }
+            break;
+        case 'c':
+            if (number == 1 && value <= 1) {
+                // answered first, the clock is lowered at the next edge
+                uart_putNumber(value);
+                uart_puts("\r\n");
+                uart_pause();
+                generator_setLowClock((uint8_t)value);
+                uart_resume();
+                return;
+            }
+            if (ok) {
+                uart_putNumber(generator_getLowClock());
+                uart_puts("\r\n");
+                return;
+            }
+            break;
+        case 'o':
+            if (number == 1 && value >= 1 && value <= CALIBRATION_PERIODS_MAX
+                && calibration_start((uint8_t)value)
+            ) {
+                // answered first, RA1 is the reference until the end
+                _serialCalibration();
+                uart_pause();
+                return;
+            }
+            if (ok) {
+                _serialCalibration();
+                return;
+            }
+            break;
+        case 'g':
+            if (number == 1 && value != 0) {
+                // 32.768 ms ticks = 4096 / 125 ms, rounded up
+                sweep_start((uint16_t)(((uint32_t)value * 125 + 4095) >> 12));
+                ok = TRUE;
+            }
+            if (ok) {
+                _serialSweep();
+                return;
+            }
+            break;
+        case 'e':
+            if (ok) {
+                uart_putNumber(interrupt_getLate());
+                uart_putc(' ');
+                uart_putNumber(interrupt_getDropped());
+                uart_puts("\r\n");
+                return;
+            }
+            break;
+        case '?':
+            break;
+#ifdef GENERATOR_TRACE
+        case 't':
+            if (ok) {
+                for (uint8_t i = 0; i < TRACE_COUNT; i++) {
+                    uart_putNumber(traceStats[i].max);
+                    uart_putc(' ');
+                    uart_putNumber(traceStats[i].avg);
+                    uart_puts("\r\n");
+                }
+                return;
+            }
+            break;
+#endif
+        default:
+            ok = FALSE;
+            break;
+    }
+
+    if (!ok) {
+        uart_puts("E\r\n");
+        return;
+    }
+    _serialState();
+}
+
+/**
+ * Act on the button events of the last scan or edge
+ */
+static void _buttons(void)
+{
+    buttons_state_t * buttonsState = buttons_getState();
+
+    // a held halt takes no button, the events are dropped
+    if (!generator_isHeld()) {
+        // handle button UP
+        if (buttonsState->pressed & BUTTON_UP) {
+            if (generator_getMode() == GEN_MODE_MANUAL) {
+                generator_setManualState(GEN_STATE_MANUAL_HIGH);
+            } else if (generator_getMode() == GEN_MODE_AUTO) {
+                generator_increaseFrequency();
+            }
+        }
 
+        // handle button DOWN
+        if (buttonsState->pressed & BUTTON_DOWN) {
+            if (generator_getMode() == GEN_MODE_MANUAL) {
+                generator_setManualState(GEN_STATE_MANUAL_LOW);
+            } else if (generator_getMode() == GEN_MODE_AUTO) {
+                generator_decreaseFrequency();
+            }
+        }
+
+        // handle button MODE - click toggles the mode, long press starts a burst
+        if (buttonsState->clicked & BUTTON_MODE) {
+            generator_toggleMode();
+        }
+        if (buttonsState->longPressed & BUTTON_MODE) {
+            uart_pause();
+            generator_startBurst();
+            uart_resume();
+        }
+    }
+}
 
 /**
  * Main function
  */
 void main(void)
 {
-    buttons_state_t * buttonsState;
+    char * serialLine;
+    uint8_t stops;
+    uint8_t ticks;
 
     harware_init();             // initialize hardware
-    generator_init();           // initialize generator
+    calibration_init();         // oscillator trim of the last calibration
+    generator_init(settings_load());    // initialize generator, last session settings
+    settings_init();            // started settings count as saved
     ei();                       // enable all interrupts
 
     // loop forever
     while (1) {
-        // update timer 1 overflow event
-        if (interrupt_flags.timer1Overflow) {
-            if (interrupt_flags.stopGenerator == 0) {
-                // check that the stop generator signal is not active
-                generator_timer1Callback();
-            }
-            interrupt_flags.timer1Overflow = 0;
+        // slow generator edge - end of a burst, unless nHALT stopped it
+        stops = interrupt_take(EVENT_STOP);
+        if (interrupt_take(EVENT_EDGE) && !stops) {
+            generator_clockEdgeCallback();
         }
 
         // update application state
-        if (interrupt_flags.stopGenerator) {
-            interrupt_flags.stopGenerator = 0;
+        if (stops) {
             generator_stop();
+            sweep_halted();
         }
 
-        // read buttons
-        if (interrupt_flags.readButtons) {
-            interrupt_flags.readButtons = 0;
-
-            // update individual buttons states
-            buttons_updateButtonState(BUTTON_UP, BUTTON_UP_PIN);
-            buttons_updateButtonState(BUTTON_DOWN, BUTTON_DOWN_PIN);
-            buttons_updateButtonState(BUTTON_MODE, BUTTON_MODE_PIN);
-
-            // read buttons calculated state
-            buttonsState = buttons_getState();
-
-            // handle button UP
-            if (buttonsState->buttonUp.pressed) {
-                buttonsState->buttonUp.pressed = 0;
-                if (generator_getMode() == GEN_MODE_MANUAL) {
-                    generator_setManualState(GEN_STATE_MANUAL_HIGH);
-                } else {
-                    generator_increaseFrequency();
-                }
-            }
+        // first edge of a button - acted on now, the scans debounce it
+        if (interrupt_take(EVENT_BUTTON)) {
+            buttons_edge();
+            _buttons();
+        }
 
-            // handle button DOWN
-            if (buttonsState->buttonDown.pressed) {
-                buttonsState->buttonDown.pressed = 0;
-                if (generator_getMode() == GEN_MODE_MANUAL) {
-                    generator_setManualState(GEN_STATE_MANUAL_LOW);
-                } else {
-                    generator_decreaseFrequency();
+        // calibration reference edge
+        if (interrupt_take(EVENT_REFERENCE) && calibration_edge()) {
+            _calibrationEnd();
+        }
+
+        // read buttons, the ticks missed by a slow pass are made up below
+        ticks = interrupt_take(EVENT_TICK);
+        if (ticks) {
+            TRACE_BACKLOG();
+
+            // sample all buttons at once, act on the events of this scan
+            buttons_scan();
+            _buttons();
+
+            // after the buttons - a press at this tick fails the step.
+            // The sweep dwell and the settings delay count every tick.
+            do {
+                if (sweep_tick()) {
+                    _serialSweep();
                 }
-            }
+                if (calibration_tick()) {
+                    _calibrationEnd();
+                }
+                generator_refreshLeds();
+                settings_tick();
+            } while (--ticks);
+        }
 
-            // handle button MODE
-            if (buttonsState->buttonMode.pressed) {
-                buttonsState->buttonMode.pressed = 0;
-                generator_toggleMode();
+        // serial command, not while a burst runs or a halt is held
+        serialLine = uart_getLine();
+        if (serialLine && generator_getMode() != GEN_MODE_BURST && !generator_isHeld()) {
+            _serialCommand(serialLine);
+            uart_releaseLine();
+        }
+        uart_service();
+        settings_service();
+
+        // nothing to generate or debounce - sleep until a button or nHALT,
+        // a settings change is saved first, a sweep stopped by nHALT
+        // reports and restarts before. TMR1 of a calibration would stop in
+        // SLEEP. The interrupts are disabled only for the last checks -
+        // a start bit edge waits for them.
+        if (generator_isIdle() && buttons_areReleased() && sweep_isIdle()
+            && calibration_getState() != CALIBRATION_RUNNING
+        ) {
+            settings_flush();
+            if (uart_isIdle() && settings_isIdle()) {
+                generator_refreshLeds();
+                di();
+                if (!INTERRUPT_IS_PENDING() && uart_isIdle()) {
+                    hardware_sleep();
+                    // TMR0 was stopped as well - scan the buttons right away
+                    INTERRUPT_RAISE(EVENT_TICK);
+                }
+                ei();
             }
         }
     }
@@ -0,0 +1,330 @@
+/**
+ * File:   settings.c
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ */
+
+#include <xc.h>
+#include <stddef.h>
+#include "types.h"
+#include "generator.h"
+#include "settings.h"
+#include "uart.h"
+
+// bytes of a record
+#define RECORD_SEQUENCE             0
+#define RECORD_FREQUENCY            1
+#define RECORD_MODE                 2           // mode, pulse width << 4, halt resume << 7
+#define RECORD_DEAD_TIME            3
+#define RECORD_BURST_LOW            4
+#define RECORD_BURST_HIGH           5
+#define RECORD_DUTY                 6
+#define RECORD_CRC                  7
+
+// CRC-8 x^8 + x^2 + x + 1, starts at 0xFF - neither an erased nor a
+// cleared record passes
+#define CRC_POLYNOMIAL              0x07
+#define CRC_INITIAL                 0xFF
+
+// slot of the newest record, the next one is written from writeIndex on
+static uint8_t recordSlot = 0;
+static uint8_t writeIndex = SETTINGS_RECORD_SIZE;
+// CRC of the settings saved last and of the ones seen at the last tick,
+// the sequence taken as 0. A change is saved after settleTicks more
+// ticks.
+static uint8_t savedCrc = 0;
+static uint8_t pendingCrc = 0;
+static uint8_t settleTicks = 0;
+// trim and its CRC, written from trimIndex on
+static uint8_t trimBytes[2];
+static uint8_t trimIndex = sizeof(trimBytes);
+
+static uint8_t _read(uint8_t address);
+static void _write(uint8_t address, uint8_t data);
+static uint8_t _crc(uint8_t crc, uint8_t data);
+static uint8_t _slotCrc(uint8_t slot, uint8_t sequence);
+static uint8_t _field(uint8_t index);
+static uint8_t _refresh(void);
+static void _save(void);
+
+/**
+ * One byte of the data EEPROM
+ * @param address
+ * @return uint8_t
+ */
+static uint8_t _read(uint8_t address)
+{
+    EEADR = address;
+    RD = 1;
+    return EEDAT;
+}
+
+/**
+ * Start writing one byte, the EEPROM is busy until WR clears (~5 ms)
+ * @param address
+ * @param data
+ */
+static void _write(uint8_t address, uint8_t data)
+{
+    EEADR = address;
+    EEDAT = data;
+    WREN = 1;
+    // the unlock sequence may not be split by an interrupt
+    di();
+    EECON2 = 0x55;
+    EECON2 = 0xAA;
+    WR = 1;
+    ei();
+    WREN = 0;
+}
+
+/**
+ * One byte into the CRC, bit by bit - no table in the flash
+ * @param crc
+ * @param data
+ * @return uint8_t
+ */
+static uint8_t _crc(uint8_t crc, uint8_t data)
+{
+    crc ^= data;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        if (crc & 0x80) {
+            crc = (uint8_t)(crc << 1) ^ CRC_POLYNOMIAL;
+        } else {
+            crc <<= 1;
+        }
+    }
+    return crc;
+}
+
+/**
+ * CRC of the setting bytes of a slot, read from the EEPROM one at a time
+ * @param slot
+ * @param sequence taken for the sequence byte
+ * @return uint8_t
+ */
+static uint8_t _slotCrc(uint8_t slot, uint8_t sequence)
+{
+    uint8_t address = slot * SETTINGS_RECORD_SIZE;
+    uint8_t crc = _crc(CRC_INITIAL, sequence);
+
+    for (uint8_t i = RECORD_FREQUENCY; i < RECORD_CRC; i++) {
+        crc = _crc(crc, _read(address + i));
+    }
+    return crc;
+}
+
+/**
+ * Setting byte of a record from the generator, the sequence is 0. A burst
+ * is the manual mode it ends in.
+ * @param index
+ * @return uint8_t
+ */
+static uint8_t _field(uint8_t index)
+{
+    switch (index) {
+        case RECORD_FREQUENCY:
+            return generator_getFrequency();
+        case RECORD_MODE:
+            return (uint8_t)((generator_getMode() == GEN_MODE_AUTO ? GEN_MODE_AUTO : GEN_MODE_MANUAL)
+                | ((uint8_t)generator_getPulseWidth() << 4) | (uint8_t)(generator_getHaltResume() << 7));
+        case RECORD_DEAD_TIME:
+            return generator_getDeadTime();
+        case RECORD_BURST_LOW:
+            return (uint8_t)generator_getBurstCycles();
+        case RECORD_BURST_HIGH:
+            return (uint8_t)(generator_getBurstCycles() >> 8);
+        case RECORD_DUTY:
+            return generator_getDuty();
+        default:
+            return 0;
+    }
+}
+
+/**
+ * CRC of the current generator settings into pendingCrc. A change that
+ * keeps the CRC only misses the restart of the settle time.
+ * @return TRUE when they changed since the last call
+ */
+static uint8_t _refresh(void)
+{
+    uint8_t crc = CRC_INITIAL;
+
+    for (uint8_t i = RECORD_SEQUENCE; i < RECORD_CRC; i++) {
+        crc = _crc(crc, _field(i));
+    }
+    if (crc == pendingCrc) {
+        return FALSE;
+    }
+    pendingCrc = crc;
+    return TRUE;
+}
+
+/**
+ * Start writing the settings of pendingCrc into the next slot, unless
+ * they are the ones saved last. The record is streamed from the generator
+ * by settings_service(), nothing is kept in RAM.
+ */
+static void _save(void)
+{
+    if (pendingCrc == savedCrc) {
+        return;
+    }
+    savedCrc = pendingCrc;
+    recordSlot = (recordSlot + 1 < SETTINGS_SLOTS) ? recordSlot + 1 : 0;
+    writeIndex = 0;
+}
+
+/**
+ * The newest record is found from the sequence bytes alone, only it (and
+ * the one before on a bad CRC) is read in full - a few hundred cycles.
+ * Its settings go to the generator before generator_init().
+ * @return generator_mode_t to start in, GEN_MODE_AUTO without a record
+ */
+generator_mode_t settings_load(void)
+{
+    uint8_t sequence = _read(0);
+    uint8_t address;
+    uint8_t slot;
+    uint8_t mode;
+
+    for (slot = 0; slot < SETTINGS_SLOTS - 1; slot++) {
+        uint8_t next = _read((slot + 1) * SETTINGS_RECORD_SIZE);
+        if (next != (uint8_t)(sequence + 1)) {
+            break;
+        }
+        sequence = next;
+    }
+
+    recordSlot = slot;
+    address = slot * SETTINGS_RECORD_SIZE;
+    if (_read(address + RECORD_CRC) != _slotCrc(slot, _read(address))) {
+        recordSlot = slot ? slot - 1 : SETTINGS_SLOTS - 1;
+        address = recordSlot * SETTINGS_RECORD_SIZE;
+        if (_read(address + RECORD_CRC) != _slotCrc(recordSlot, _read(address))) {
+            // nothing saved yet - the next record continues the slot
+            return GEN_MODE_AUTO;
+        }
+    }
+    mode = _read(address + RECORD_MODE);
+    generator_setFrequency(_read(address + RECORD_FREQUENCY));
+    generator_setPulseWidth((pulse_width_t)((mode >> 4) & 0x07));
+    generator_setHaltResume(mode >> 7);
+    generator_setDeadTime(_read(address + RECORD_DEAD_TIME));
+    generator_setBurstCycles((uint16_t)(_read(address + RECORD_BURST_HIGH) << 8) | _read(address + RECORD_BURST_LOW));
+    generator_setDuty(_read(address + RECORD_DUTY));
+    return (generator_mode_t)(mode & 0x0F);
+}
+
+/**
+ * The trim is a 5-bit two's complement, its CRC tells it from an erased
+ * cell
+ * @return int8_t
+ */
+int8_t settings_loadTrim(void)
+{
+    uint8_t trim = _read(SETTINGS_TRIM_ADDRESS);
+
+    if (_read(SETTINGS_TRIM_ADDRESS + 1) != _crc(CRC_INITIAL, trim) || trim > 0x1F) {
+        return 0;
+    }
+    return (int8_t)((trim & 0x10) ? (trim | 0xE0) : trim);
+}
+
+/**
+ * Nothing is written when the cell holds the trim already, 0 is the
+ * factory calibration an empty cell stands for
+ * @param trim
+ */
+void settings_saveTrim(int8_t trim)
+{
+    if (settings_loadTrim() == trim) {
+        return;
+    }
+    trimBytes[0] = (uint8_t)trim & 0x1F;
+    trimBytes[1] = _crc(CRC_INITIAL, trimBytes[0]);
+    trimIndex = 0;
+}
+
+/**
+ * The settings the generator started with count as saved
+ */
+void settings_init(void)
+{
+    _refresh();
+    savedCrc = pendingCrc;
+}
+
+/**
+ * Every change restarts the settle time
+ */
+void settings_tick(void)
+{
+    if (_refresh()) {
+        settleTicks = SETTINGS_SETTLE_TICKS;
+    } else if (settleTicks != 0 && --settleTicks == 0) {
+        if (writeIndex < SETTINGS_RECORD_SIZE) {
+            // the last record is still being written
+            settleTicks = 1;
+        } else {
+            _save();
+        }
+    }
+}
+
+/**
+ * The sequence goes first and the CRC last, a cut write never passes.
+ * The unlock sequence holds the interrupts off for a few cycles - not
+ * while the serial bit clock runs or a burst is counted
+ */
+void settings_service(void)
+{
+    if ((writeIndex >= SETTINGS_RECORD_SIZE && trimIndex >= sizeof(trimBytes)) || WR || uartFlags.clocked
+        || generator_getMode() == GEN_MODE_BURST
+    ) {
+        return;
+    }
+    if (writeIndex < SETTINGS_RECORD_SIZE) {
+        uint8_t address = recordSlot * SETTINGS_RECORD_SIZE;
+        uint8_t data;
+        if (writeIndex == RECORD_SEQUENCE) {
+            // one more than the slot before
+            data = (uint8_t)(_read(recordSlot ? address - SETTINGS_RECORD_SIZE
+                : (SETTINGS_SLOTS - 1) * SETTINGS_RECORD_SIZE) + 1);
+        } else if (writeIndex < RECORD_CRC) {
+            data = _field(writeIndex);
+        } else if (_slotCrc(recordSlot, 0) == savedCrc) {
+            data = _slotCrc(recordSlot, _read(address));
+        } else {
+            // a change came while the bytes were written - the record
+            // fails on purpose, the change is saved after its settle time
+            data = (uint8_t)~_slotCrc(recordSlot, _read(address));
+        }
+        _write(address + writeIndex, data);
+        writeIndex++;
+    } else {
+        _write(SETTINGS_TRIM_ADDRESS + trimIndex, trimBytes[trimIndex]);
+        trimIndex++;
+    }
+}
+
+void settings_flush(void)
+{
+    _refresh();
+    if (writeIndex < SETTINGS_RECORD_SIZE) {
+        return;
+    }
+    settleTicks = 0;
+    _save();
+}
+
+/**
+ * A byte being written does not keep the core awake, hardware_sleep()
+ * wakes up at its end
+ * @return uint8_t
+ */
+uint8_t settings_isIdle(void)
+{
+    return settleTicks == 0 && ((writeIndex >= SETTINGS_RECORD_SIZE && trimIndex >= sizeof(trimBytes)) || WR);
+}
@@ -0,0 +1,95 @@
+/*
+ * File:   settings.h
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ *
+ * Generator settings kept in the 256 byte data EEPROM over a power cycle.
+ *
+ * The EEPROM is a ring of SETTINGS_SLOTS records, every save goes to the
+ * slot after the newest one, so the writes are spread over all cells.
+ * A record is
+ *      <sequence> <step> <mode | pulse width << 4 | halt resume << 7> <dead time> <burst lo> <burst hi> <duty> <CRC-8>
+ * The sequence is one more than the one of the slot before. The newest
+ * record is the one its next slot does not continue, a record with a bad
+ * CRC (write cut by a power loss) falls back to the slot before it. The
+ * CRC-8 starts at 0xFF.
+ *
+ * The last record size of the EEPROM is not part of the ring, it keeps
+ * the OSCTUNE trim of the last calibration as <trim> <CRC-8>, written
+ * once per calibration.
+ *
+ * A change is saved once the settings stayed the same for
+ * SETTINGS_SETTLE_TICKS button ticks, so a series of presses is one
+ * write. The bytes are written one per main loop pass, the loop never
+ * waits for the EEPROM. Only a CRC of the settings is kept in RAM, each
+ * byte is taken from the generator when it is written.
+ */
+
+#ifndef SETTINGS_H
+#define	SETTINGS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define SETTINGS_RECORD_SIZE        8
+#define SETTINGS_SLOTS              (256 / SETTINGS_RECORD_SIZE - 1)
+#define SETTINGS_TRIM_ADDRESS       (SETTINGS_SLOTS * SETTINGS_RECORD_SIZE)
+// ~2 s of 32.768 ms button ticks
+#define SETTINGS_SETTLE_TICKS       61
+
+/**
+ * Settings of the newest valid record to the generator, before
+ * generator_init()
+ * @return generator_mode_t to start in, GEN_MODE_AUTO when there is no
+ * valid record
+ */
+generator_mode_t settings_load(void);
+
+/**
+ * OSCTUNE trim saved by the last calibration
+ * @return int8_t, 0 - none saved
+ */
+int8_t settings_loadTrim(void);
+
+/**
+ * Save the OSCTUNE trim, written by settings_service() after a record
+ * being written
+ * @param trim
+ */
+void settings_saveTrim(int8_t trim);
+
+/**
+ * Take the settings the generator started with, after generator_init()
+ */
+void settings_init(void);
+
+/**
+ * Look for a settings change, called at the TMR0 tick rate
+ */
+void settings_tick(void);
+
+/**
+ * Write the next byte of a record when the EEPROM is ready, called from
+ * the main loop
+ */
+void settings_service(void);
+
+/**
+ * Save a pending change right away, the core is about to SLEEP
+ */
+void settings_flush(void);
+
+/**
+ * No change pending and no byte left to start - the core may SLEEP
+ * @return TRUE when idle
+ */
+uint8_t settings_isIdle(void);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SETTINGS_H */
@@ -0,0 +1,1766 @@
+/*
+ * File:   bench.c
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ *
+ * Frequency benchmark: steps the generator through every frequency with
+ * the buttons, measures the clock output and fails when the frequency or
+ * the duty cycle is off by more than the allowed tolerance.
+ * Then runs a burst (long press on MODE) on every step above the LED
+ * blink range and fails unless exactly the burst length of full cycles
+ * comes out, and switches between every two neighbouring steps from the
+ * last blink step up and down, failing on a high / low time shorter than
+ * the shorter half period or longer than both half periods together.
+ * Pulls nHALT while a fast step switches to the next one, or while the
+ * reply to the switch is sent, and fails unless the generator stops and
+ * the serial port and the buttons still work.
+ * Then idles in manual mode and fails unless the core spends nearly
+ * all the time in SLEEP and still wakes up on a button.
+ * Finally sends commands to the serial port, at the nominal baud rate and
+ * 2 % off, and fails on a wrong reply, on a TX bit edge off by more than
+ * BENCH_SERIAL_EDGE_BITS or on a slow step half period the traffic moved.
+ * Then sets a 25 % duty cycle over the serial port on every step above
+ * the LED blink range and fails unless the high time measured is the one
+ * the firmware reports, and switches on the two-phase output on the same
+ * steps, failing when both phases are high at the same time or closer
+ * than the reported dead time.
+ * Then changes the settings, power cycles twice and fails unless every
+ * change was saved as one EEPROM record and came back at power-on.
+ * Then sweeps and pulls nHALT, failing unless the sweep reports the step
+ * below the interrupted one and the auto mode runs it once nHALT is
+ * released, then
+ * sweeps to the top step and fails unless that sweep passes.
+ * Last lowers the clock on the slow steps with a TMR1 prescaler, from
+ * 1 Hz up, and fails unless the core runs at 8 MHz >> T1CKPS with the
+ * frequency unchanged, and a MODE click brings back 8 MHz and the serial
+ * port.
+ * Last calibrates an oscillator 1.5 % fast against a 1 Hz reference and
+ * fails unless the trim is the best one, the reported error is the one
+ * of the clock and the trim comes back at the next power-on. A calibration
+ * without the reference has to fail and keep the trim, one ended by MODE
+ * has to leave the auto mode running.
+ * Finally drives every ISR branch - serial traffic on a two-phase slow
+ * step, a button, a fast burst, a dithered fast step, nHALT - and fails
+ * when one ISR entry of a single source takes more cycles than its budget,
+ * both in the cost model of the simulator.
+ *
+ * Every step runs in its own process, so the firmware always starts from
+ * its power-on state.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "harness.h"
+#include "../frequencies.h"
+
+// allowed deviation from the nominal frequency
+#define BENCH_FREQUENCY_PPM     1000.0
+// allowed deviation from 50 % duty cycle
+#define BENCH_DUTY_PERCENT      2.0
+
+// time after the last button press before the output is measured
+#define BENCH_SETTLE_FS         (100 * SIM_FS_PER_MS)
+
+// BURST_CYCLES_DEFAULT of generator.c
+#define BENCH_BURST_CYCLES      64
+// allowed deviation of a burst pulse / gap from the half period
+#define BENCH_BURST_PERCENT     1.0
+// time the firmware may take for an engine switch on top of both half periods
+#define BENCH_SWITCH_SLACK_S    50e-6
+// nHALT during a fast to fast switch: the steps (1KHz > 2KHz on the default
+// table), the delay of the switch command after the first one, the halt
+// after the second one per run and how long nHALT stays low
+#define BENCH_HALT_SWITCH_STEP  (FREQ_COUNT > 16 ? 15 : FREQ_SLOW_LAST + 1)
+#define BENCH_HALT_SWITCH_RUNS  8
+#define BENCH_HALT_SWITCH_FS    (700 * SIM_FS_PER_MS)
+#define BENCH_HALT_SWITCH_LOW_FS (20 * SIM_FS_PER_MS)
+// idle manual mode: run time, time of the waking UP click, allowed awake time
+#define BENCH_IDLE_FS           (10 * SIM_FS_PER_S)
+#define BENCH_IDLE_CLICK_FS     (5 * SIM_FS_PER_S)
+#define BENCH_AWAKE_PERCENT     2.5
+// serial port: baud rates of the host, largest TX edge error in bit times,
+// time between two commands, the step and the span measured under traffic
+#define BENCH_SERIAL_RUNS       4
+#define BENCH_SERIAL_EDGE_BITS  0.15
+#define BENCH_SERIAL_GAP_FS     (10 * SIM_FS_PER_MS)
+#define BENCH_SERIAL_STEP       FREQ_SLOW_LAST
+#define BENCH_SERIAL_TRAFFIC_FS (200 * SIM_FS_PER_MS)
+#define BENCH_SERIAL_QUERY_FS   (8 * SIM_FS_PER_MS)
+// duty cycle: percent set, allowed deviation of the measured high time
+// from the reported one on top of a timer tick
+#define BENCH_DUTY_SET          25
+#define BENCH_DUTY_TIME_PERCENT 0.5
+// two-phase dead time set, in Tcy
+#define BENCH_PHASE_DEAD        4
+// settings: step saved, time for the settle delay and the write, EEPROM
+// bytes of one record, start-up time allowed on top of a half period
+#define BENCH_SETTINGS_STEP     (FREQ_DEFAULT + 3)
+#define BENCH_SETTINGS_SAVE_FS  (2500 * SIM_FS_PER_MS)
+#define BENCH_SETTINGS_WRITES   8
+#define BENCH_SETTINGS_START_S  2e-3
+// sweep: steps swept to the top, start and dwell of the interrupted
+// sweep (the short dither table from its first step), nHALT after its
+// start and held for
+#define BENCH_SWEEP_TOP_STEPS   3
+#define BENCH_SWEEP_STEP        (FREQ_COUNT > 12 ? FREQ_BLINK_LAST + 2 : 0)
+#define BENCH_SWEEP_DWELL_MS    100
+#define BENCH_SWEEP_HALT_FS     (590 * SIM_FS_PER_MS)
+#define BENCH_SWEEP_HOLD_FS     (50 * SIM_FS_PER_MS)
+
+// low clock: the slow steps from this frequency up, periods measured
+#define BENCH_LOWCLOCK_FROM_HZ  1.0
+#define BENCH_LOWCLOCK_PERIODS  2
+#define BENCH_CLOCK_HZ          8e6
+
+// calibration: HFINTOSC error, reference edges (RA1 low for 100 ms each
+// second), reported against the real error of the clock
+#define BENCH_CALIBRATION_ERROR_PPM 15000
+#define BENCH_CALIBRATION_PERIODS   4
+#define BENCH_CALIBRATION_EDGES     12
+#define BENCH_CALIBRATION_LOW_FS    (100 * SIM_FS_PER_MS)
+#define BENCH_CALIBRATION_PPM       10.0
+#define BENCH_CALIBRATION_FAIL_FS   (6 * SIM_FS_PER_S)
+#define BENCH_CALIBRATION_MODE_FS   (300 * SIM_FS_PER_MS)
+#define BENCH_CALIBRATION_TAKEOVER_FS (3 * SIM_FS_PER_S)
+
+// ISR paths: runs that drive them, nHALT after the step settled
+#define BENCH_ISR_RUNS          4
+#define BENCH_ISR_HALT_FS       (50 * SIM_FS_PER_MS)
+
+// frequency ladder of the firmware (frequencies.h)
+static const double targetsHz[FREQ_COUNT] = FREQ_TARGETS_HZ;
+static const char * names[FREQ_COUNT] = FREQ_NAMES;
+
+// cycles one ISR() entry may take by its source, interrupt latency and the
+// XC8 context save / restore included (SIM_COST_ISR_*). Cycles of the
+// simulator's cost model: register accesses, calls and loops are charged,
+// RAM accesses, bank selects and the arithmetic are not. No XC8 listing
+// was checked, it takes more. The worst entry measured and about 10 % on
+// top - a branch that grows has to raise its budget on purpose. TMR0 is
+// the serial bit clock at its worst: the stop bit serves the compare
+// interrupt held by PEIE in the same entry, over the 52 Tcy of a bit (the
+// reload is relative). The engine branches serve a start edge that came
+// during them.
+static const char * isrNames[SIM_ISR_SHARED] = {"INT", "TMR1", "IOC", "TMR0", "CCP1", "TMR2"};
+static const uint32_t isrBudgets[SIM_ISR_SHARED] = {56, 60, 64, 143, 116, 66};
+
+
+typedef void (* bench_child_t)(uint8_t step, int fd);
+
+typedef struct {
+    uint32_t phases;            // complete high / low times
+    double phaseMinS;
+    double phaseMaxS;
+} bench_switch_t;
+
+typedef struct {
+    uint32_t replies;           // replies as expected
+    uint32_t edges;             // clock output edges from the halt on
+    uint8_t cut;                // the reply to the switch came garbled
+    char mismatch[40];
+} bench_halt_switch_t;
+
+typedef struct {
+    double awakeRatio;
+    uint32_t sleeps;
+    char level;                 // clock output at the end
+} bench_idle_t;
+
+typedef struct {
+    uint32_t replies;           // replies as expected
+    uint32_t expected;
+    double edgeError;           // bit times
+    double phaseMinS;           // half periods of the slow step under traffic
+    double phaseMaxS;
+    uint32_t sleeps;
+    char mismatch[40];          // first reply not as expected
+} bench_serial_t;
+
+typedef struct {
+    harness_measure_t measure;
+    uint32_t percent;           // reported duty cycle
+    double highS;               // reported high / low time
+    double lowS;
+    char mismatch[40];
+} bench_duty_t;
+
+typedef struct {
+    harness_measure_t measure;
+    uint32_t setting;           // reported dead time setting, Tcy
+    double deadS;               // reported dead time of the step
+    uint32_t phasePulses;       // high pulses of RC4
+    double overlapS;            // time both phases were high
+    double gapMinS;             // shortest time from one phase falling to the other rising
+    char mismatch[40];
+} bench_phase_t;
+
+typedef struct {
+    uint32_t writes[2];         // EEPROM bytes written before each power cycle
+    uint32_t replies;           // state queries after a power cycle as expected
+    double firstEdgeS;          // first output edge after the power cycle
+    double frequencyHz;         // restored step, from the rising edges
+    char mismatch[40];
+    uint8_t eeprom[SIM_EEPROM_SIZE];    // handed from one power-on to the next
+} bench_settings_t;
+
+typedef struct {
+    harness_measure_t measure;  // auto mode after the interrupted sweep
+    uint32_t replies;           // replies as expected
+    uint32_t failed;            // step the interrupted sweep failed at
+    uint32_t lastGood;
+    char mismatch[40];
+} bench_sweep_t;
+
+typedef struct {
+    harness_measure_t measure;  // at the low clock
+    double lowHz;               // core clock at the low clock
+    double backHz;              // core clock after the MODE click
+    uint32_t replies;           // replies as expected
+    char mismatch[40];
+} bench_lowclock_t;
+
+typedef struct {
+    uint32_t replies;           // replies as expected
+    int32_t trim;               // reported at the end of the calibration
+    int32_t errorPpm;
+    double clockPpm[2];         // clock off 8 MHz after the calibration / at the next power-on
+    uint32_t takeoverEdges;     // edges after MODE ends a calibration in auto mode
+    char mismatch[40];
+    uint8_t eeprom[SIM_EEPROM_SIZE];    // handed from one power-on to the next
+} bench_calibration_t;
+
+typedef struct {
+    uint64_t atFs;              // 0 - BENCH_SERIAL_GAP_FS after the last one
+    const char * command;       // # - BENCH_SERIAL_STEP, @ - FREQ_DEFAULT, $ - BENCH_SETTINGS_STEP,
+                                // ^ - the last step
+    const char * reply;         // fields, * for any
+} bench_command_t;
+
+// auto mode from power-on, a step selected in it is taken at the next edge
+static const bench_command_t serialScript[] = {
+    {20 * SIM_FS_PER_MS, "?\r", "A @ * 4 64 *"},
+    {0, "f#\r", "A # * 4 64 *"},
+    {0, "w2\r", "A # * 2 64 *"},
+    {0, "b100\n", "A # * 2 100 *"},
+    {0, "x\r", "E"},
+    {0, "f99\r", "E"},
+    {0, "w9\r\n", "E"},
+    {0, "?1\r", "E"},
+    {0, "b123456789\r", "E"},
+    {300 * SIM_FS_PER_MS, "s\r", "M # L 2 100 *"},
+    {0, "a\r", "A # * 2 100 *"},
+    {0, "e\r", "* 0"},
+};
+
+// idle manual mode, every command wakes the core up. + and - stop at
+// either end of the table.
+static const bench_command_t serialSleepScript[] = {
+    {20 * SIM_FS_PER_MS, "l\r", "M @ L 4 64 *"},
+    {300 * SIM_FS_PER_MS, "?\r", "M @ L 4 64 *"},
+    {400 * SIM_FS_PER_MS, "h\r", "M @ H 4 64 *"},
+    {500 * SIM_FS_PER_MS, "l\r", "M @ L 4 64 *"},
+    {600 * SIM_FS_PER_MS, "s\r", "M @ L 4 64 *"},
+    {700 * SIM_FS_PER_MS, "?\r", "M @ L 4 64 *"},
+    {0, "f0\r", "M 0 L 4 64 *"},
+    {0, "-\r", "E"},
+    {0, "f^\r", "M ^ L 4 64 *"},
+    {0, "+\r", "E"},
+    {0, "-\r", "M * L 4 64 *"},
+};
+
+// in the wait for the running period, then in the reply to the switch
+static const uint64_t haltSwitchDelaysFs[BENCH_HALT_SWITCH_RUNS] = {
+    50 * SIM_FS_PER_US, 150 * SIM_FS_PER_US, 300 * SIM_FS_PER_US, 500 * SIM_FS_PER_US,
+    1000 * SIM_FS_PER_US, 2000 * SIM_FS_PER_US, 3000 * SIM_FS_PER_US, 4000 * SIM_FS_PER_US
+};
+
+static const double serialBauds[BENCH_SERIAL_RUNS] = {
+    HARNESS_SERIAL_BAUD, HARNESS_SERIAL_BAUD * 0.98, HARNESS_SERIAL_BAUD * 1.02, HARNESS_SERIAL_BAUD
+};
+
+// the switch children step DOWN from step + 1 instead of UP from step
+static uint8_t switchDown = 0;
+
+// the calibration power-ons hand the EEPROM on
+static bench_calibration_t calibration = {0, 0, 0, {0.0, 0.0}, 0, "", {0}};
+
+
+/**
+ * Select a step with UP (positive) or DOWN (negative) presses from the
+ * power-on step, returns the time after the last press
+ */
+static uint64_t _selectStep(uint8_t step)
+{
+    uint64_t atFs = 10 * SIM_FS_PER_MS;
+    int presses = (int)step - (int)FREQ_DEFAULT;
+
+    if (presses < 0) {
+        atFs = harness_pressRepeat(HARNESS_PIN_DOWN, atFs, (uint8_t)-presses);
+    } else {
+        atFs = harness_pressRepeat(HARNESS_PIN_UP, atFs, (uint8_t)presses);
+    }
+    return atFs;
+}
+
+/**
+ * Child process: run one step and write the measurement to the pipe
+ */
+static void _runStep(uint8_t step, int fd)
+{
+    harness_measure_t measure = {0};
+    uint64_t atFs;
+
+    harness_reset();
+    atFs = _selectStep(step) + BENCH_SETTLE_FS;
+
+    // at least two periods, at least 5 ms of output
+    double windowS = 2.0 / targetsHz[step];
+    if (windowS < 0.005) {
+        windowS = 0.005;
+    }
+    // a dithered step is only exact over many groups of periods
+    if (frequencyTable[step].fraction != 0 && windowS < 0.1) {
+        windowS = 0.1;
+    }
+    harness_recordFrom(atFs);
+    harness_run(atFs + (uint64_t)(windowS * SIM_FS_PER_S) + SIM_FS_PER_MS);
+
+    if (harness_measure(&measure) != 0) {
+        measure.periods = 0;
+    }
+    if (write(fd, &measure, sizeof(measure)) != sizeof(measure)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * Child process: burst from manual mode on one step, write the pulses
+ * to the pipe
+ */
+static void _runBurst(uint8_t step, int fd)
+{
+    harness_pulses_t pulses = {0};
+    uint64_t atFs;
+
+    harness_reset();
+    atFs = harness_press(HARNESS_PIN_MODE, _selectStep(step)) + BENCH_SETTLE_FS;
+    harness_recordFrom(atFs);
+    atFs = harness_hold(HARNESS_PIN_MODE, atFs);
+    harness_run(atFs + (uint64_t)(BENCH_BURST_CYCLES / targetsHz[step] * SIM_FS_PER_S) + SIM_FS_PER_MS);
+
+    harness_pulses(&pulses);
+    if (write(fd, &pulses, sizeof(pulses)) != sizeof(pulses)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * Timer tick of a step, the granularity of a dithered half period
+ */
+static double _tickS(uint8_t step)
+{
+    uint8_t control = frequencyTable[step].timerControl;
+
+    if (step > FREQ_SLOW_LAST) {
+        // T2CKPS 00 = 1:1, 01 = 1:4, 1x = 1:16
+        return (double)(1 << ((control & 0x03) << 1)) / 2e6;
+    }
+    return (double)(1 << ((control >> 4) & 0x03)) / 2e6;
+}
+
+/**
+ * Child process: switch from a running step to its neighbour, write the
+ * shortest and longest high / low time around the change to the pipe
+ */
+static void _runSwitch(uint8_t step, int fd)
+{
+    bench_switch_t result = {0, 1e9, 0.0};
+    uint8_t from = switchDown ? step + 1 : step;
+    double oldPeriodS = 1.0 / targetsHz[from];
+    double newPeriodS = 1.0 / targetsHz[switchDown ? step : step + 1];
+    uint32_t count;
+    uint64_t atFs;
+
+    harness_reset();
+    atFs = _selectStep(from) + BENCH_SETTLE_FS + (uint64_t)(2 * oldPeriodS * SIM_FS_PER_S);
+    harness_recordFrom(atFs);
+    atFs = harness_press(switchDown ? HARNESS_PIN_DOWN : HARNESS_PIN_UP,
+        atFs + (uint64_t)(oldPeriodS * SIM_FS_PER_S));
+    harness_run(atFs + (uint64_t)((2 * oldPeriodS + 4 * newPeriodS) * SIM_FS_PER_S) + SIM_FS_PER_MS);
+
+    const harness_edge_t * edges = harness_edges(&count);
+    for (uint32_t i = 1; i < count; i++) {
+        double phaseS = (double)(edges[i].timeFs - edges[i - 1].timeFs) / SIM_FS_PER_S;
+        if (phaseS < result.phaseMinS) {
+            result.phaseMinS = phaseS;
+        }
+        if (phaseS > result.phaseMaxS) {
+            result.phaseMaxS = phaseS;
+        }
+        result.phases++;
+    }
+
+    if (write(fd, &result, sizeof(result)) != sizeof(result)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * Child process: manual mode with a single UP click, write the time spent
+ * awake to the pipe
+ */
+static void _runIdle(uint8_t step, int fd)
+{
+    bench_idle_t result = {0};
+
+    harness_reset();
+    harness_press(HARNESS_PIN_MODE, 10 * SIM_FS_PER_MS);
+    harness_press(HARNESS_PIN_UP, BENCH_IDLE_CLICK_FS);
+    harness_run(BENCH_IDLE_FS);
+
+    const sim_stats_t * stats = sim_getStats();
+    result.awakeRatio = (double)(stats->nowFs - stats->sleepFs) / (double)stats->nowFs;
+    result.sleeps = stats->sleepCount;
+    result.level = sim_pinLevel(HARNESS_PIN_CLK);
+    if (write(fd, &result, sizeof(result)) != sizeof(result)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * A reply line against the expected fields, * matches any field
+ */
+static int _replyMatches(const char * reply, const char * expected)
+{
+    while (*reply && *expected) {
+        if (*expected == '*') {
+            while (*reply && *reply != ' ') {
+                reply++;
+            }
+            expected++;
+        } else if (*reply++ != *expected++) {
+            return 0;
+        }
+    }
+    return *reply == 0 && *expected == 0;
+}
+
+/**
+ * Command or reply of a script with the step numbers filled in
+ */
+static void _serialText(char * text, size_t size, const char * format)
+{
+    size_t length = 0;
+
+    for (; *format && length + 4 < size; format++) {
+        if (*format == '#' || *format == '@' || *format == '$' || *format == '^') {
+            length += (size_t)snprintf(text + length, size - length, "%u",
+                *format == '#' ? BENCH_SERIAL_STEP
+                : (*format == '@' ? FREQ_DEFAULT
+                : (*format == '$' ? BENCH_SETTINGS_STEP : FREQ_COUNT - 1)));
+        } else {
+            text[length++] = *format;
+        }
+    }
+    text[length] = 0;
+}
+
+/**
+ * Child process: switch from one fast step to the next over the serial
+ * port and pull nHALT while the running PWM period is finished or while
+ * the reply is sent. The halt has to stop the generator, the serial port
+ * and the buttons have to work afterwards. Writes the replies checked and
+ * the output edges to the pipe.
+ */
+static void _runHaltSwitch(uint8_t run, int fd)
+{
+    static char text[256];
+    bench_halt_switch_t result = {0, 0, 0, ""};
+    char command[24];
+    char expected[4][24];
+    char next[24];
+    double edgeError;
+    uint64_t atFs;
+    uint64_t haltFs;
+
+    harness_reset();
+    snprintf(command, sizeof(command), "f%u\r", BENCH_HALT_SWITCH_STEP);
+    atFs = harness_serialSend(20 * SIM_FS_PER_MS, command, HARNESS_SERIAL_BAUD);
+    snprintf(command, sizeof(command), "f%u\r", BENCH_HALT_SWITCH_STEP + 1);
+    atFs = harness_serialSend(atFs + BENCH_HALT_SWITCH_FS, command, HARNESS_SERIAL_BAUD);
+    haltFs = atFs + haltSwitchDelaysFs[run];
+    sim_schedule(haltFs, HARNESS_PIN_HALT, 0);
+    atFs += BENCH_HALT_SWITCH_LOW_FS;
+    sim_schedule(atFs, HARNESS_PIN_HALT, SIM_RELEASE);
+    // only the UP click may set the output from here on
+    harness_recordFrom(haltFs + SIM_FS_PER_MS);
+    atFs = harness_serialSend(atFs + BENCH_SERIAL_GAP_FS, "?\r", HARNESS_SERIAL_BAUD);
+    atFs = harness_press(HARNESS_PIN_UP, atFs + BENCH_SERIAL_GAP_FS);
+    atFs = harness_serialSend(atFs, "?\r", HARNESS_SERIAL_BAUD);
+    harness_run(atFs + BENCH_SERIAL_GAP_FS);
+
+    harness_edges(&result.edges);
+    harness_serialRead(text, sizeof(text), &edgeError);
+    snprintf(expected[0], sizeof(expected[0]), "A %u * 4 64 *", BENCH_HALT_SWITCH_STEP);
+    snprintf(expected[1], sizeof(expected[1]), "A %u P 4 64 *", BENCH_HALT_SWITCH_STEP + 1);
+    snprintf(expected[2], sizeof(expected[2]), "M %u L 4 64 *", BENCH_HALT_SWITCH_STEP + 1);
+    snprintf(expected[3], sizeof(expected[3]), "M %u H 4 64 *", BENCH_HALT_SWITCH_STEP + 1);
+    // the replies after the halt, found by their start - a reply cut by
+    // the INT interrupt may have lost its CR LF (README, serial port)
+    snprintf(next, sizeof(next), "M %u L ", BENCH_HALT_SWITCH_STEP + 1);
+
+    char * line = text;
+    for (uint8_t i = 0; i < 4; i++) {
+        if (i == 1) {
+            char * after = strstr(line, next);
+            char * end = strstr(line, "\r\n");
+            if (after == NULL) {
+                snprintf(result.mismatch, sizeof(result.mismatch), "no \"%s\"", next);
+                break;
+            }
+            if (end == NULL || end > after) {
+                result.cut = 1;
+            } else {
+                *end = 0;
+                result.cut = !_replyMatches(line, expected[1]) || end + 2 != after;
+            }
+            result.replies++;
+            line = after;
+            continue;
+        }
+        char * end = strstr(line, "\r\n");
+        if (end == NULL) {
+            snprintf(result.mismatch, sizeof(result.mismatch), "%u replies", i);
+            break;
+        }
+        *end = 0;
+        if (!_replyMatches(line, expected[i])) {
+            snprintf(result.mismatch, sizeof(result.mismatch), "\"%.30s\"", line);
+            break;
+        }
+        result.replies++;
+        line = end + 2;
+    }
+
+    if (write(fd, &result, sizeof(result)) != sizeof(result)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * Child process: run a command script, the nominal runs select the slow
+ * BENCH_SERIAL_STEP and keep querying it, the last run talks to a sleeping
+ * core. Writes the replies checked and the half periods to the pipe.
+ */
+static void _runSerial(uint8_t run, int fd)
+{
+    static char text[4096];
+    static char expected[64][24];
+    bench_serial_t result = {0, 0, 0.0, 1e9, 0.0, 0, ""};
+    const bench_command_t * script = serialScript;
+    uint32_t commands = sizeof(serialScript) / sizeof(serialScript[0]);
+    char command[24];
+    uint64_t atFs = 0;
+    uint64_t endFs;
+    uint32_t count = 0;
+
+    if (run == BENCH_SERIAL_RUNS - 1) {
+        script = serialSleepScript;
+        commands = sizeof(serialSleepScript) / sizeof(serialSleepScript[0]);
+    }
+
+    harness_reset();
+    for (uint32_t i = 0; i < commands; i++) {
+        atFs = script[i].atFs ? script[i].atFs : atFs + BENCH_SERIAL_GAP_FS;
+        _serialText(command, sizeof(command), script[i].command);
+        harness_serialSend(atFs, command, serialBauds[run]);
+        _serialText(expected[count++], sizeof(expected[0]), script[i].reply);
+    }
+    endFs = atFs + BENCH_SERIAL_GAP_FS;
+
+    if (script == serialScript) {
+        // queries while the slow step runs, every edge has to stay in place
+        atFs += 100 * SIM_FS_PER_MS;
+        harness_recordFrom(atFs);
+        for (endFs = atFs + BENCH_SERIAL_TRAFFIC_FS; atFs < endFs; atFs += BENCH_SERIAL_QUERY_FS) {
+            harness_serialSend(atFs, "?\r", serialBauds[run]);
+            _serialText(expected[count++], sizeof(expected[0]), "A # * 2 100 *");
+        }
+    }
+    harness_run(endFs);
+
+    harness_serialRead(text, sizeof(text), &result.edgeError);
+    result.expected = count;
+    char * line = text;
+    for (uint32_t i = 0; i < count; i++) {
+        char * end = strstr(line, "\r\n");
+        if (end == NULL) {
+            snprintf(result.mismatch, sizeof(result.mismatch), "%u replies", i);
+            break;
+        }
+        *end = 0;
+        if (!_replyMatches(line, expected[i])) {
+            snprintf(result.mismatch, sizeof(result.mismatch), "\"%.30s\"", line);
+            break;
+        }
+        result.replies++;
+        line = end + 2;
+    }
+    if (result.replies == count && *line) {
+        snprintf(result.mismatch, sizeof(result.mismatch), "extra \"%.20s\"", line);
+    }
+
+    const harness_edge_t * edges = harness_edges(&count);
+    for (uint32_t i = 1; i < count; i++) {
+        double phaseS = (double)(edges[i].timeFs - edges[i - 1].timeFs) / SIM_FS_PER_S;
+        if (phaseS < result.phaseMinS) {
+            result.phaseMinS = phaseS;
+        }
+        if (phaseS > result.phaseMaxS) {
+            result.phaseMaxS = phaseS;
+        }
+    }
+    result.sleeps = sim_getStats()->sleepCount;
+
+    if (write(fd, &result, sizeof(result)) != sizeof(result)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * Child process: select the step and BENCH_DUTY_SET over the serial port,
+ * measure the output, write it with the reported times to the pipe
+ */
+static void _runDuty(uint8_t step, int fd)
+{
+    static char text[256];
+    bench_duty_t result = {{0}, 0, 0.0, 0.0, ""};
+    char command[24];
+    double edgeError;
+    unsigned long highNs = 0;
+    unsigned long lowNs = 0;
+    uint64_t atFs;
+
+    harness_reset();
+    snprintf(command, sizeof(command), "f%u\r", step);
+    atFs = harness_serialSend(20 * SIM_FS_PER_MS, command, HARNESS_SERIAL_BAUD);
+    snprintf(command, sizeof(command), "d%u\r", BENCH_DUTY_SET);
+    atFs = harness_serialSend(atFs + BENCH_SERIAL_GAP_FS, command, HARNESS_SERIAL_BAUD);
+    // the power-on step starts low, a fast step follows its first falling edge
+    atFs += BENCH_SETTLE_FS + (uint64_t)(1.0 / targetsHz[FREQ_DEFAULT] * SIM_FS_PER_S);
+
+    // as _runStep, at least two periods and 5 ms
+    double windowS = 2.0 / targetsHz[step];
+    if (windowS < 0.005) {
+        windowS = 0.005;
+    }
+    if (frequencyTable[step].fraction != 0 && windowS < 0.1) {
+        windowS = 0.1;
+    }
+    harness_recordFrom(atFs);
+    harness_run(atFs + (uint64_t)(windowS * SIM_FS_PER_S) + SIM_FS_PER_MS);
+    if (harness_measure(&result.measure) != 0) {
+        result.measure.periods = 0;
+    }
+
+    // state line of f, then the duty line
+    harness_serialRead(text, sizeof(text), &edgeError);
+
+    char * line = strstr(text, "\r\n");
+    if (line == NULL || sscanf(line + 2, "%u %lu %lu", &result.percent, &highNs, &lowNs) != 3) {
+        snprintf(result.mismatch, sizeof(result.mismatch), "\"%.30s\"", text);
+    }
+    result.highS = highNs * 1e-9;
+    result.lowS = lowNs * 1e-9;
+
+    if (write(fd, &result, sizeof(result)) != sizeof(result)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * Child process: select the step and the two-phase output over the serial
+ * port, write the phase timing to the pipe
+ */
+static void _runPhases(uint8_t step, int fd)
+{
+    static char text[256];
+    bench_phase_t result = {{0}, 0, 0.0, 0, 0.0, 1e9, ""};
+    char command[24];
+    double edgeError;
+    unsigned long deadNs = 0;
+    uint32_t clockCount;
+    uint32_t phaseCount;
+    uint64_t atFs;
+
+    harness_reset();
+    snprintf(command, sizeof(command), "f%u\r", step);
+    atFs = harness_serialSend(20 * SIM_FS_PER_MS, command, HARNESS_SERIAL_BAUD);
+    snprintf(command, sizeof(command), "p%u\r", BENCH_PHASE_DEAD);
+    atFs = harness_serialSend(atFs + BENCH_SERIAL_GAP_FS, command, HARNESS_SERIAL_BAUD);
+    // a fast step follows the first falling edge of the power-on step
+    atFs += BENCH_SETTLE_FS + (uint64_t)(1.0 / targetsHz[FREQ_DEFAULT] * SIM_FS_PER_S);
+
+    double windowS = 2.0 / targetsHz[step];
+    if (windowS < 0.005) {
+        windowS = 0.005;
+    }
+    harness_recordFrom(atFs);
+    harness_run(atFs + (uint64_t)(windowS * SIM_FS_PER_S) + SIM_FS_PER_MS);
+    if (harness_measure(&result.measure) != 0) {
+        result.measure.periods = 0;
+    }
+
+    // state line of f, then the dead time line
+    harness_serialRead(text, sizeof(text), &edgeError);
+    char * line = strstr(text, "\r\n");
+    if (line == NULL || sscanf(line + 2, "%u %lu", &result.setting, &deadNs) != 2) {
+        snprintf(result.mismatch, sizeof(result.mismatch), "\"%.30s\"", text);
+    }
+    result.deadS = deadNs * 1e-9;
+
+    // both edge lists in time order, the levels before the first edges
+    // are the opposite of them
+    const harness_edge_t * clock = harness_edges(&clockCount);
+    const harness_edge_t * phase = harness_phaseEdges(&phaseCount);
+    uint8_t levels[2] = {
+        (uint8_t)(clockCount ? !clock[0].level : 0), (uint8_t)(phaseCount ? !phase[0].level : 0)
+    };
+    uint64_t changeFs[2] = {0, 0};
+    uint64_t bothFs = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+    while (i < clockCount || j < phaseCount) {
+        uint8_t pin = (j >= phaseCount || (i < clockCount && clock[i].timeFs <= phase[j].timeFs)) ? 0 : 1;
+        const harness_edge_t * edge = pin ? &phase[j++] : &clock[i++];
+        if (levels[0] && levels[1]) {
+            result.overlapS += (double)(edge->timeFs - bothFs) / SIM_FS_PER_S;
+        }
+        if (edge->level && changeFs[!pin] != 0 && !levels[!pin]) {
+            double gapS = (double)(edge->timeFs - changeFs[!pin]) / SIM_FS_PER_S;
+            if (gapS < result.gapMinS) {
+                result.gapMinS = gapS;
+            }
+        }
+        if (pin && !edge->level && levels[1]) {
+            result.phasePulses++;
+        }
+        levels[pin] = edge->level;
+        changeFs[pin] = edge->timeFs;
+        bothFs = edge->timeFs;
+    }
+
+    if (write(fd, &result, sizeof(result)) != sizeof(result)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * Query the state over the serial port at atFs, run until endFs and count
+ * the reply when it matches
+ */
+static void _settingsQuery(bench_settings_t * result, uint64_t atFs, uint64_t endFs, const char * reply)
+{
+    static char text[256];
+    char expected[24];
+    double edgeError;
+
+    harness_serialSend(atFs, "?\r", HARNESS_SERIAL_BAUD);
+    harness_run(endFs);
+    harness_serialRead(text, sizeof(text), &edgeError);
+    _serialText(expected, sizeof(expected), reply);
+
+    char * end = strstr(text, "\r\n");
+    if (end != NULL) {
+        *end = 0;
+    }
+    if (end != NULL && _replyMatches(text, expected)) {
+        result->replies++;
+    } else if (result->mismatch[0] == 0) {
+        snprintf(result->mismatch, sizeof(result->mismatch), "\"%.30s\"", text);
+    }
+}
+
+/**
+ * First power-on: three UP presses and two serial commands, saved as one
+ * record after the settle time
+ */
+static void _settingsChange(bench_settings_t * result)
+{
+    uint64_t atFs;
+
+    atFs = harness_pressRepeat(HARNESS_PIN_UP, 10 * SIM_FS_PER_MS, BENCH_SETTINGS_STEP - FREQ_DEFAULT);
+    atFs = harness_serialSend(atFs, "w2\r", HARNESS_SERIAL_BAUD);
+    atFs = harness_serialSend(atFs + BENCH_SERIAL_GAP_FS, "b100\r", HARNESS_SERIAL_BAUD);
+    harness_run(atFs + BENCH_SETTINGS_SAVE_FS);
+    result->writes[0] = sim_getStats()->eepromWrites;
+}
+
+/**
+ * Second power-on: the saved step runs in the auto mode, MODE switches to
+ * the manual mode which is saved before the core sleeps
+ */
+static void _settingsRestore(bench_settings_t * result)
+{
+    uint64_t atFs = harness_press(HARNESS_PIN_MODE, 900 * SIM_FS_PER_MS);
+    uint32_t count;
+    uint32_t rising = 0;
+    uint64_t firstFs = 0;
+    uint64_t lastFs = 0;
+
+    _settingsQuery(result, 800 * SIM_FS_PER_MS, atFs + 100 * SIM_FS_PER_MS, "A $ * 2 100 *");
+    result->writes[1] = sim_getStats()->eepromWrites;
+
+    const harness_edge_t * edges = harness_edges(&count);
+    for (uint32_t i = 0; i < count && edges[i].timeFs < 800 * SIM_FS_PER_MS; i++) {
+        if (edges[i].level) {
+            if (rising++ == 0) {
+                firstFs = edges[i].timeFs;
+            }
+            lastFs = edges[i].timeFs;
+        }
+    }
+    result->firstEdgeS = (double)firstFs / SIM_FS_PER_S;
+    if (rising > 1) {
+        result->frequencyHz = (rising - 1) * (double)SIM_FS_PER_S / (double)(lastFs - firstFs);
+    }
+}
+
+/**
+ * Third power-on: manual mode restored
+ */
+static void _settingsManual(bench_settings_t * result)
+{
+    _settingsQuery(result, 100 * SIM_FS_PER_MS, 200 * SIM_FS_PER_MS, "M $ L 2 100 *");
+}
+
+/**
+ * Child process: the power-ons one after the other in this process,
+ * harness_reset() gives the firmware its initial RAM every time. Only the
+ * EEPROM is handed on. Writes the result to the pipe.
+ */
+static void _runSettings(uint8_t run, int fd)
+{
+    static void (* const powerOns[])(bench_settings_t * result) = {
+        _settingsChange, _settingsRestore, _settingsManual
+    };
+    bench_settings_t result = {{0, 0}, 0, 0.0, 0.0, "", {0}};
+
+    memset(result.eeprom, 0xFF, sizeof(result.eeprom));
+    for (uint8_t i = 0; i < sizeof(powerOns) / sizeof(powerOns[0]); i++) {
+        harness_reset();
+        memcpy(sim_eeprom(), result.eeprom, sizeof(result.eeprom));
+        powerOns[i](&result);
+        memcpy(result.eeprom, sim_eeprom(), sizeof(result.eeprom));
+    }
+
+    if (write(fd, &result, sizeof(result)) != sizeof(result)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * Child process: sweep from BENCH_SWEEP_STEP and pull nHALT, then sweep
+ * the top steps, write the replies and the output after the halt to the
+ * pipe
+ */
+static void _runSweep(uint8_t run, int fd)
+{
+    static char text[512];
+    bench_sweep_t result = {{0}, 0, 0, 0, ""};
+    char command[24];
+    char expected[6][24];
+    double edgeError;
+    uint64_t atFs;
+
+    harness_reset();
+    snprintf(command, sizeof(command), "f%u\r", BENCH_SWEEP_STEP);
+    atFs = harness_serialSend(20 * SIM_FS_PER_MS, command, HARNESS_SERIAL_BAUD);
+    snprintf(command, sizeof(command), "g%u\r", BENCH_SWEEP_DWELL_MS);
+    atFs = harness_serialSend(atFs + BENCH_SERIAL_GAP_FS, command, HARNESS_SERIAL_BAUD);
+    atFs += BENCH_SWEEP_HALT_FS;
+    sim_schedule(atFs, HARNESS_PIN_HALT, 0);
+    atFs += BENCH_SWEEP_HOLD_FS;
+    sim_schedule(atFs, HARNESS_PIN_HALT, SIM_RELEASE);
+    // the sweep restarts the auto mode by itself
+    atFs += BENCH_SETTLE_FS;
+    harness_recordFrom(atFs);
+    harness_run(atFs + 5 * SIM_FS_PER_MS);
+    if (harness_measure(&result.measure) != 0) {
+        result.measure.periods = 0;
+    }
+
+    // the top step is swept last: at the dithered one of bench-dither a
+    // start bit behind the postscaler interrupt may be taken a bit late,
+    // nothing is sent to it. Two ticks a step.
+    atFs += 10 * SIM_FS_PER_MS;
+    harness_recordFrom(UINT64_MAX);
+    snprintf(command, sizeof(command), "f%u\r", FREQ_COUNT - BENCH_SWEEP_TOP_STEPS);
+    atFs = harness_serialSend(atFs, command, HARNESS_SERIAL_BAUD);
+    atFs = harness_serialSend(atFs + BENCH_SERIAL_GAP_FS, "g50\r", HARNESS_SERIAL_BAUD);
+    harness_run(atFs + BENCH_SWEEP_TOP_STEPS * 100 * SIM_FS_PER_MS);
+
+    // the step failed comes from the reply, the others follow from it
+    harness_serialRead(text, sizeof(text), &edgeError);
+    char * line = text;
+    for (uint8_t i = 0; i < 2 && line != NULL; i++) {
+        line = strstr(line, "\r\n");
+        line = line ? line + 2 : NULL;
+    }
+    if (line == NULL || sscanf(line, "F %u %u", &result.failed, &result.lastGood) != 2) {
+        snprintf(result.mismatch, sizeof(result.mismatch), "\"%.30s\"", line ? line : text);
+    }
+    snprintf(expected[0], sizeof(expected[0]), "A %u * 4 64 *", BENCH_SWEEP_STEP);
+    snprintf(expected[1], sizeof(expected[1]), "R %u -", BENCH_SWEEP_STEP);
+    snprintf(expected[2], sizeof(expected[2]), "F %u %u", result.failed, result.failed - 1);
+    snprintf(expected[3], sizeof(expected[3]), "A %u * 4 64 *", FREQ_COUNT - BENCH_SWEEP_TOP_STEPS);
+    snprintf(expected[4], sizeof(expected[4]), "R %u -", FREQ_COUNT - BENCH_SWEEP_TOP_STEPS);
+    snprintf(expected[5], sizeof(expected[5]), "P %u %u", FREQ_COUNT - 1, FREQ_COUNT - 1);
+
+    line = text;
+    for (uint8_t i = 0; i < 6; i++) {
+        char * end = strstr(line, "\r\n");
+        if (end == NULL) {
+            break;
+        }
+        *end = 0;
+        if (_replyMatches(line, expected[i])) {
+            result.replies++;
+        } else if (result.mismatch[0] == 0) {
+            snprintf(result.mismatch, sizeof(result.mismatch), "\"%.30s\"", line);
+        }
+        line = end + 2;
+    }
+
+    if (write(fd, &result, sizeof(result)) != sizeof(result)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * Child process: lower the clock on one step, then leave the auto mode
+ * with MODE and query the state. Writes the measurement, both core clocks
+ * and the replies checked to the pipe.
+ */
+static void _runLowClock(uint8_t step, int fd)
+{
+    static char text[128];
+    bench_lowclock_t result = {{0}, 0.0, 0.0, 0, ""};
+    char expected[2][24];
+    uint64_t periodFs = (uint64_t)(SIM_FS_PER_S / targetsHz[step]);
+    double edgeError;
+    uint64_t atFs;
+
+    harness_reset();
+    atFs = _selectStep(step) + BENCH_SETTLE_FS;
+    atFs = harness_serialSend(atFs, "c1\r", HARNESS_SERIAL_BAUD);
+    // lowered at the next edge
+    atFs += periodFs + SIM_FS_PER_MS;
+    harness_recordFrom(atFs);
+    atFs += BENCH_LOWCLOCK_PERIODS * periodFs + SIM_FS_PER_MS;
+    // one run: the manual mode keeps the output, no edge is recorded after the click
+    atFs = harness_press(HARNESS_PIN_MODE, atFs);
+    atFs = harness_serialSend(atFs + BENCH_SERIAL_GAP_FS, "?\r", HARNESS_SERIAL_BAUD);
+    harness_run(atFs + BENCH_SERIAL_QUERY_FS);
+
+    uint32_t count;
+    const harness_edge_t * edges = harness_edges(&count);
+    if (harness_measure(&result.measure) != 0 || count == 0) {
+        result.measure.periods = 0;
+    } else {
+        result.lowHz = 4.0 * SIM_FS_PER_S / (double)edges[0].tcyFs;
+    }
+    result.backHz = 4.0 * SIM_FS_PER_S / (double)sim_getStats()->tcyFs;
+
+    harness_serialRead(text, sizeof(text), &edgeError);
+    snprintf(expected[0], sizeof(expected[0]), "1");
+    snprintf(expected[1], sizeof(expected[1]), "M %u * 4 64 *", step);
+    char * line = text;
+    for (uint8_t i = 0; i < 2; i++) {
+        char * end = strstr(line, "\r\n");
+        if (end == NULL) {
+            break;
+        }
+        *end = 0;
+        if (_replyMatches(line, expected[i])) {
+            result.replies++;
+        } else if (result.mismatch[0] == 0) {
+            snprintf(result.mismatch, sizeof(result.mismatch), "\"%.30s\"", line);
+        }
+        line = end + 2;
+    }
+
+    if (write(fd, &result, sizeof(result)) != sizeof(result)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * Clock off 8 MHz now
+ */
+static double _clockPpm(void)
+{
+    return 1e6 * (4.0 * SIM_FS_PER_S / BENCH_CLOCK_HZ / (double)sim_getStats()->tcyFs - 1.0);
+}
+
+/**
+ * Reply lines against the expected fields, the first mismatch is kept
+ */
+static void _calibrationReplies(char * text, const char * const expected[], uint8_t count)
+{
+    char * line = text;
+
+    for (uint8_t i = 0; i < count; i++) {
+        char * end = strstr(line, "\r\n");
+        if (end == NULL) {
+            break;
+        }
+        *end = 0;
+        if (_replyMatches(line, expected[i])) {
+            calibration.replies++;
+        } else if (calibration.mismatch[0] == 0) {
+            snprintf(calibration.mismatch, sizeof(calibration.mismatch), "\"%.30s\"", line);
+        }
+        // the trim and the error of a calibration done
+        if (line[0] == 'D' && sscanf(line, "D %d %d", &calibration.trim, &calibration.errorPpm) != 2) {
+            calibration.trim = INT32_MAX;
+        }
+        line = end + 2;
+    }
+}
+
+/**
+ * Child process: run 0 calibrates from the manual mode with the reference
+ * on RA1, run 1 is the next power-on - the trim applies, a calibration
+ * without the reference fails. Writes the result to the pipe.
+ */
+static void _runCalibration(uint8_t run, int fd)
+{
+    static char text[256];
+    static const char * const calibrateReplies[] = {"M * L 4 64 *", "R 0 -", "D * *"};
+    static const char * const restoreReplies[] = {"I * -", "R * -", "F * -"};
+    double edgeError;
+    uint64_t atFs;
+
+    harness_reset();
+    memcpy(sim_eeprom(), calibration.eeprom, sizeof(calibration.eeprom));
+    sim_setOscillatorError(BENCH_CALIBRATION_ERROR_PPM);
+
+    if (run == 0) {
+        char command[8];
+        atFs = harness_serialSend(20 * SIM_FS_PER_MS, "l\r", HARNESS_SERIAL_BAUD);
+        snprintf(command, sizeof(command), "o%u\r", BENCH_CALIBRATION_PERIODS);
+        atFs = harness_serialSend(atFs + BENCH_SERIAL_GAP_FS, command, HARNESS_SERIAL_BAUD);
+        atFs += 5 * BENCH_SERIAL_GAP_FS;
+        for (uint8_t i = 0; i < BENCH_CALIBRATION_EDGES; i++) {
+            sim_schedule(atFs, HARNESS_PIN_RX, 0);
+            sim_schedule(atFs + BENCH_CALIBRATION_LOW_FS, HARNESS_PIN_RX, SIM_RELEASE);
+            atFs += SIM_FS_PER_S;
+        }
+        harness_run(atFs);
+        harness_serialRead(text, sizeof(text), &edgeError);
+        _calibrationReplies(text, calibrateReplies, 3);
+    } else if (run == 2) {
+        // MODE ends a calibration, the auto mode takes TMR1 over
+        uint32_t count;
+        atFs = harness_serialSend(20 * SIM_FS_PER_MS, "l\r", HARNESS_SERIAL_BAUD);
+        atFs = harness_serialSend(atFs + BENCH_SERIAL_GAP_FS, "o4\r", HARNESS_SERIAL_BAUD);
+        atFs = harness_press(HARNESS_PIN_MODE, atFs + BENCH_CALIBRATION_MODE_FS);
+        harness_recordFrom(atFs);
+        harness_run(atFs + BENCH_CALIBRATION_TAKEOVER_FS);
+        harness_edges(&count);
+        calibration.takeoverEdges = count;
+        if (write(fd, &calibration, sizeof(calibration)) != sizeof(calibration)) {
+            _exit(1);
+        }
+        _exit(0);
+    } else {
+        // the power-on clock, then a calibration that gets no edge
+        atFs = harness_serialSend(20 * SIM_FS_PER_MS, "o\r", HARNESS_SERIAL_BAUD);
+        atFs = harness_serialSend(atFs + BENCH_SERIAL_GAP_FS, "o1\r", HARNESS_SERIAL_BAUD);
+        harness_run(atFs + BENCH_CALIBRATION_FAIL_FS);
+        harness_serialRead(text, sizeof(text), &edgeError);
+        _calibrationReplies(text, restoreReplies, 3);
+    }
+    calibration.clockPpm[run] = _clockPpm();
+    memcpy(calibration.eeprom, sim_eeprom(), sizeof(calibration.eeprom));
+
+    if (write(fd, &calibration, sizeof(calibration)) != sizeof(calibration)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * Slowest fast step, dithered (TMR2 interrupt) or not (a burst of TMR1
+ * overflows), FREQ_COUNT when the table has none
+ */
+static uint8_t _isrStep(uint8_t dithered)
+{
+    for (uint8_t i = FREQ_SLOW_LAST + 1; i < FREQ_COUNT; i++) {
+        if ((frequencyTable[i].fraction != 0) == dithered) {
+            return i;
+        }
+    }
+    return FREQ_COUNT;
+}
+
+/**
+ * Child process: drive ISR paths, write the cycles per path to the pipe.
+ * 0 - serial traffic on the two-phase slow step and a button, 1 - fast
+ * burst, 2 - nHALT on the dithered fast step, 3 - nHALT on the slow step
+ */
+static void _runIsrPaths(uint8_t run, int fd)
+{
+    uint8_t step = BENCH_SERIAL_STEP;
+    char command[24];
+    uint64_t atFs;
+    uint64_t endFs;
+
+    if (run == 1 || run == 2) {
+        step = _isrStep(run == 2);
+        if (step == FREQ_COUNT) {
+            step = FREQ_COUNT - 1;
+        }
+    }
+
+    harness_reset();
+    snprintf(command, sizeof(command), "f%u\r", step);
+    atFs = harness_serialSend(20 * SIM_FS_PER_MS, command, HARNESS_SERIAL_BAUD);
+    // a fast step follows the first falling edge of the power-on step
+    atFs += BENCH_SETTLE_FS + (uint64_t)(1.0 / targetsHz[FREQ_DEFAULT] * SIM_FS_PER_S);
+    if (run == 0) {
+        snprintf(command, sizeof(command), "p%u\r", BENCH_PHASE_DEAD);
+        atFs = harness_serialSend(atFs, command, HARNESS_SERIAL_BAUD);
+        for (endFs = atFs + BENCH_SERIAL_TRAFFIC_FS; atFs < endFs; atFs += BENCH_SERIAL_QUERY_FS) {
+            harness_serialSend(atFs, "?\r", HARNESS_SERIAL_BAUD);
+        }
+        endFs = harness_press(HARNESS_PIN_UP, atFs) + BENCH_SETTLE_FS;
+    } else if (run == 1) {
+        atFs = harness_serialSend(atFs, "l\r", HARNESS_SERIAL_BAUD) + BENCH_SERIAL_GAP_FS;
+        endFs = harness_hold(HARNESS_PIN_MODE, atFs)
+            + (uint64_t)(BENCH_BURST_CYCLES / targetsHz[step] * SIM_FS_PER_S) + SIM_FS_PER_MS;
+    } else {
+        sim_schedule(atFs + BENCH_ISR_HALT_FS, HARNESS_PIN_HALT, 0);
+        endFs = atFs + 2 * BENCH_ISR_HALT_FS;
+    }
+    harness_run(endFs);
+
+    if (write(fd, sim_getStats()->isrPaths, sizeof(sim_getStats()->isrPaths)) != sizeof(sim_getStats()->isrPaths)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * Run the child for the steps first..last in parallel processes
+ */
+static int _spawn(bench_child_t child, uint8_t first, uint8_t last, int fds[], pid_t pids[])
+{
+    for (uint8_t i = first; i <= last; i++) {
+        int pipeFds[2];
+        if (pipe(pipeFds) != 0) {
+            perror("pipe");
+            return -1;
+        }
+        fflush(stdout);
+        pids[i] = fork();
+        if (pids[i] == 0) {
+            close(pipeFds[0]);
+            child(i, pipeFds[1]);
+        }
+        close(pipeFds[1]);
+        fds[i] = pipeFds[0];
+    }
+    return 0;
+}
+
+/**
+ * Burst table, returns the number of failed steps
+ */
+static int _checkBursts(void)
+{
+    int fds[FREQ_COUNT];
+    pid_t pids[FREQ_COUNT];
+    int failures = 0;
+
+    if (_spawn(_runBurst, FREQ_BLINK_LAST + 1, FREQ_COUNT - 1, fds, pids) != 0) {
+        return 1;
+    }
+
+    printf("\n%-10s %10s %14s %14s  %s\n",
+        "burst", "pulses", "min high ns", "min low ns", "result");
+
+    for (uint8_t i = FREQ_BLINK_LAST + 1; i < FREQ_COUNT; i++) {
+        harness_pulses_t pulses = {0};
+        int status = 0;
+        ssize_t got = read(fds[i], &pulses, sizeof(pulses));
+        close(fds[i]);
+        waitpid(pids[i], &status, 0);
+
+        // dithered fast steps have no fixed period - no burst
+        uint32_t expected = (i > FREQ_SLOW_LAST && frequencyTable[i].fraction != 0)
+            ? 0 : BENCH_BURST_CYCLES;
+        double halfS = 0.5 / targetsHz[i];
+        int ok = got == sizeof(pulses) && pulses.count == expected && !pulses.endLevel;
+        if (ok && expected) {
+            ok = fabs(pulses.highMinS - halfS) <= halfS * BENCH_BURST_PERCENT / 100.0
+                && fabs(pulses.lowMinS - halfS) <= halfS * BENCH_BURST_PERCENT / 100.0;
+        }
+
+        printf("%-10s %10u %14.0f %14.0f  %s\n",
+            names[i], pulses.count, pulses.highMinS * 1e9, pulses.lowMinS * 1e9,
+            ok ? (expected ? "ok" : "ok (dithered, none)") : "FAIL");
+        if (!ok) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+/**
+ * Switch table in one direction, returns the number of failed switches
+ */
+static int _checkSwitches(uint8_t down)
+{
+    int fds[FREQ_COUNT];
+    pid_t pids[FREQ_COUNT];
+    int failures = 0;
+
+    switchDown = down;
+    if (_spawn(_runSwitch, FREQ_BLINK_LAST, FREQ_COUNT - 2, fds, pids) != 0) {
+        return 1;
+    }
+
+    for (uint8_t i = FREQ_BLINK_LAST; i < FREQ_COUNT - 1; i++) {
+        bench_switch_t result = {0};
+        int status = 0;
+        ssize_t got = read(fds[i], &result, sizeof(result));
+        close(fds[i]);
+        waitpid(pids[i], &status, 0);
+
+        uint8_t from = down ? i + 1 : i;
+        uint8_t to = down ? i : i + 1;
+        double halfFromS = 0.5 / targetsHz[from];
+        double halfToS = 0.5 / targetsHz[to];
+        // a dithered half period is a timer tick shorter or longer
+        double tickS = 0.0;
+        if (frequencyTable[from].fraction != 0 && _tickS(from) > tickS) {
+            tickS = _tickS(from);
+        }
+        if (frequencyTable[to].fraction != 0 && _tickS(to) > tickS) {
+            tickS = _tickS(to);
+        }
+        double minS = (halfFromS < halfToS ? halfFromS : halfToS) * 0.99 - tickS;
+        double maxS = (halfFromS + halfToS) * 1.01 + tickS + BENCH_SWITCH_SLACK_S;
+        int ok = got == sizeof(result) && result.phases > 4
+            && result.phaseMinS >= minS && result.phaseMaxS <= maxS;
+
+        char name[32];
+        snprintf(name, sizeof(name), "%s>%s", names[from], names[to]);
+        printf("%-18s %10u %14.0f %14.0f  %s\n", name, result.phases,
+            result.phaseMinS * 1e9, result.phaseMaxS * 1e9, ok ? "ok" : "FAIL");
+        if (!ok) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+/**
+ * nHALT during a switch or its reply, returns the number of failed runs
+ */
+static int _checkHaltSwitch(void)
+{
+    int fds[BENCH_HALT_SWITCH_RUNS];
+    pid_t pids[BENCH_HALT_SWITCH_RUNS];
+    int failures = 0;
+
+    if (_spawn(_runHaltSwitch, 0, BENCH_HALT_SWITCH_RUNS - 1, fds, pids) != 0) {
+        return 1;
+    }
+
+    printf("\n%-18s %10s %14s %14s %10s  %s\n", "halt in switch", "replies", "halt after us", "edges",
+        "reply", "result");
+    for (uint8_t i = 0; i < BENCH_HALT_SWITCH_RUNS; i++) {
+        bench_halt_switch_t result = {0, 0, 0, ""};
+        int status = 0;
+        ssize_t got = read(fds[i], &result, sizeof(result));
+        close(fds[i]);
+        waitpid(pids[i], &status, 0);
+
+        // stopped LOW, then the rising edge of the UP click. The reply to
+        // the switch only shows whether the halt cut it.
+        int ok = got == sizeof(result) && result.replies == 4 && result.mismatch[0] == 0
+            && result.edges == 1;
+        char name[32];
+        snprintf(name, sizeof(name), "%s>%s", names[BENCH_HALT_SWITCH_STEP], names[BENCH_HALT_SWITCH_STEP + 1]);
+        printf("%-18s %8u/4 %14.0f %14u %10s  %s %s\n", name, result.replies,
+            (double)haltSwitchDelaysFs[i] / SIM_FS_PER_US, result.edges, result.cut ? "cut" : "intact",
+            ok ? "ok" : "FAIL", result.mismatch);
+        if (!ok) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+/**
+ * Sleep in idle manual mode, returns 1 on a failure
+ */
+static int _checkIdle(void)
+{
+    int fds[FREQ_COUNT];
+    pid_t pids[FREQ_COUNT];
+    bench_idle_t result = {0};
+    int status = 0;
+
+    if (_spawn(_runIdle, 0, 0, fds, pids) != 0) {
+        return 1;
+    }
+    ssize_t got = read(fds[0], &result, sizeof(result));
+    close(fds[0]);
+    waitpid(pids[0], &status, 0);
+
+    // the click has to wake the core and set the output HIGH
+    int ok = got == sizeof(result) && result.sleeps >= 2 && result.level == '1'
+        && 100.0 * result.awakeRatio <= BENCH_AWAKE_PERCENT;
+
+    printf("\n%-18s %10s %14s %14s  %s\n", "idle", "sleeps", "awake %", "output", "result");
+    printf("%-18s %10u %14.3f %14c  %s\n", "manual", result.sleeps,
+        100.0 * result.awakeRatio, result.level ? result.level : '-', ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+/**
+ * Serial port, returns the number of failed runs
+ */
+static int _checkSerial(void)
+{
+    int fds[FREQ_COUNT];
+    pid_t pids[FREQ_COUNT];
+    int failures = 0;
+
+    if (_spawn(_runSerial, 0, BENCH_SERIAL_RUNS - 1, fds, pids) != 0) {
+        return 1;
+    }
+
+    printf("\n%-18s %10s %14s %14s %14s  %s\n",
+        "serial", "replies", "TX edge bits", "min half us", "max half us", "result");
+
+    for (uint8_t i = 0; i < BENCH_SERIAL_RUNS; i++) {
+        bench_serial_t result = {0};
+        int status = 0;
+        ssize_t got = read(fds[i], &result, sizeof(result));
+        close(fds[i]);
+        waitpid(pids[i], &status, 0);
+
+        int ok = got == sizeof(result) && result.expected > 0
+            && result.replies == result.expected && result.mismatch[0] == 0
+            && result.edgeError <= BENCH_SERIAL_EDGE_BITS;
+        char name[32];
+        if (i == BENCH_SERIAL_RUNS - 1) {
+            // the core went back to sleep after every command
+            ok = ok && result.sleeps >= sizeof(serialSleepScript) / sizeof(serialSleepScript[0]);
+            snprintf(name, sizeof(name), "sleeping");
+            printf("%-18s %6u/%-3u %14.3f %14s %14s  %s %s\n", name, result.replies, result.expected,
+                result.edgeError, "-", "-", ok ? "ok" : "FAIL", result.mismatch);
+        } else {
+            double halfS = 0.5 / targetsHz[BENCH_SERIAL_STEP];
+            ok = ok && result.phaseMinS >= halfS - 1e-6 && result.phaseMaxS <= halfS + 1e-6;
+            snprintf(name, sizeof(name), "%.0f baud", serialBauds[i]);
+            printf("%-18s %6u/%-3u %14.3f %14.3f %14.3f  %s %s\n", name, result.replies, result.expected,
+                result.edgeError, result.phaseMinS * 1e6, result.phaseMaxS * 1e6,
+                ok ? "ok" : "FAIL", result.mismatch);
+        }
+        if (!ok) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+/**
+ * Duty cycle table, returns the number of failed steps
+ */
+static int _checkDuty(void)
+{
+    int fds[FREQ_COUNT];
+    pid_t pids[FREQ_COUNT];
+    int failures = 0;
+
+    if (_spawn(_runDuty, FREQ_BLINK_LAST + 1, FREQ_COUNT - 1, fds, pids) != 0) {
+        return 1;
+    }
+
+    printf("\n%-10s %10s %14s %14s %14s %10s  %s\n",
+        "duty", "reported %", "high ns", "measured ns", "low ns", "error ppm", "result");
+
+    for (uint8_t i = FREQ_BLINK_LAST + 1; i < FREQ_COUNT; i++) {
+        bench_duty_t result = {{0}, 0, 0.0, 0.0, ""};
+        int status = 0;
+        ssize_t got = read(fds[i], &result, sizeof(result));
+        close(fds[i]);
+        waitpid(pids[i], &status, 0);
+
+        const harness_measure_t * measure = &result.measure;
+        double periodS = measure->frequencyHz > 0.0 ? 1.0 / measure->frequencyHz : 0.0;
+        double highS = measure->highRatio * periodS;
+        double ppm = 1e6 * (measure->frequencyHz - targetsHz[i]) / targetsHz[i];
+        // a slow step may keep a longer high time, never a longer low time
+        int ok = got == sizeof(result) && measure->periods > 0 && result.mismatch[0] == 0
+            && result.percent == BENCH_DUTY_SET && fabs(ppm) <= BENCH_FREQUENCY_PPM
+            && result.highS <= result.lowS
+            && fabs(highS - result.highS) <= result.highS * BENCH_DUTY_TIME_PERCENT / 100.0 + _tickS(i)
+            && fabs(result.highS + result.lowS - 1.0 / targetsHz[i]) <= 2.0 * _tickS(i);
+
+        printf("%-10s %10u %14.0f %14.0f %14.0f %10.1f  %s %s\n",
+            names[i], result.percent, result.highS * 1e9, highS * 1e9, result.lowS * 1e9, ppm,
+            ok ? "ok" : "FAIL", result.mismatch);
+        if (!ok) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+/**
+ * Two-phase table, returns the number of failed steps
+ */
+static int _checkPhases(void)
+{
+    int fds[FREQ_COUNT];
+    pid_t pids[FREQ_COUNT];
+    int failures = 0;
+
+    if (_spawn(_runPhases, FREQ_BLINK_LAST + 1, FREQ_COUNT - 1, fds, pids) != 0) {
+        return 1;
+    }
+
+    printf("\n%-10s %10s %14s %14s %14s %10s  %s\n",
+        "phases", "pulses", "dead ns", "min gap ns", "overlap ns", "error ppm", "result");
+
+    for (uint8_t i = FREQ_BLINK_LAST + 1; i < FREQ_COUNT; i++) {
+        bench_phase_t result = {{0}, 0, 0.0, 0, 0.0, 0.0, ""};
+        int status = 0;
+        ssize_t got = read(fds[i], &result, sizeof(result));
+        close(fds[i]);
+        waitpid(pids[i], &status, 0);
+
+        double ppm = 1e6 * (result.measure.frequencyHz - targetsHz[i]) / targetsHz[i];
+        // RC4 pulses in every period, never high with RC5, the dead time kept
+        int ok = got == sizeof(result) && result.measure.periods > 0 && result.mismatch[0] == 0
+            && result.setting == BENCH_PHASE_DEAD && fabs(ppm) <= BENCH_FREQUENCY_PPM
+            && result.phasePulses + 1 >= result.measure.periods && result.overlapS == 0.0
+            && result.gapMinS >= result.deadS - 1e-9;
+
+        printf("%-10s %10u %14.0f %14.0f %14.0f %10.1f  %s %s\n",
+            names[i], result.phasePulses, result.deadS * 1e9, result.gapMinS * 1e9,
+            result.overlapS * 1e9, ppm, ok ? "ok" : "FAIL", result.mismatch);
+        if (!ok) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+/**
+ * Settings kept over a power cycle, returns 1 on a failure
+ */
+static int _checkSettings(void)
+{
+    int fds[FREQ_COUNT];
+    pid_t pids[FREQ_COUNT];
+    bench_settings_t result = {{0, 0}, 0, 0.0, 0.0, "", {0}};
+    int status = 0;
+
+    if (_spawn(_runSettings, 0, 0, fds, pids) != 0) {
+        return 1;
+    }
+    ssize_t got = read(fds[0], &result, sizeof(result));
+    close(fds[0]);
+    waitpid(pids[0], &status, 0);
+
+    // the slow steps start LOW, the first edge comes a half period later
+    double startS = BENCH_SETTINGS_START_S;
+    if (BENCH_SETTINGS_STEP <= FREQ_SLOW_LAST) {
+        startS += 0.5 / targetsHz[BENCH_SETTINGS_STEP];
+    }
+    double ppm = 1e6 * (result.frequencyHz - targetsHz[BENCH_SETTINGS_STEP]) / targetsHz[BENCH_SETTINGS_STEP];
+    int ok = got == sizeof(result) && result.replies == 2 && result.mismatch[0] == 0
+        && result.writes[0] == BENCH_SETTINGS_WRITES && result.writes[1] == BENCH_SETTINGS_WRITES
+        && result.firstEdgeS <= startS && fabs(ppm) <= BENCH_FREQUENCY_PPM;
+
+    printf("\n%-18s %10s %14s %14s %14s  %s\n",
+        "settings", "writes", "restored", "first edge ms", "error ppm", "result");
+    printf("%-18s %4u + %-3u %12u/2 %14.3f %14.1f  %s %s\n", names[BENCH_SETTINGS_STEP],
+        result.writes[0], result.writes[1], result.replies, result.firstEdgeS * 1e3, ppm,
+        ok ? "ok" : "FAIL", result.mismatch);
+    return ok ? 0 : 1;
+}
+
+/**
+ * Sweep check, returns 1 on a failure
+ */
+static int _checkSweep(void)
+{
+    int fds[FREQ_COUNT];
+    pid_t pids[FREQ_COUNT];
+    bench_sweep_t result = {{0}, 0, 0, 0, ""};
+    int status = 0;
+
+    if (_spawn(_runSweep, 0, 0, fds, pids) != 0) {
+        return 1;
+    }
+    ssize_t got = read(fds[0], &result, sizeof(result));
+    close(fds[0]);
+    waitpid(pids[0], &status, 0);
+
+    // the halt lands a few steps into the sweep, never in its first step
+    uint8_t held = got == sizeof(result) && result.failed > BENCH_SWEEP_STEP
+        && result.failed < FREQ_COUNT - 1;
+    double ppm = held && result.measure.periods > 0
+        ? 1e6 * (result.measure.frequencyHz - targetsHz[result.lastGood]) / targetsHz[result.lastGood]
+        : 1e9;
+    int ok = held && result.replies == 6 && result.mismatch[0] == 0 && fabs(ppm) <= BENCH_FREQUENCY_PPM;
+
+    printf("\n%-18s %10s %14s %14s %14s  %s\n",
+        "sweep", "replies", "failed", "last good", "error ppm", "result");
+    printf("%-18s %8u/6 %14s %14s %14.1f  %s %s\n", names[BENCH_SWEEP_STEP], result.replies,
+        held ? names[result.failed] : "-", held ? names[result.lastGood] : "-", ppm,
+        ok ? "ok" : "FAIL", result.mismatch);
+    return ok ? 0 : 1;
+}
+
+/**
+ * Low clock table, returns the number of failed steps
+ */
+static int _checkLowClock(void)
+{
+    int fds[FREQ_COUNT];
+    pid_t pids[FREQ_COUNT];
+    int failures = 0;
+    uint8_t first = FREQ_COUNT;
+    uint8_t last = 0;
+
+    // the steps with a TMR1 prescaler are the slow end of the table
+    for (uint8_t i = 0; i <= FREQ_SLOW_LAST; i++) {
+        if (targetsHz[i] >= BENCH_LOWCLOCK_FROM_HZ && (frequencyTable[i].timerControl & 0x30)) {
+            first = first < i ? first : i;
+            last = i;
+        }
+    }
+    if (first > last) {
+        return 0;
+    }
+    if (_spawn(_runLowClock, first, last, fds, pids) != 0) {
+        return 1;
+    }
+
+    printf("\n%-10s %14s %14s %10s %10s  %s\n",
+        "low clock", "core Hz", "back Hz", "error ppm", "replies", "result");
+
+    for (uint8_t i = first; i <= last; i++) {
+        bench_lowclock_t result = {{0}, 0.0, 0.0, 0, ""};
+        int status = 0;
+        ssize_t got = read(fds[i], &result, sizeof(result));
+        close(fds[i]);
+        waitpid(pids[i], &status, 0);
+
+        double clockHz = BENCH_CLOCK_HZ / (1 << ((frequencyTable[i].timerControl >> 4) & 0x03));
+        double ppm = result.measure.periods > 0
+            ? 1e6 * (result.measure.frequencyHz - targetsHz[i]) / targetsHz[i]
+            : 1e9;
+        int ok = got == sizeof(result) && fabs(ppm) <= BENCH_FREQUENCY_PPM
+            && fabs(result.lowHz - clockHz) < 1.0 && fabs(result.backHz - BENCH_CLOCK_HZ) < 1.0
+            && result.replies == 2 && result.mismatch[0] == 0;
+
+        printf("%-10s %14.0f %14.0f %10.1f %8u/2  %s %s\n",
+            names[i], result.lowHz, result.backHz, ppm, result.replies,
+            ok ? "ok" : "FAIL", result.mismatch);
+        if (!ok) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+/**
+ * Calibration check, returns 1 on a failure
+ */
+static int _checkCalibration(void)
+{
+    int fds[FREQ_COUNT];
+    pid_t pids[FREQ_COUNT];
+    int status = 0;
+    int expectedTrim = 0;
+    double bestPpm = 1e9;
+
+    // the trim nearest to the nominal clock
+    for (int trim = -16; trim <= 15; trim++) {
+        double ppm = 1e6 * ((1.0 + BENCH_CALIBRATION_ERROR_PPM / 1e6 + trim * SIM_OSCTUNE_STEP_PPM / 1e6) - 1.0);
+        if (fabs(ppm) < fabs(bestPpm)) {
+            bestPpm = ppm;
+            expectedTrim = trim;
+        }
+    }
+
+    memset(calibration.eeprom, 0xFF, sizeof(calibration.eeprom));
+    for (uint8_t run = 0; run < 3; run++) {
+        if (_spawn(_runCalibration, run, run, fds, pids) != 0) {
+            return 1;
+        }
+        ssize_t got = read(fds[run], &calibration, sizeof(calibration));
+        close(fds[run]);
+        waitpid(pids[run], &status, 0);
+        if (got != sizeof(calibration)) {
+            calibration.replies = 0;
+            break;
+        }
+    }
+
+    int ok = calibration.replies == 6 && calibration.mismatch[0] == 0
+        && calibration.trim == expectedTrim
+        && fabs(calibration.errorPpm - calibration.clockPpm[0]) <= BENCH_CALIBRATION_PPM
+        && fabs(calibration.clockPpm[1] - calibration.clockPpm[0]) <= 1.0
+        && calibration.takeoverEdges > 0;
+
+    printf("\n%-18s %10s %14s %14s %14s %10s  %s\n",
+        "calibration", "replies", "trim", "reported ppm", "clock ppm", "mode edges", "result");
+    char label[24];
+    snprintf(label, sizeof(label), "%+d ppm", BENCH_CALIBRATION_ERROR_PPM);
+    printf("%-18s %8u/6 %9d (%3d) %14d %7.1f %6.1f %10u  %s %s\n", label,
+        calibration.replies, calibration.trim, expectedTrim, calibration.errorPpm,
+        calibration.clockPpm[0], calibration.clockPpm[1], calibration.takeoverEdges,
+        ok ? "ok" : "FAIL", calibration.mismatch);
+    return ok ? 0 : 1;
+}
+
+/**
+ * ISR cycle budget table, returns the number of paths over their budget
+ * or not driven
+ */
+static int _checkIsrPaths(void)
+{
+    int fds[FREQ_COUNT];
+    pid_t pids[FREQ_COUNT];
+    sim_isr_path_stats_t paths[SIM_ISR_PATHS] = {{0}};
+    int failures = 0;
+
+    if (_spawn(_runIsrPaths, 0, BENCH_ISR_RUNS - 1, fds, pids) != 0) {
+        return 1;
+    }
+    for (uint8_t run = 0; run < BENCH_ISR_RUNS; run++) {
+        sim_isr_path_stats_t runPaths[SIM_ISR_PATHS] = {{0}};
+        int status = 0;
+        ssize_t got = read(fds[run], runPaths, sizeof(runPaths));
+        close(fds[run]);
+        waitpid(pids[run], &status, 0);
+        if (got != sizeof(runPaths)) {
+            failures++;
+        }
+        for (uint8_t i = 0; i < SIM_ISR_PATHS; i++) {
+            paths[i].count += runPaths[i].count;
+            if (runPaths[i].maxCycles > paths[i].maxCycles) {
+                paths[i].maxCycles = runPaths[i].maxCycles;
+            }
+        }
+    }
+
+    printf("\n%-10s %10s %14s %10s  %s\n", "isr path", "entries", "model cycles", "budget", "result");
+    for (uint8_t i = 0; i < SIM_ISR_SHARED; i++) {
+        // a table without a burst or a dithered fast step has no such path
+        uint8_t driven = (i != SIM_ISR_TMR1 || _isrStep(0) != FREQ_COUNT)
+            && (i != SIM_ISR_TMR2 || _isrStep(1) != FREQ_COUNT);
+        int ok = paths[i].maxCycles <= isrBudgets[i] && (paths[i].count > 0 || !driven);
+
+        printf("%-10s %10u %14u %10u  %s\n", isrNames[i], paths[i].count, paths[i].maxCycles,
+            isrBudgets[i], ok ? (driven ? "ok" : "ok (none)") : "FAIL");
+        if (!ok) {
+            failures++;
+        }
+    }
+    printf("%-10s %10u %14u %10s\n", "shared", paths[SIM_ISR_SHARED].count,
+        paths[SIM_ISR_SHARED].maxCycles, "-");
+    return failures;
+}
+
+int main(void)
+{
+    int fds[FREQ_COUNT];
+    pid_t pids[FREQ_COUNT];
+    int failures = 0;
+
+    if (_spawn(_runStep, 0, FREQ_COUNT - 1, fds, pids) != 0) {
+        return 1;
+    }
+
+    printf("%-10s %14s %18s %10s %8s %10s %10s  %s\n",
+        "step", "nominal Hz", "measured Hz", "error ppm", "high %", "jitter ns", "periods", "result");
+
+    for (uint8_t i = 0; i < FREQ_COUNT; i++) {
+        harness_measure_t measure = {0};
+        int status = 0;
+        ssize_t got = read(fds[i], &measure, sizeof(measure));
+        close(fds[i]);
+        waitpid(pids[i], &status, 0);
+
+        if (got != sizeof(measure) || measure.periods == 0) {
+            printf("%-10s %14.3f %18s %10s %8s %10s %10s  FAIL (no output)\n",
+                names[i], targetsHz[i], "-", "-", "-", "-", "-");
+            failures++;
+            continue;
+        }
+
+        double ppm = 1e6 * (measure.frequencyHz - targetsHz[i]) / targetsHz[i];
+        double high = 100.0 * measure.highRatio;
+        int ok = fabs(ppm) <= BENCH_FREQUENCY_PPM
+            && fabs(high - 50.0) <= BENCH_DUTY_PERCENT;
+
+        printf("%-10s %14.3f %18.6f %10.1f %8.2f %10.0f %10u  %s\n",
+            names[i], targetsHz[i], measure.frequencyHz, ppm, high,
+            measure.jitterS * 1e9, measure.periods, ok ? "ok" : "FAIL");
+        if (!ok) {
+            failures++;
+        }
+    }
+
+    failures += _checkBursts();
+
+    printf("\n%-18s %10s %14s %14s  %s\n",
+        "switch", "phases", "min ns", "max ns", "result");
+    failures += _checkSwitches(0);
+    failures += _checkSwitches(1);
+    failures += _checkHaltSwitch();
+    failures += _checkIdle();
+    failures += _checkSerial();
+    failures += _checkDuty();
+    failures += _checkPhases();
+    failures += _checkSettings();
+    failures += _checkSweep();
+    failures += _checkLowClock();
+    failures += _checkCalibration();
+    failures += _checkIsrPaths();
+
+    if (failures) {
+        printf("%d step(s) out of tolerance\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,317 @@
+/*
+ * File:   harness.c
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "harness.h"
+#include "vcd.h"
+
+typedef struct {
+    harness_edge_t * edges;
+    uint32_t count;
+    uint32_t capacity;
+} harness_track_t;
+
+// clock output (RC5) and second phase (RC4)
+static harness_track_t clockTrack = {NULL, 0, 0};
+static harness_track_t phaseTrack = {NULL, 0, 0};
+static uint64_t recordFromFs = 0;
+static uint8_t vcdEnabled = 0;
+
+// serial TX pin, fixed size - a test sends a few hundred characters
+#define HARNESS_TX_EDGES        65536
+static harness_edge_t txEdges[HARNESS_TX_EDGES];
+static uint32_t txEdgeCount = 0;
+
+
+static void _record(harness_track_t * track, char level, uint64_t timeFs)
+{
+    if (track->count == track->capacity) {
+        track->capacity = track->capacity ? track->capacity * 2 : 1024;
+        track->edges = realloc(track->edges, track->capacity * sizeof(harness_edge_t));
+        if (track->edges == NULL) {
+            abort();
+        }
+    }
+    track->edges[track->count].timeFs = timeFs;
+    track->edges[track->count].tcyFs = sim_getStats()->tcyFs;
+    track->edges[track->count].level = (uint8_t)(level == '1');
+    track->count++;
+}
+
+static void _observer(uint8_t pin, char level, uint64_t timeFs)
+{
+    if (vcdEnabled) {
+        vcd_change(pin, level, timeFs);
+    }
+
+    if (pin == HARNESS_PIN_TX && level != 'z' && txEdgeCount < HARNESS_TX_EDGES) {
+        txEdges[txEdgeCount].timeFs = timeFs;
+        txEdges[txEdgeCount].level = (uint8_t)(level == '1');
+        txEdgeCount++;
+    }
+
+    if (timeFs < recordFromFs || level == 'z') {
+        return;
+    }
+    if (pin == HARNESS_PIN_CLK) {
+        _record(&clockTrack, level, timeFs);
+    } else if (pin == HARNESS_PIN_PHASE) {
+        _record(&phaseTrack, level, timeFs);
+    }
+}
+
+void harness_reset(void)
+{
+    clockTrack.count = 0;
+    phaseTrack.count = 0;
+    txEdgeCount = 0;
+    recordFromFs = 0;
+    sim_reset();
+    sim_eepromErase();
+    sim_setObserver(_observer);
+}
+
+uint64_t harness_press(uint8_t pin, uint64_t atFs)
+{
+    sim_schedule(atFs, pin, 0);
+    sim_schedule(atFs + HARNESS_PRESS_FS, pin, SIM_RELEASE);
+
+    return atFs + HARNESS_PRESS_FS + HARNESS_PRESS_GAP_FS;
+}
+
+uint64_t harness_hold(uint8_t pin, uint64_t atFs)
+{
+    sim_schedule(atFs, pin, 0);
+    sim_schedule(atFs + HARNESS_HOLD_FS, pin, SIM_RELEASE);
+
+    return atFs + HARNESS_HOLD_FS + HARNESS_PRESS_GAP_FS;
+}
+
+uint64_t harness_pressBounce(uint8_t pin, uint64_t atFs)
+{
+    // open / closed times of the contact, in bounce sixteenths
+    static const uint8_t bounce[] = {1, 2, 5, 9};
+    uint64_t releaseFs = atFs + HARNESS_PRESS_FS;
+
+    for (uint8_t i = 0; i < sizeof(bounce); i++) {
+        uint64_t bounceFs = bounce[i] * HARNESS_BOUNCE_FS / 16;
+        sim_schedule(atFs + bounceFs, pin, (i & 1) ? 0 : SIM_RELEASE);
+        sim_schedule(releaseFs + bounceFs, pin, (i & 1) ? SIM_RELEASE : 0);
+    }
+    return harness_press(pin, atFs);
+}
+
+uint64_t harness_pressRepeat(uint8_t pin, uint64_t atFs, uint8_t count)
+{
+    while (count--) {
+        atFs = harness_press(pin, atFs);
+    }
+    return atFs;
+}
+
+void harness_recordFrom(uint64_t fromFs)
+{
+    recordFromFs = fromFs;
+}
+
+void harness_run(uint64_t endFs)
+{
+    sim_run(firmware_main, endFs);
+    if (vcdEnabled) {
+        vcd_close(sim_getStats()->nowFs);
+        vcdEnabled = 0;
+    }
+}
+
+const harness_edge_t * harness_edges(uint32_t * count)
+{
+    *count = clockTrack.count;
+    return clockTrack.edges;
+}
+
+const harness_edge_t * harness_phaseEdges(uint32_t * count)
+{
+    *count = phaseTrack.count;
+    return phaseTrack.edges;
+}
+
+int harness_measure(harness_measure_t * measure)
+{
+    const harness_edge_t * edges = clockTrack.edges;
+    uint64_t firstRiseFs = 0;
+    uint64_t riseFs = 0;
+    uint64_t fallFs = 0;
+    uint8_t haveRise = 0;
+    uint8_t haveFall = 0;
+    uint32_t periods = 0;
+    uint64_t highFs = 0;
+    uint64_t minFs = UINT64_MAX;
+    uint64_t maxFs = 0;
+    uint64_t lastPeriodFs = 0;
+    uint64_t jitterFs = 0;
+
+    for (uint32_t i = 0; i < clockTrack.count; i++) {
+        uint64_t timeFs = edges[i].timeFs;
+
+        if (!edges[i].level) {
+            fallFs = timeFs;
+            haveFall = haveRise;
+            continue;
+        }
+        if (haveRise) {
+            uint64_t periodFs = timeFs - riseFs;
+            if (periodFs < minFs) {
+                minFs = periodFs;
+            }
+            if (periodFs > maxFs) {
+                maxFs = periodFs;
+            }
+            if (periods > 0) {
+                uint64_t changeFs = periodFs > lastPeriodFs
+                    ? periodFs - lastPeriodFs
+                    : lastPeriodFs - periodFs;
+                if (changeFs > jitterFs) {
+                    jitterFs = changeFs;
+                }
+            }
+            lastPeriodFs = periodFs;
+            if (haveFall) {
+                highFs += fallFs - riseFs;
+            }
+            periods++;
+        } else {
+            firstRiseFs = timeFs;
+        }
+        riseFs = timeFs;
+        haveRise = 1;
+        haveFall = 0;
+    }
+
+    if (periods == 0) {
+        return -1;
+    }
+
+    double spanS = (double)(riseFs - firstRiseFs) / SIM_FS_PER_S;
+    measure->periods = periods;
+    measure->frequencyHz = periods / spanS;
+    measure->highRatio = ((double)highFs / SIM_FS_PER_S) / spanS;
+    measure->periodMinS = (double)minFs / SIM_FS_PER_S;
+    measure->periodMaxS = (double)maxFs / SIM_FS_PER_S;
+    measure->jitterS = (double)jitterFs / SIM_FS_PER_S;
+
+    return 0;
+}
+
+void harness_pulses(harness_pulses_t * pulses)
+{
+    const harness_edge_t * edges = clockTrack.edges;
+    uint64_t riseFs = 0;
+    uint64_t fallFs = 0;
+    uint8_t haveRise = 0;
+    uint8_t haveFall = 0;
+    uint64_t highMinFs = UINT64_MAX;
+    uint64_t lowMinFs = UINT64_MAX;
+
+    pulses->count = 0;
+    pulses->endLevel = 0;
+
+    for (uint32_t i = 0; i < clockTrack.count; i++) {
+        uint64_t timeFs = edges[i].timeFs;
+
+        pulses->endLevel = edges[i].level;
+        if (edges[i].level) {
+            if (haveFall && timeFs - fallFs < lowMinFs) {
+                lowMinFs = timeFs - fallFs;
+            }
+            riseFs = timeFs;
+            haveRise = 1;
+        } else if (haveRise) {
+            if (timeFs - riseFs < highMinFs) {
+                highMinFs = timeFs - riseFs;
+            }
+            fallFs = timeFs;
+            haveFall = 1;
+            haveRise = 0;
+            pulses->count++;
+        }
+    }
+
+    pulses->highMinS = highMinFs == UINT64_MAX ? 0.0 : (double)highMinFs / SIM_FS_PER_S;
+    pulses->lowMinS = lowMinFs == UINT64_MAX ? 0.0 : (double)lowMinFs / SIM_FS_PER_S;
+}
+
+uint64_t harness_serialSend(uint64_t atFs, const char * text, double baud)
+{
+    double bitFs = (double)SIM_FS_PER_S / baud;
+
+    for (; *text; text++) {
+        // start bit, 8 data bits LSB first, stop bit - high is the pullup
+        uint16_t frame = (uint16_t)(((uint8_t)*text << 1) | 0x200);
+        int8_t last = SIM_RELEASE;
+        for (uint8_t bit = 0; bit < 10; bit++) {
+            int8_t level = (frame >> bit) & 1 ? SIM_RELEASE : 0;
+            if (level != last) {
+                sim_schedule(atFs + (uint64_t)(bit * bitFs), HARNESS_PIN_RX, level);
+                last = level;
+            }
+        }
+        atFs += (uint64_t)(10 * bitFs);
+    }
+    return atFs;
+}
+
+uint32_t harness_serialRead(char * text, uint32_t size, double * edgeError)
+{
+    double bitFs = (double)SIM_FS_PER_S / HARNESS_SERIAL_BAUD;
+    uint32_t length = 0;
+    uint32_t i = 0;
+
+    *edgeError = 0.0;
+    while (i < txEdgeCount && length + 1 < size) {
+        if (txEdges[i].level) {
+            i++;
+            continue;
+        }
+
+        // start bit - sample the middle of every bit
+        uint64_t startFs = txEdges[i].timeFs;
+        uint32_t j = i;
+        uint8_t c = 0;
+        uint8_t level = 0;
+        for (uint8_t bit = 1; bit < 10; bit++) {
+            uint64_t sampleFs = startFs + (uint64_t)((bit + 0.5) * bitFs);
+            while (j + 1 < txEdgeCount && txEdges[j + 1].timeFs <= sampleFs) {
+                j++;
+            }
+            level = txEdges[j].level;
+            if (bit < 9 && level) {
+                c |= (uint8_t)(1 << (bit - 1));
+            }
+        }
+        for (uint32_t k = i + 1; k <= j; k++) {
+            double position = (double)(txEdges[k].timeFs - startFs) / bitFs;
+            double error = fabs(position - round(position));
+            if (error > *edgeError) {
+                *edgeError = error;
+            }
+        }
+        text[length++] = level ? (char)c : '#';
+        i = j + 1;
+    }
+    text[length] = 0;
+    return length;
+}
+
+int harness_traceVcd(const char * path)
+{
+    if (vcd_open(path) != 0) {
+        return -1;
+    }
+    vcdEnabled = 1;
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * File:   harness.h
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ *
+ * Helpers shared by the simulator front ends: running the firmware,
+ * driving the buttons / nHALT, recording the clock output edges and
+ * talking to the serial port.
+ */
+
+#ifndef HARNESS_H
+#define	HARNESS_H
+
+#include <stdint.h>
+#include "pic16f684.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define HARNESS_PIN_HALT        SIM_PIN(SIM_PORTA, 2)
+#define HARNESS_PIN_MODE        SIM_PIN(SIM_PORTA, 3)
+#define HARNESS_PIN_UP          SIM_PIN(SIM_PORTA, 4)
+#define HARNESS_PIN_DOWN        SIM_PIN(SIM_PORTA, 5)
+#define HARNESS_PIN_CLK         SIM_PIN(SIM_PORTC, 5)
+#define HARNESS_PIN_PHASE       SIM_PIN(SIM_PORTC, 4)
+#define HARNESS_PIN_TX          SIM_PIN(SIM_PORTA, 0)
+#define HARNESS_PIN_RX          SIM_PIN(SIM_PORTA, 1)
+
+// serial port of the firmware, 8N1
+#define HARNESS_SERIAL_BAUD     38400.0
+
+// how long a simulated finger keeps a button down
+#define HARNESS_PRESS_FS        (60 * SIM_FS_PER_MS)
+#define HARNESS_PRESS_GAP_FS    (60 * SIM_FS_PER_MS)
+// held long enough for a long press
+#define HARNESS_HOLD_FS         (500 * SIM_FS_PER_MS)
+// contact bounce of a bouncing press, after the closing and the opening
+#define HARNESS_BOUNCE_FS       (2 * SIM_FS_PER_MS)
+
+typedef struct {
+    uint64_t timeFs;
+    uint64_t tcyFs;             // instruction cycle of the core at the edge
+    uint8_t level;
+} harness_edge_t;
+
+typedef struct {
+    double frequencyHz;         // average over the measured rising edges
+    double highRatio;           // fraction of the period spent high
+    uint32_t periods;           // number of complete periods measured
+    double periodMinS;          // shortest / longest single period
+    double periodMaxS;
+    double jitterS;             // largest change between two consecutive periods
+} harness_measure_t;
+
+typedef struct {
+    uint32_t count;             // complete high pulses
+    double highMinS;            // narrowest high pulse
+    double lowMinS;             // narrowest low time between two pulses
+    uint8_t endLevel;           // output level after the last edge
+} harness_pulses_t;
+
+// firmware entry point (main() of the firmware, renamed by the build)
+extern void firmware_main(void);
+
+/**
+ * Reset the device model, the firmware globals and the recorded edges,
+ * blank EEPROM - the next harness_run() is a power-on
+ */
+void harness_reset(void);
+
+/**
+ * Press a button at the given time, returns the time after it was released
+ * and the gap elapsed
+ */
+uint64_t harness_press(uint8_t pin, uint64_t atFs);
+
+/**
+ * Hold a button down for a long press, returns the time after it was
+ * released and the gap elapsed
+ */
+uint64_t harness_hold(uint8_t pin, uint64_t atFs);
+
+/**
+ * Press a button with contact bounce, the contact opens and closes again
+ * within HARNESS_BOUNCE_FS after it closes and after it opens. Returns
+ * like harness_press().
+ */
+uint64_t harness_pressBounce(uint8_t pin, uint64_t atFs);
+
+/**
+ * Press a button several times in a row
+ */
+uint64_t harness_pressRepeat(uint8_t pin, uint64_t atFs, uint8_t count);
+
+/**
+ * Record clock output and second phase edges only from this time on
+ */
+void harness_recordFrom(uint64_t fromFs);
+
+/**
+ * Run the firmware until endFs
+ */
+void harness_run(uint64_t endFs);
+
+/**
+ * Recorded clock output edges
+ */
+const harness_edge_t * harness_edges(uint32_t * count);
+
+/**
+ * Recorded second phase edges (RC4)
+ */
+const harness_edge_t * harness_phaseEdges(uint32_t * count);
+
+/**
+ * Frequency and duty cycle from the recorded clock output edges
+ */
+int harness_measure(harness_measure_t * measure);
+
+/**
+ * Pulses in the recorded clock output edges (bursts)
+ */
+void harness_pulses(harness_pulses_t * pulses);
+
+/**
+ * Send text to the serial RX pin at the given baud rate, returns the time
+ * after the last stop bit
+ */
+uint64_t harness_serialSend(uint64_t atFs, const char * text, double baud);
+
+/**
+ * Decode everything the firmware sent on the serial TX pin at
+ * HARNESS_SERIAL_BAUD, a framing error is stored as '#'. edgeError is the
+ * largest distance of a bit edge from its place in the frame, in bit times.
+ * Returns the number of characters.
+ */
+uint32_t harness_serialRead(char * text, uint32_t size, double * edgeError);
+
+/**
+ * Also write every pin change to a VCD file
+ */
+int harness_traceVcd(const char * path);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* HARNESS_H */
@@ -0,0 +1,582 @@
+/*
+ * File:   latency.c
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ *
+ * Latency benchmark: drives the buttons and nHALT at many different
+ * phases of TMR0 and of the clock output and reports the distribution of
+ *
+ *   button -> RC5      first output change after a manual mode click, with
+ *                      the core asleep and with the core awake (another
+ *                      button held), the contacts bounce
+ *   nHALT -> RC5 low   until the output is low for good, on every step
+ *                      from the power-on step up, and on the slow steps
+ *                      right before a rising edge, so the compare match
+ *                      falls into the interrupt latency
+ *   nHALT resume       with the resumable halt on: the output has to stay
+ *                      low while nHALT is held, then a slow step has to
+ *                      continue at the phase it was held at (the time
+ *                      reported is the phase error) and a PWM step has to
+ *                      restart at its next period (the time reported is
+ *                      from nHALT rising to the first rising edge)
+ *   reconfiguration    UP click to the first full period at the new
+ *                      frequency, and the CPU time of the change itself.
+ *                      The click bounces and has to step up exactly once
+ *
+ * Every latency has a limit, the program fails when one is exceeded.
+ * Every run is its own process, harness_reset() puts the firmware back to
+ * its power-on RAM within one.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "harness.h"
+#include "../frequencies.h"
+
+// TMR0 overflow, the button scan period (Fosc/4, 1:256 prescaler)
+#define LATENCY_TICK_S          (256.0 * 256.0 / 2e6)
+
+// limits
+#define LATENCY_BUTTON_S        100e-6
+#define LATENCY_HALT_S          20e-6
+#define LATENCY_RESUME_S        20e-6
+// reconfiguration: the rest of the old period, the first new one
+#define LATENCY_SWITCH_SLACK_S  100e-6
+
+#define LATENCY_SAMPLES         16
+#define LATENCY_HALT_SAMPLES    8
+// nHALT ahead of a slow rising edge, a run from power-on each
+#define LATENCY_EDGE_SAMPLES    8
+#define LATENCY_EDGE_STEP_FS    (5 * SIM_FS_PER_US / 2)
+// shortest time nHALT is held by the resume run
+#define LATENCY_HOLD_FS         (5 * SIM_FS_PER_MS)
+
+// firmware function timed for the reconfiguration CPU time
+extern void generator_increaseFrequency(void);
+
+// frequency ladder of the firmware (frequencies.h)
+static const double targetsHz[FREQ_COUNT] = FREQ_TARGETS_HZ;
+static const char * names[FREQ_COUNT] = FREQ_NAMES;
+
+
+typedef void (* latency_child_t)(uint8_t step, int fd);
+
+typedef struct {
+    uint32_t samples;
+    double minS;
+    double maxS;
+    double sumS;
+    double cpuS;                // CPU time of the change (reconfiguration)
+} latency_t;
+
+
+static void _add(latency_t * latency, double valueS)
+{
+    if (latency->samples == 0 || valueS < latency->minS) {
+        latency->minS = valueS;
+    }
+    if (latency->samples == 0 || valueS > latency->maxS) {
+        latency->maxS = valueS;
+    }
+    latency->sumS += valueS;
+    latency->samples++;
+}
+
+static void _merge(latency_t * total, const latency_t * latency)
+{
+    if (latency->samples == 0) {
+        return;
+    }
+    if (total->samples == 0 || latency->minS < total->minS) {
+        total->minS = latency->minS;
+    }
+    if (total->samples == 0 || latency->maxS > total->maxS) {
+        total->maxS = latency->maxS;
+    }
+    total->sumS += latency->sumS;
+    total->samples += latency->samples;
+}
+
+/**
+ * Pseudo random phase of a sample inside a span. Hashed, not a multiple of
+ * the sample number: the firmware timers keep the phase of the previous
+ * sample, a constant step between the samples would alias.
+ */
+static uint64_t _phase(uint32_t sample, double spanS)
+{
+    uint32_t x = (sample + 1) * 2654435761u;
+
+    x ^= x >> 15;
+    x *= 2246822519u;
+    x ^= x >> 13;
+    return (uint64_t)((double)(x & 0xFFFF) / 65536.0 * spanS * SIM_FS_PER_S);
+}
+
+/**
+ * First clock edge at or after atFs, 0 if none
+ */
+static uint64_t _edgeAfter(uint64_t atFs)
+{
+    uint32_t count;
+    const harness_edge_t * edges = harness_edges(&count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (edges[i].timeFs >= atFs) {
+            return edges[i].timeFs;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Output level right after atFs, from the edges recorded
+ */
+static uint8_t _levelAt(uint64_t atFs)
+{
+    uint32_t count;
+    const harness_edge_t * edges = harness_edges(&count);
+    uint8_t level = 0;
+
+    for (uint32_t i = 0; i < count && edges[i].timeFs <= atFs; i++) {
+        level = edges[i].level;
+    }
+    return level;
+}
+
+/**
+ * First rising clock edge at or after atFs, 0 if none. With before set,
+ * the last one before atFs.
+ */
+static uint64_t _riseNear(uint64_t atFs, int before)
+{
+    uint32_t count;
+    const harness_edge_t * edges = harness_edges(&count);
+    uint64_t riseFs = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (!edges[i].level) {
+            continue;
+        }
+        if (edges[i].timeFs >= atFs) {
+            return before ? riseFs : edges[i].timeFs;
+        }
+        riseFs = edges[i].timeFs;
+    }
+    return before ? riseFs : 0;
+}
+
+/**
+ * Select a step with UP / DOWN presses from the power-on step, returns
+ * the time after the last press
+ */
+static uint64_t _selectStep(uint8_t step)
+{
+    uint64_t atFs = 10 * SIM_FS_PER_MS;
+    int presses = (int)step - (int)FREQ_DEFAULT;
+
+    if (presses < 0) {
+        return harness_pressRepeat(HARNESS_PIN_DOWN, atFs, (uint8_t)-presses);
+    }
+    return harness_pressRepeat(HARNESS_PIN_UP, atFs, (uint8_t)presses);
+}
+
+/**
+ * Time from haltFs until RC5 is low for good, looked at up to endFs. 1 s
+ * when it is still high.
+ */
+static double _lowFor(uint64_t haltFs, uint64_t endFs)
+{
+    uint32_t count;
+    const harness_edge_t * edges = harness_edges(&count);
+    double valueS = 0.0;
+
+    for (uint32_t e = 0; e < count && edges[e].timeFs < endFs; e++) {
+        if (edges[e].timeFs < haltFs) {
+            continue;
+        }
+        valueS = edges[e].level ? 1.0 : (double)(edges[e].timeFs - haltFs) / SIM_FS_PER_S;
+    }
+    return valueS;
+}
+
+static void _write(int fd, const latency_t * latency)
+{
+    if (write(fd, latency, sizeof(*latency)) != sizeof(*latency)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * Child: manual mode clicks, UP and DOWN alternating so every click
+ * changes RC5. The core sleeps between the clicks.
+ */
+static void _runButtonAsleep(uint8_t step, int fd)
+{
+    latency_t latency = {0};
+    uint64_t pressFs[LATENCY_SAMPLES];
+    uint64_t atFs;
+
+    harness_reset();
+    atFs = harness_press(HARNESS_PIN_MODE, 10 * SIM_FS_PER_MS) + 100 * SIM_FS_PER_MS;
+    harness_recordFrom(atFs);
+    for (uint32_t i = 0; i < LATENCY_SAMPLES; i++) {
+        pressFs[i] = atFs + _phase(i, LATENCY_TICK_S);
+        atFs = harness_pressBounce((i & 1) ? HARNESS_PIN_DOWN : HARNESS_PIN_UP, pressFs[i]);
+        atFs += 100 * SIM_FS_PER_MS;
+    }
+    harness_run(atFs);
+
+    for (uint32_t i = 0; i < LATENCY_SAMPLES; i++) {
+        uint64_t edgeFs = _edgeAfter(pressFs[i]);
+        _add(&latency, edgeFs ? (double)(edgeFs - pressFs[i]) / SIM_FS_PER_S : 1.0);
+    }
+    _write(fd, &latency);
+}
+
+/**
+ * Child: DOWN held (output LOW, the core stays awake), UP clicked while
+ * it is held
+ */
+static void _runButtonAwake(uint8_t step, int fd)
+{
+    latency_t latency = {0};
+    uint64_t pressFs[LATENCY_SAMPLES];
+    uint64_t atFs;
+
+    harness_reset();
+    atFs = harness_press(HARNESS_PIN_MODE, 10 * SIM_FS_PER_MS) + 100 * SIM_FS_PER_MS;
+    harness_recordFrom(atFs);
+    for (uint32_t i = 0; i < LATENCY_SAMPLES; i++) {
+        sim_schedule(atFs, HARNESS_PIN_DOWN, 0);
+        sim_schedule(atFs + 200 * SIM_FS_PER_MS, HARNESS_PIN_DOWN, SIM_RELEASE);
+        pressFs[i] = atFs + 60 * SIM_FS_PER_MS + _phase(i, LATENCY_TICK_S);
+        harness_pressBounce(HARNESS_PIN_UP, pressFs[i]);
+        atFs += 400 * SIM_FS_PER_MS;
+    }
+    harness_run(atFs);
+
+    for (uint32_t i = 0; i < LATENCY_SAMPLES; i++) {
+        uint64_t edgeFs = _edgeAfter(pressFs[i]);
+        _add(&latency, edgeFs ? (double)(edgeFs - pressFs[i]) / SIM_FS_PER_S : 1.0);
+    }
+    _write(fd, &latency);
+}
+
+/**
+ * Child: nHALT at different phases of one step. After every halt nHALT
+ * is released and MODE restarts the step. The restart is at a fixed time
+ * of the slot, the halt phase is not, so the halts do not alias.
+ */
+static void _runHalt(uint8_t step, int fd)
+{
+    latency_t latency = {0};
+    uint64_t haltFs[LATENCY_HALT_SAMPLES];
+    double periodS = 1.0 / targetsHz[step];
+    uint64_t periodFs = (uint64_t)(periodS * SIM_FS_PER_S);
+    uint64_t slotFs = 300 * SIM_FS_PER_MS + 3 * periodFs;
+    uint64_t atFs;
+
+    harness_reset();
+    atFs = _selectStep(step) + 100 * SIM_FS_PER_MS + periodFs;
+    harness_recordFrom(atFs);
+    for (uint32_t i = 0; i < LATENCY_HALT_SAMPLES; i++) {
+        haltFs[i] = atFs + _phase(i, periodS);
+        sim_schedule(haltFs[i], HARNESS_PIN_HALT, 0);
+        sim_schedule(haltFs[i] + 5 * SIM_FS_PER_MS, HARNESS_PIN_HALT, SIM_RELEASE);
+        harness_press(HARNESS_PIN_MODE, atFs + periodFs + 10 * SIM_FS_PER_MS);
+        atFs += slotFs;
+    }
+    harness_run(atFs);
+
+    for (uint32_t i = 0; i < LATENCY_HALT_SAMPLES; i++) {
+        _add(&latency, _lowFor(haltFs[i], haltFs[i] + 5 * SIM_FS_PER_MS));
+    }
+    _write(fd, &latency);
+}
+
+/**
+ * Power-on run: first rising edge of the step at or after atFs
+ */
+static uint64_t _riseAfter(uint8_t step, uint64_t atFs)
+{
+    harness_reset();
+    _selectStep(step);
+    harness_recordFrom(atFs);
+    harness_run(atFs + (uint64_t)(SIM_FS_PER_S / targetsHz[step]) + SIM_FS_PER_MS);
+    return _riseNear(atFs, 0);
+}
+
+/**
+ * Power-on run: nHALT at haltFs, time in fs until RC5 is low for good
+ */
+static uint64_t _haltAt(uint8_t step, uint64_t haltFs)
+{
+    harness_reset();
+    _selectStep(step);
+    sim_schedule(haltFs, HARNESS_PIN_HALT, 0);
+    harness_recordFrom(haltFs);
+    harness_run(haltFs + 5 * SIM_FS_PER_MS);
+    return (uint64_t)(_lowFor(haltFs, haltFs + 5 * SIM_FS_PER_MS) * SIM_FS_PER_S) + 1;
+}
+
+/**
+ * Child: nHALT 0 .. LATENCY_EDGE_SAMPLES * LATENCY_EDGE_STEP_FS ahead of
+ * a rising edge of a slow step. The firmware runs the same way up to
+ * nHALT, so the edge is found by a run without it.
+ */
+static void _runHaltEdge(uint8_t step, int fd)
+{
+    latency_t latency = {0};
+    uint64_t riseFs = _riseAfter(step, _selectStep(step) + 100 * SIM_FS_PER_MS
+        + (uint64_t)(SIM_FS_PER_S / targetsHz[FREQ_DEFAULT]));
+
+    for (uint32_t i = 0; i < LATENCY_EDGE_SAMPLES && riseFs != 0; i++) {
+        uint64_t lowFs = _haltAt(step, riseFs - i * LATENCY_EDGE_STEP_FS);
+        _add(&latency, lowFs ? (double)(lowFs - 1) / SIM_FS_PER_S : 1.0);
+    }
+    if (riseFs == 0) {
+        _add(&latency, 1.0);
+    }
+    _write(fd, &latency);
+}
+
+/**
+ * Child: resumable halt (serial r1), nHALT held for a varying time at
+ * different phases of one step, released without any button.
+ */
+static void _runResume(uint8_t step, int fd)
+{
+    latency_t latency = {0};
+    uint64_t haltFs[LATENCY_HALT_SAMPLES];
+    uint64_t releaseFs[LATENCY_HALT_SAMPLES];
+    double periodS = 1.0 / targetsHz[step];
+    uint64_t periodFs = (uint64_t)(periodS * SIM_FS_PER_S);
+    uint64_t slotFs = LATENCY_HOLD_FS + 4 * periodFs + 10 * SIM_FS_PER_MS;
+    uint64_t atFs;
+
+    harness_reset();
+    atFs = harness_serialSend(_selectStep(step) + 100 * SIM_FS_PER_MS, "r1\r", HARNESS_SERIAL_BAUD);
+    // a PWM step starts at the falling edge of the power-on step
+    atFs += 100 * SIM_FS_PER_MS + (uint64_t)(SIM_FS_PER_S / targetsHz[FREQ_DEFAULT]);
+    harness_recordFrom(atFs);
+    for (uint32_t i = 0; i < LATENCY_HALT_SAMPLES; i++) {
+        haltFs[i] = atFs + periodFs + _phase(i, periodS);
+        releaseFs[i] = haltFs[i] + LATENCY_HOLD_FS + _phase(i + LATENCY_HALT_SAMPLES, periodS);
+        sim_schedule(haltFs[i], HARNESS_PIN_HALT, 0);
+        sim_schedule(releaseFs[i], HARNESS_PIN_HALT, SIM_RELEASE);
+        atFs += slotFs;
+    }
+    harness_run(atFs);
+
+    for (uint32_t i = 0; i < LATENCY_HALT_SAMPLES; i++) {
+        uint64_t heldFs = haltFs[i] + (uint64_t)(LATENCY_HALT_S * SIM_FS_PER_S);
+        uint64_t resumeFs = releaseFs[i] + (uint64_t)(LATENCY_RESUME_S * SIM_FS_PER_S);
+        double valueS = 1.0;
+
+        // low and no edge while held
+        if (_levelAt(heldFs) == 0 && _edgeAfter(heldFs) >= releaseFs[i]) {
+            if (step > FREQ_SLOW_LAST) {
+                uint64_t riseFs = _riseNear(releaseFs[i], 0);
+                valueS = riseFs ? (double)(riseFs - releaseFs[i]) / SIM_FS_PER_S : 1.0;
+            } else {
+                // the schedule before the halt, later by the time held
+                uint64_t lastFs = _riseNear(haltFs[i], 1);
+                uint64_t riseFs = _riseNear(resumeFs, 0);
+                if (lastFs != 0 && riseFs != 0) {
+                    int64_t errorFs = (int64_t)((riseFs - lastFs - (releaseFs[i] - haltFs[i])) % periodFs);
+                    if (errorFs > (int64_t)periodFs / 2) {
+                        errorFs -= (int64_t)periodFs;
+                    }
+                    valueS = fabs((double)errorFs) / SIM_FS_PER_S;
+                }
+            }
+        }
+        _add(&latency, valueS);
+    }
+    _write(fd, &latency);
+}
+
+/**
+ * Child: bouncing UP click on a running step. The latency ends where the
+ * first period of the new frequency starts, the CPU time is the time spent
+ * in generator_increaseFrequency(). A last period of another length (the
+ * bounce stepped up twice) fails the run.
+ */
+static void _runSwitch(uint8_t step, int fd)
+{
+    latency_t latency = {0};
+    double oldPeriodS = 1.0 / targetsHz[step];
+    double newPeriodS = 1.0 / targetsHz[step + 1];
+    double toleranceS = newPeriodS * 0.01;
+    uint64_t pressFs;
+    uint32_t count;
+
+    harness_reset();
+    pressFs = _selectStep(step) + 100 * SIM_FS_PER_MS + (uint64_t)(2 * oldPeriodS * SIM_FS_PER_S);
+    harness_recordFrom(pressFs);
+    harness_pressBounce(HARNESS_PIN_UP, pressFs);
+    sim_profile(generator_increaseFrequency);
+    harness_run(pressFs + (uint64_t)((LATENCY_TICK_S + oldPeriodS + 4 * newPeriodS) * SIM_FS_PER_S)
+        + SIM_FS_PER_MS);
+
+    // first rising edge followed by a full period of the new length
+    const harness_edge_t * edges = harness_edges(&count);
+    double valueS = 1.0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!edges[i].level) {
+            continue;
+        }
+        for (uint32_t j = i + 1; j < count; j++) {
+            if (!edges[j].level) {
+                continue;
+            }
+            double periodS = (double)(edges[j].timeFs - edges[i].timeFs) / SIM_FS_PER_S;
+            if (fabs(periodS - newPeriodS) <= toleranceS) {
+                valueS = (double)(edges[i].timeFs - pressFs) / SIM_FS_PER_S;
+            }
+            break;
+        }
+        if (valueS < 1.0) {
+            break;
+        }
+    }
+    // the last full period - a bounce must not have stepped up twice
+    uint64_t riseFs[2] = {0, 0};
+    for (uint32_t i = 0; i < count; i++) {
+        if (edges[i].level) {
+            riseFs[0] = riseFs[1];
+            riseFs[1] = edges[i].timeFs;
+        }
+    }
+    if (riseFs[0] == 0
+        || fabs((double)(riseFs[1] - riseFs[0]) / SIM_FS_PER_S - newPeriodS) > toleranceS
+    ) {
+        valueS = 1.0;
+    }
+    _add(&latency, valueS);
+
+    const sim_stats_t * stats = sim_getStats();
+    latency.cpuS = (double)stats->profileLastCycles * (double)stats->tcyFs / SIM_FS_PER_S;
+    _write(fd, &latency);
+}
+
+/**
+ * Run the child for the steps first..last one after the other
+ */
+static int _run(latency_child_t child, uint8_t first, uint8_t last, latency_t results[])
+{
+    for (uint8_t i = first; i <= last; i++) {
+        int pipeFds[2];
+        int status = 0;
+
+        if (pipe(pipeFds) != 0) {
+            perror("pipe");
+            return -1;
+        }
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(pipeFds[0]);
+            child(i, pipeFds[1]);
+        }
+        close(pipeFds[1]);
+        if (read(pipeFds[0], &results[i], sizeof(latency_t)) != sizeof(latency_t)) {
+            results[i].samples = 0;
+        }
+        close(pipeFds[0]);
+        waitpid(pid, &status, 0);
+    }
+    return 0;
+}
+
+/**
+ * Print one row, returns 1 when the worst case is over the limit
+ */
+static int _report(const char * name, const latency_t * latency, double limitS)
+{
+    int ok = latency->samples > 0 && latency->maxS <= limitS;
+
+    printf("%-20s %8u %12.1f %12.1f %12.1f %12.1f  %s\n", name, latency->samples,
+        latency->minS * 1e6, latency->samples ? latency->sumS / latency->samples * 1e6 : 0.0,
+        latency->maxS * 1e6, limitS * 1e6, ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+int main(void)
+{
+    latency_t results[FREQ_COUNT];
+    latency_t halt = {0};
+    int failures = 0;
+
+    printf("%-20s %8s %12s %12s %12s %12s  %s\n",
+        "latency", "samples", "min us", "avg us", "max us", "limit us", "result");
+
+    if (_run(_runButtonAsleep, 0, 0, results) != 0) {
+        return 1;
+    }
+    failures += _report("button (asleep)", &results[0], LATENCY_BUTTON_S);
+
+    if (_run(_runButtonAwake, 0, 0, results) != 0) {
+        return 1;
+    }
+    failures += _report("button (awake)", &results[0], LATENCY_BUTTON_S);
+
+    if (_run(_runHalt, FREQ_DEFAULT, FREQ_COUNT - 1, results) != 0) {
+        return 1;
+    }
+    for (uint8_t i = FREQ_DEFAULT; i < FREQ_COUNT; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "nHALT %s", names[i]);
+        failures += _report(name, &results[i], LATENCY_HALT_S);
+        _merge(&halt, &results[i]);
+    }
+    _report("nHALT (all steps)", &halt, LATENCY_HALT_S);
+
+    if (_run(_runHaltEdge, FREQ_DEFAULT, FREQ_SLOW_LAST, results) != 0) {
+        return 1;
+    }
+    for (uint8_t i = FREQ_DEFAULT; i <= FREQ_SLOW_LAST; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "nHALT edge %s", names[i]);
+        failures += _report(name, &results[i], LATENCY_HALT_S);
+    }
+
+    if (_run(_runResume, FREQ_DEFAULT, FREQ_COUNT - 1, results) != 0) {
+        return 1;
+    }
+    for (uint8_t i = FREQ_DEFAULT; i < FREQ_COUNT; i++) {
+        char name[32];
+        double limitS = LATENCY_RESUME_S + (i > FREQ_SLOW_LAST ? 1.0 / targetsHz[i] : 0.0);
+        snprintf(name, sizeof(name), "resume %s", names[i]);
+        failures += _report(name, &results[i], limitS);
+    }
+
+    printf("\n%-20s %12s %12s %12s  %s\n",
+        "reconfiguration", "cpu us", "latency us", "limit us", "result");
+    if (_run(_runSwitch, FREQ_BLINK_LAST, FREQ_COUNT - 2, results) != 0) {
+        return 1;
+    }
+    for (uint8_t i = FREQ_BLINK_LAST; i < FREQ_COUNT - 1; i++) {
+        char name[32];
+        double limitS = 1.0 / targetsHz[i] + 1.0 / targetsHz[i + 1] + LATENCY_SWITCH_SLACK_S;
+        int ok = results[i].samples > 0 && results[i].maxS <= limitS;
+
+        snprintf(name, sizeof(name), "%s>%s", names[i], names[i + 1]);
+        printf("%-20s %12.1f %12.1f %12.1f  %s\n", name, results[i].cpuS * 1e6,
+            results[i].maxS * 1e6, limitS * 1e6, ok ? "ok" : "FAIL");
+        if (!ok) {
+            failures++;
+        }
+    }
+
+    if (failures) {
+        printf("%d latency check(s) over the limit\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,1040 @@
+/*
+ * File:   pic16f684.c
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ *
+ * Cycle stepped model of the PIC16F684 peripherals (see pic16f684.h).
+ */
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pic16f684.h"
+
+// the firmware interrupt routine
+extern void ISR(void);
+
+#define BIT(value, n)           (((value) >> (n)) & 1)
+
+// CCP1CON fields
+#define CCP_MODE(ccp1con)       ((ccp1con) & 0x0F)
+#define CCP_P1M(ccp1con)        (((ccp1con) >> 6) & 0x03)
+#define CCP_DC1B(ccp1con)       (((ccp1con) >> 4) & 0x03)
+#define CCP_IS_PWM(ccp1con)     (((ccp1con) & 0x0C) == 0x0C)
+
+#define CCP_COMPARE_TOGGLE      0x02
+#define CCP_COMPARE_SET         0x08
+#define CCP_COMPARE_CLEAR       0x09
+#define CCP_COMPARE_SOFTWARE    0x0A
+#define CCP_COMPARE_SPECIAL     0x0B
+
+#define PWM_EVENTS_MAX          4
+#define STIMULI_MAX             4096
+
+// side of the ECCP output pair
+enum {
+    PWM_P1A = 0,
+    PWM_P1B = 1
+};
+
+typedef struct {
+    uint64_t timeFs;
+    uint8_t output;
+    uint8_t level;
+} pwm_event_t;
+
+typedef struct {
+    uint64_t timeFs;
+    uint8_t pin;
+    int8_t level;
+} stimulus_t;
+
+uint8_t sim_regs[256];
+
+// data EEPROM, kept over sim_reset() like on the part
+static uint8_t eeprom[SIM_EEPROM_SIZE];
+
+static struct {
+    sim_stats_t stats;
+    uint64_t endFs;
+    jmp_buf exitJump;
+    uint8_t inIsr;
+
+    // registers stored to by the firmware since the last commit
+    uint8_t written[256];
+    uint8_t ccp1conLast;
+    uint8_t latchA;
+    uint8_t latchC;
+
+    // HFINTOSC error before OSCTUNE, sim_setOscillatorError()
+    int32_t oscErrorPpm;
+
+    // timers
+    uint16_t tmr0Prescaler;
+    uint8_t tmr0Inhibit;
+    uint8_t tmr1Prescaler;
+    uint8_t tmr2Prescaler;
+    uint8_t tmr2Postscaler;
+
+    // CCP1 / ECCP
+    uint8_t ccpMode;
+    uint8_t compareLatch;
+    uint8_t pwm[2];
+    uint8_t shutdownHold;
+    pwm_event_t pwmEvents[PWM_EVENTS_MAX];
+    uint8_t pwmEventCount;
+
+    // data EEPROM: EECON2 unlock writes seen (0, 1 - 55h, 2 - AAh), write in progress
+    uint8_t eepromUnlock;
+    uint64_t eepromDoneFs;
+    uint8_t eepromAddress;
+    uint8_t eepromData;
+
+    // pins
+    int8_t external[SIM_PIN_COUNT];
+    char level[SIM_PIN_COUNT];
+    uint8_t intPinLast;
+    uint8_t iocLatchA;              // PORTA value of the last read, for RAIF
+    sim_pin_observer_t observer;
+
+    // sim_profile()
+    void * profiled;
+    uint8_t profileDepth;
+    uint64_t profileStart;
+    uint64_t profileIsrStart;
+
+    stimulus_t stimuli[STIMULI_MAX];
+    uint16_t stimulusCount;
+    uint16_t stimulusNext;
+} sim;
+
+static const char * pinNames[SIM_PIN_COUNT] = {
+    "RA0", "RA1", "RA2", "RA3", "RA4", "RA5", "RA6", "RA7",
+    "RC0", "RC1", "RC2", "RC3", "RC4", "RC5", "RC6", "RC7"
+};
+
+// registers with a side effect on write
+static const uint8_t watchedRegisters[] = {
+    SFR_TMR0, SFR_PORTA, SFR_PORTC, SFR_TMR1L, SFR_TMR1H,
+    SFR_TMR2, SFR_T2CON, SFR_CCP1CON, SFR_OSCCON, SFR_OSCTUNE, SFR_EECON1, SFR_EECON2
+};
+
+static void _advance(uint32_t cycles);
+
+
+/**
+ * Instruction cycle length for the selected INTOSC frequency. The
+ * HFINTOSC postscaler outputs (IRCF 001 - 111) are off by the oscillator
+ * error and tuned by OSCTUNE, the LFINTOSC is neither.
+ */
+static uint64_t _instructionCycleFs(void)
+{
+    static const uint32_t ircfHz[8] = {
+        31000, 125000, 250000, 500000, 1000000, 2000000, 4000000, 8000000
+    };
+    uint8_t ircf = (sim_regs[SFR_OSCCON] >> 4) & 0x07;
+    uint64_t tcyFs = (4 * SIM_FS_PER_S) / ircfHz[ircf];
+
+    if (ircf != 0) {
+        // TUN<4:0>, two's complement
+        int32_t tune = (int32_t)(sim_regs[SFR_OSCTUNE] & 0x0F) - (int32_t)(sim_regs[SFR_OSCTUNE] & 0x10);
+        tcyFs = tcyFs * 1000000 / (uint64_t)(1000000 + sim.oscErrorPpm + tune * SIM_OSCTUNE_STEP_PPM);
+    }
+    return tcyFs;
+}
+
+/**
+ * Level of an input pin as seen by the port logic
+ */
+static uint8_t _inputLevel(uint8_t pin)
+{
+    if (sim.external[pin] != SIM_RELEASE) {
+        return (uint8_t)sim.external[pin];
+    }
+    // released pins are pulled up (weak pull-ups or the external resistors)
+    return 1;
+}
+
+/**
+ * Level driven by the ECCP module on P1A (RC5) or P1B (RC4), 'n' if the
+ * pin is left to the port latch
+ */
+static char _ccpOutput(uint8_t output)
+{
+    uint8_t ccp1con = sim_regs[SFR_CCP1CON];
+
+    if (CCP_IS_PWM(ccp1con)) {
+        if (output == PWM_P1B && CCP_P1M(ccp1con) != 0x02) {
+            return 'n';
+        }
+        if (BIT(sim_regs[SFR_ECCPAS], 7) || sim.shutdownHold) {
+            uint8_t pss = (output == PWM_P1A)
+                ? ((sim_regs[SFR_ECCPAS] >> 2) & 0x03)
+                : (sim_regs[SFR_ECCPAS] & 0x03);
+            if (pss & 0x02) {
+                return 'z';
+            }
+            return (char)('0' + pss);
+        }
+        return (char)('0' + sim.pwm[output]);
+    }
+
+    if (output == PWM_P1A) {
+        switch (CCP_MODE(ccp1con)) {
+            case CCP_COMPARE_TOGGLE:
+            case CCP_COMPARE_SET:
+            case CCP_COMPARE_CLEAR:
+                return (char)('0' + sim.compareLatch);
+            default:
+                break;
+        }
+    }
+    return 'n';
+}
+
+/**
+ * Current level of a pin ('0', '1' or 'z')
+ */
+static char _pinLevel(uint8_t pin)
+{
+    uint8_t bit = pin & 0x07;
+
+    if (pin < SIM_PIN(SIM_PORTC, 0)) {
+        if (bit > 5) {
+            return '0';
+        }
+        if (BIT(sim_regs[SFR_TRISA], bit) || bit == 3) {
+            return (char)('0' + _inputLevel(pin));
+        }
+        return (char)('0' + BIT(sim.latchA, bit));
+    }
+
+    if (bit > 5) {
+        return '0';
+    }
+    if (BIT(sim_regs[SFR_TRISC], bit)) {
+        return (sim.external[pin] == SIM_RELEASE)
+            ? 'z'
+            : (char)('0' + sim.external[pin]);
+    }
+    if (bit == 5 || bit == 4) {
+        char ccp = _ccpOutput(bit == 5 ? PWM_P1A : PWM_P1B);
+        if (ccp != 'n') {
+            return ccp;
+        }
+    }
+    return (char)('0' + BIT(sim.latchC, bit));
+}
+
+/**
+ * Report pin level changes to the observer
+ */
+static void _updatePins(uint64_t timeFs)
+{
+    for (uint8_t pin = 0; pin < SIM_PIN_COUNT; pin++) {
+        if ((pin & 0x07) > 5) {
+            continue;
+        }
+        char level = _pinLevel(pin);
+        if (level != sim.level[pin]) {
+            sim.level[pin] = level;
+            if (sim.observer) {
+                sim.observer(pin, level, timeFs);
+            }
+        }
+    }
+}
+
+/**
+ * Value returned by a read of PORTA / PORTC
+ */
+static uint8_t _portRead(uint8_t port)
+{
+    uint8_t value = 0;
+
+    for (uint8_t bit = 0; bit < 6; bit++) {
+        if (_pinLevel(SIM_PIN(port, bit)) == '1') {
+            value |= (uint8_t)(1 << bit);
+        }
+    }
+    return value;
+}
+
+/**
+ * Apply the PWM edges which are due
+ */
+static void _processPwmEvents(uint64_t untilFs)
+{
+    while (sim.pwmEventCount > 0 && sim.pwmEvents[0].timeFs <= untilFs) {
+        pwm_event_t event = sim.pwmEvents[0];
+        memmove(&sim.pwmEvents[0], &sim.pwmEvents[1],
+            (size_t)(sim.pwmEventCount - 1) * sizeof(pwm_event_t));
+        sim.pwmEventCount--;
+
+        sim.pwm[event.output] = event.level;
+        _updatePins(event.timeFs);
+    }
+}
+
+static void _schedulePwm(uint64_t timeFs, uint8_t output, uint8_t level)
+{
+    uint8_t i = sim.pwmEventCount;
+
+    if (i >= PWM_EVENTS_MAX) {
+        return;
+    }
+    while (i > 0 && sim.pwmEvents[i - 1].timeFs > timeFs) {
+        sim.pwmEvents[i] = sim.pwmEvents[i - 1];
+        i--;
+    }
+    sim.pwmEvents[i].timeFs = timeFs;
+    sim.pwmEvents[i].output = output;
+    sim.pwmEvents[i].level = level;
+    sim.pwmEventCount++;
+}
+
+/**
+ * TMR2 matched PR2 - a new PWM period starts
+ */
+static void _pwmPeriodStart(uint64_t startFs)
+{
+    uint8_t ccp1con = sim_regs[SFR_CCP1CON];
+    static const uint8_t prescale[4] = {1, 4, 16, 16};
+    uint8_t ps = prescale[sim_regs[SFR_T2CON] & 0x03];
+    uint64_t toscFs = sim.stats.tcyFs / 4;
+
+    // finish the previous period
+    _processPwmEvents(UINT64_MAX);
+
+    if (!CCP_IS_PWM(ccp1con)) {
+        return;
+    }
+    // duty cycle is latched at the start of the period
+    sim_regs[SFR_CCPR1H] = sim_regs[SFR_CCPR1L];
+
+    // auto-restart
+    if (BIT(sim_regs[SFR_ECCPAS], 7) && BIT(sim_regs[SFR_PWM1CON], 7)) {
+        uint8_t source = (sim_regs[SFR_ECCPAS] >> 4) & 0x07;
+        if (!(source & 0x04) || _inputLevel(SIM_PIN(SIM_PORTA, 2))) {
+            sim_regs[SFR_ECCPAS] &= 0x7F;
+        }
+    }
+    sim.shutdownHold = BIT(sim_regs[SFR_ECCPAS], 7);
+
+    uint32_t duty = ((uint32_t)sim_regs[SFR_CCPR1H] << 2) | CCP_DC1B(ccp1con);
+    uint32_t period = ((uint32_t)sim_regs[SFR_PR2] + 1) * 4;
+    uint64_t dead = 0;
+    if (CCP_P1M(ccp1con) == 0x02) {
+        // PDC counts Fosc/4 cycles
+        dead = (uint64_t)(sim_regs[SFR_PWM1CON] & 0x7F) * sim.stats.tcyFs;
+    }
+
+    if (duty == 0) {
+        sim.pwm[PWM_P1A] = 0;
+        if (!sim.pwm[PWM_P1B]) {
+            _schedulePwm(startFs + dead, PWM_P1B, 1);
+        }
+    } else {
+        sim.pwm[PWM_P1B] = 0;
+        if (dead == 0) {
+            sim.pwm[PWM_P1A] = 1;
+        } else if (!sim.pwm[PWM_P1A]) {
+            _schedulePwm(startFs + dead, PWM_P1A, 1);
+        }
+        if (duty < period) {
+            uint64_t endFs = startFs + (uint64_t)duty * ps * toscFs;
+            _schedulePwm(endFs, PWM_P1A, 0);
+            _schedulePwm(endFs + dead, PWM_P1B, 1);
+        }
+    }
+    _updatePins(startFs);
+}
+
+/**
+ * Compare output action on TMR1 == CCPR1
+ */
+static void _compareMatch(void)
+{
+    switch (sim.ccpMode) {
+        case CCP_COMPARE_TOGGLE:
+            sim.compareLatch ^= 1;
+            break;
+        case CCP_COMPARE_SET:
+            sim.compareLatch = 1;
+            break;
+        case CCP_COMPARE_CLEAR:
+            sim.compareLatch = 0;
+            break;
+        case CCP_COMPARE_SPECIAL:
+            sim_regs[SFR_TMR1L] = 0;
+            sim_regs[SFR_TMR1H] = 0;
+            break;
+        case CCP_COMPARE_SOFTWARE:
+            break;
+        default:
+            return;
+    }
+    sim_regs[SFR_PIR1] |= 0x20;     // CCP1IF
+}
+
+/**
+ * A new CCP1 mode was written
+ */
+static void _ccpModeChange(uint8_t previous, uint8_t ccp1con)
+{
+    uint8_t mode = CCP_MODE(ccp1con);
+
+    // the compare modes initialise the output opposite to the match action
+    switch (mode) {
+        case CCP_COMPARE_SET:
+            sim.compareLatch = 0;
+            break;
+        case CCP_COMPARE_CLEAR:
+            sim.compareLatch = 1;
+            break;
+        case CCP_COMPARE_TOGGLE:
+            break;
+        default:
+            sim.compareLatch = 0;
+            break;
+    }
+    if (CCP_IS_PWM(ccp1con) && !CCP_IS_PWM(previous)) {
+        // PWM outputs start low, the first period starts on the next PR2 match
+        sim.pwm[PWM_P1A] = 0;
+        sim.pwm[PWM_P1B] = 0;
+        sim.pwmEventCount = 0;
+    }
+    sim.ccpMode = mode;
+}
+
+/**
+ * EECON1 written: RD reads at once, WR starts a write only right after the
+ * unlock sequence and with WREN set
+ */
+static void _eepromControl(uint8_t eecon1)
+{
+    if (BIT(eecon1, 0)) {
+        sim_regs[SFR_EEDAT] = eeprom[sim_regs[SFR_EEADR]];
+        eecon1 &= (uint8_t)~0x01;
+    }
+    if (BIT(eecon1, 1) && sim.eepromDoneFs == 0) {
+        if (BIT(eecon1, 2) && sim.eepromUnlock == 2) {
+            sim.eepromDoneFs = sim.stats.nowFs + SIM_EEPROM_WRITE_FS;
+            sim.eepromAddress = sim_regs[SFR_EEADR];
+            sim.eepromData = sim_regs[SFR_EEDAT];
+        } else {
+            eecon1 &= (uint8_t)~0x02;
+        }
+    }
+    sim.eepromUnlock = 0;
+    sim_regs[SFR_EECON1] = eecon1;
+}
+
+/**
+ * End of an EEPROM write: WR cleared, EEIF set
+ */
+static void _eepromStep(void)
+{
+    if (sim.eepromDoneFs == 0 || sim.stats.nowFs < sim.eepromDoneFs) {
+        return;
+    }
+    eeprom[sim.eepromAddress] = sim.eepromData;
+    sim.eepromDoneFs = 0;
+    sim_regs[SFR_EECON1] &= (uint8_t)~0x02;
+    sim_regs[SFR_PIR1] |= 0x80;             // EEIF
+    sim.stats.eepromWrites++;
+}
+
+/**
+ * Apply the side effects of register writes done by the firmware
+ */
+static void _commit(void)
+{
+    for (uint8_t i = 0; i < sizeof(watchedRegisters); i++) {
+        uint8_t address = watchedRegisters[i];
+        uint8_t value = sim_regs[address];
+
+        if (!sim.written[address]) {
+            continue;
+        }
+        sim.written[address] = 0;
+
+        switch (address) {
+            case SFR_TMR0:
+                sim.tmr0Prescaler = 0;
+                sim.tmr0Inhibit = 2;
+                break;
+            case SFR_PORTA:
+                sim.latchA = value;
+                break;
+            case SFR_PORTC:
+                sim.latchC = value;
+                break;
+            case SFR_TMR1L:
+            case SFR_TMR1H:
+                sim.tmr1Prescaler = 0;
+                break;
+            case SFR_TMR2:
+            case SFR_T2CON:
+                sim.tmr2Prescaler = 0;
+                sim.tmr2Postscaler = 0;
+                break;
+            case SFR_CCP1CON:
+                if (CCP_MODE(value) != sim.ccpMode
+                    || CCP_P1M(value) != CCP_P1M(sim.ccp1conLast)
+                ) {
+                    _ccpModeChange(sim.ccp1conLast, value);
+                }
+                sim.ccp1conLast = value;
+                break;
+            case SFR_OSCCON:
+            case SFR_OSCTUNE:
+                sim.stats.tcyFs = _instructionCycleFs();
+                break;
+            case SFR_EECON1:
+                _eepromControl(value);
+                break;
+            case SFR_EECON2:
+                // not a physical register, reads as 0
+                sim.eepromUnlock = (value == 0x55) ? 1 : ((value == 0xAA && sim.eepromUnlock == 1) ? 2 : 0);
+                sim_regs[SFR_EECON2] = 0;
+                break;
+            default:
+                break;
+        }
+    }
+    _updatePins(sim.stats.nowFs);
+}
+
+static void _stepTimer0(void)
+{
+    uint8_t option = sim_regs[SFR_OPTION_REG];
+
+    if (BIT(option, 5)) {
+        return;     // T0CKI is not modelled
+    }
+    if (sim.tmr0Inhibit) {
+        sim.tmr0Inhibit--;
+        return;
+    }
+    if (!BIT(option, 3)) {
+        uint16_t prescale = (uint16_t)(2 << (option & 0x07));
+        if (++sim.tmr0Prescaler < prescale) {
+            return;
+        }
+        sim.tmr0Prescaler = 0;
+    }
+    if (++sim_regs[SFR_TMR0] == 0) {
+        sim_regs[SFR_INTCON] |= 0x04;       // T0IF
+    }
+}
+
+static void _stepTimer1(void)
+{
+    uint8_t t1con = sim_regs[SFR_T1CON];
+
+    if (!BIT(t1con, 0) || BIT(t1con, 1)) {
+        return;     // stopped or external clock (not modelled)
+    }
+    if (++sim.tmr1Prescaler < (1 << ((t1con >> 4) & 0x03))) {
+        return;
+    }
+    sim.tmr1Prescaler = 0;
+
+    uint16_t tmr1 = (uint16_t)(sim_regs[SFR_TMR1L] | (sim_regs[SFR_TMR1H] << 8));
+    tmr1++;
+    if (tmr1 == 0) {
+        sim_regs[SFR_PIR1] |= 0x01;         // TMR1IF
+    }
+    sim_regs[SFR_TMR1L] = (uint8_t)tmr1;
+    sim_regs[SFR_TMR1H] = (uint8_t)(tmr1 >> 8);
+
+    uint16_t ccpr1 = (uint16_t)(sim_regs[SFR_CCPR1L] | (sim_regs[SFR_CCPR1H] << 8));
+    if (!CCP_IS_PWM(sim_regs[SFR_CCP1CON]) && tmr1 == ccpr1) {
+        _compareMatch();
+    }
+}
+
+static void _stepTimer2(uint64_t cycleStartFs)
+{
+    static const uint8_t prescale[4] = {1, 4, 16, 16};
+    uint8_t t2con = sim_regs[SFR_T2CON];
+
+    if (!BIT(t2con, 2)) {
+        return;
+    }
+    if (++sim.tmr2Prescaler < prescale[t2con & 0x03]) {
+        return;
+    }
+    sim.tmr2Prescaler = 0;
+
+    if (sim_regs[SFR_TMR2] == sim_regs[SFR_PR2]) {
+        sim_regs[SFR_TMR2] = 0;
+        if (++sim.tmr2Postscaler > ((t2con >> 3) & 0x0F)) {
+            sim.tmr2Postscaler = 0;
+            sim_regs[SFR_PIR1] |= 0x02;     // TMR2IF
+        }
+        _pwmPeriodStart(cycleStartFs);
+    } else {
+        sim_regs[SFR_TMR2]++;
+    }
+}
+
+/**
+ * INT edge detection and ECCP auto-shutdown
+ */
+static void _stepInputs(void)
+{
+    uint8_t intPin = _inputLevel(SIM_PIN(SIM_PORTA, 2));
+
+    if (intPin != sim.intPinLast) {
+        uint8_t rising = BIT(sim_regs[SFR_OPTION_REG], 6);
+        if (intPin == rising) {
+            sim_regs[SFR_INTCON] |= 0x02;   // INTF
+        }
+        sim.intPinLast = intPin;
+    }
+
+    // interrupt-on-change: mismatch against the last PORTA read
+    uint8_t ioca = sim_regs[SFR_IOCA] & 0x3F;
+    if (ioca && ((_portRead(SIM_PORTA) ^ sim.iocLatchA) & ioca)) {
+        sim_regs[SFR_INTCON] |= 0x01;       // RAIF
+    }
+
+    // auto-shutdown on VIL at the INT pin
+    if (CCP_IS_PWM(sim_regs[SFR_CCP1CON])
+        && (sim_regs[SFR_ECCPAS] & 0x40)
+        && intPin == 0
+    ) {
+        sim_regs[SFR_ECCPAS] |= 0x80;
+    }
+}
+
+static void _applyStimuli(void)
+{
+    while (sim.stimulusNext < sim.stimulusCount
+        && sim.stimuli[sim.stimulusNext].timeFs <= sim.stats.nowFs
+    ) {
+        stimulus_t * stimulus = &sim.stimuli[sim.stimulusNext++];
+        sim.external[stimulus->pin] = stimulus->level;
+    }
+}
+
+/**
+ * Interrupt request as evaluated by the core
+ */
+static uint8_t _interruptPending(void)
+{
+    uint8_t intcon = sim_regs[SFR_INTCON];
+
+    if (!BIT(intcon, 7)) {
+        return 0;
+    }
+    if ((intcon & (intcon >> 3)) & 0x07) {
+        return 1;       // T0IF & T0IE, INTF & INTE, RAIF & RAIE
+    }
+    return BIT(intcon, 6) && (sim_regs[SFR_PIR1] & sim_regs[SFR_PIE1]);
+}
+
+/**
+ * Wake-up condition, any enabled interrupt flag - GIE does not matter
+ */
+static uint8_t _wakePending(void)
+{
+    uint8_t intcon = sim_regs[SFR_INTCON];
+
+    if ((intcon & (intcon >> 3)) & 0x07) {
+        return 1;
+    }
+    return BIT(intcon, 6) && (sim_regs[SFR_PIR1] & sim_regs[SFR_PIE1]);
+}
+
+/**
+ * Source of an ISR() entry, the enabled flag set
+ */
+static sim_isr_path_t _isrPath(void)
+{
+    uint8_t intcon = sim_regs[SFR_INTCON];
+    uint8_t pending = (uint8_t)(intcon & (intcon >> 3) & 0x07);
+    uint8_t peripherals = BIT(intcon, 6) ? (uint8_t)(sim_regs[SFR_PIR1] & sim_regs[SFR_PIE1]) : 0;
+    sim_isr_path_t path = SIM_ISR_PATHS;
+    uint8_t sources = 0;
+
+    if (BIT(pending, 1)) {
+        path = SIM_ISR_INT;
+        sources++;
+    }
+    if (BIT(pending, 0)) {
+        path = SIM_ISR_IOC;
+        sources++;
+    }
+    if (BIT(pending, 2)) {
+        path = SIM_ISR_TMR0;
+        sources++;
+    }
+    if (BIT(peripherals, 0)) {
+        path = SIM_ISR_TMR1;
+        sources++;
+    }
+    if (BIT(peripherals, 5)) {
+        path = SIM_ISR_CCP1;
+        sources++;
+    }
+    if (BIT(peripherals, 1)) {
+        path = SIM_ISR_TMR2;
+        sources++;
+    }
+    return sources == 1 ? path : SIM_ISR_SHARED;
+}
+
+static void _runIsr(void)
+{
+    uint64_t start = sim.stats.cycles;
+    sim_isr_path_stats_t * path = &sim.stats.isrPaths[_isrPath()];
+
+    sim.inIsr = 1;
+    sim_regs[SFR_INTCON] &= 0x7F;           // GIE cleared by the core
+    _advance(SIM_COST_ISR_LATENCY + SIM_COST_ISR_PROLOGUE);
+    ISR();
+    _advance(SIM_COST_ISR_EPILOGUE);
+    sim_regs[SFR_INTCON] |= 0x80;           // RETFIE
+    sim.inIsr = 0;
+
+    sim.stats.isrCount++;
+    sim.stats.isrCycles += sim.stats.cycles - start;
+    path->count++;
+    if (sim.stats.cycles - start > path->maxCycles) {
+        path->maxCycles = (uint32_t)(sim.stats.cycles - start);
+    }
+}
+
+/**
+ * Execute a number of instruction cycles
+ */
+static void _advance(uint32_t cycles)
+{
+    _commit();
+
+    while (cycles--) {
+        uint64_t cycleStartFs = sim.stats.nowFs;
+
+        _applyStimuli();
+        _stepInputs();
+        _stepTimer0();
+        _stepTimer1();
+        _stepTimer2(cycleStartFs);
+        _eepromStep();
+        _updatePins(cycleStartFs);
+
+        sim.stats.nowFs += sim.stats.tcyFs;
+        sim.stats.cycles++;
+        _processPwmEvents(sim.stats.nowFs);
+
+        if (sim.stats.nowFs >= sim.endFs) {
+            longjmp(sim.exitJump, 1);
+        }
+        if (!sim.inIsr && _interruptPending()) {
+            _runIsr();
+        }
+    }
+}
+
+/**
+ * SLEEP. The oscillator stops and so does every timer, the time jumps from
+ * one stimulus to the next until INT or a PORTA change wakes the core up.
+ * With a wake-up flag already set SLEEP executes as a NOP.
+ */
+static void _sleep(void)
+{
+    _advance(1);
+    if (_wakePending()) {
+        return;
+    }
+    sim.stats.sleepCount++;
+
+    while (!_wakePending()) {
+        uint64_t nextFs = sim.endFs;
+        if (sim.stimulusNext < sim.stimulusCount
+            && sim.stimuli[sim.stimulusNext].timeFs < nextFs
+        ) {
+            nextFs = sim.stimuli[sim.stimulusNext].timeFs;
+        }
+        if (sim.eepromDoneFs != 0 && sim.eepromDoneFs < nextFs) {
+            nextFs = sim.eepromDoneFs;
+        }
+        // stay on the instruction cycle grid
+        uint64_t cycles = 1;
+        if (nextFs > sim.stats.nowFs) {
+            cycles = (nextFs - sim.stats.nowFs + sim.stats.tcyFs - 1) / sim.stats.tcyFs;
+        }
+        sim.stats.nowFs += cycles * sim.stats.tcyFs;
+        sim.stats.sleepFs += cycles * sim.stats.tcyFs;
+
+        if (sim.stats.nowFs >= sim.endFs) {
+            longjmp(sim.exitJump, 1);
+        }
+        _applyStimuli();
+        _stepInputs();
+        _eepromStep();
+        _updatePins(sim.stats.nowFs);
+    }
+    _advance(SIM_COST_WAKE);
+}
+
+uint8_t * sim_sfr(uint8_t address)
+{
+    _advance(SIM_COST_SFR);
+
+    if (address == SFR_PORTA || address == SFR_PORTC) {
+        uint8_t value = _portRead(address == SFR_PORTA ? SIM_PORTA : SIM_PORTC);
+        sim_regs[address] = value;
+        if (address == SFR_PORTA) {
+            sim.iocLatchA = value;
+        }
+    }
+    return &sim_regs[address];
+}
+
+sim_u16_t * sim_sfr16(uint8_t address)
+{
+    _advance(SIM_COST_SFR);
+
+    return (sim_u16_t *)&sim_regs[address];
+}
+
+void sim_loop(void)
+{
+    _advance(SIM_COST_LOOP);
+}
+
+void sim_cycles(uint32_t cycles)
+{
+    _advance(cycles);
+}
+
+void sim_asm(const char * instruction)
+{
+    if (strcmp(instruction, "SLEEP") == 0) {
+        _sleep();
+        return;
+    }
+    _advance(1);
+}
+
+void __attribute__((no_instrument_function)) __cyg_profile_func_enter(void * function, void * caller)
+{
+    (void)caller;
+    if (function == sim.profiled && sim.profileDepth++ == 0) {
+        sim.profileStart = sim.stats.cycles;
+        sim.profileIsrStart = sim.stats.isrCycles;
+    }
+    _advance(SIM_COST_CALL);
+}
+
+void __attribute__((no_instrument_function)) __cyg_profile_func_exit(void * function, void * caller)
+{
+    (void)caller;
+    _advance(SIM_COST_RETURN);
+    if (function == sim.profiled && --sim.profileDepth == 0) {
+        sim.stats.profileCalls++;
+        sim.stats.profileLastCycles = (sim.stats.cycles - sim.profileStart)
+            - (sim.stats.isrCycles - sim.profileIsrStart);
+        sim.stats.profileCycles += sim.stats.profileLastCycles;
+    }
+}
+
+/**
+ * Store tracking. The firmware is built with -fsanitize=address, every
+ * store it does is announced here before it happens. This catches writes
+ * which do not change the value (RC5 = 1 while the pin already reads 1),
+ * which still load the port latch on the real part.
+ */
+static void __attribute__((no_instrument_function)) _store(uintptr_t address, size_t size)
+{
+    uintptr_t base = (uintptr_t)sim_regs;
+
+    while (size--) {
+        if (address >= base && address < base + sizeof(sim_regs)) {
+            sim.written[address - base] = 1;
+        }
+        address++;
+    }
+}
+
+#define SIM_ASAN_HOOKS(size) \
+    void __asan_load##size(uintptr_t address) { (void)address; } \
+    void __asan_store##size(uintptr_t address) { _store(address, size); }
+
+SIM_ASAN_HOOKS(1)
+SIM_ASAN_HOOKS(2)
+SIM_ASAN_HOOKS(4)
+SIM_ASAN_HOOKS(8)
+SIM_ASAN_HOOKS(16)
+
+void __asan_loadN(uintptr_t address, size_t size) { (void)address; (void)size; }
+void __asan_storeN(uintptr_t address, size_t size) { _store(address, size); }
+void __asan_init(void) {}
+void __asan_version_mismatch_check_v8(void) {}
+
+/**
+ * Firmware globals. The module constructors announce the .data and .bss
+ * variables of every firmware object before main() runs, their bytes then
+ * are the initial values - kept here and put back by sim_reset(), the way
+ * the XC8 startup code does on each power-on.
+ */
+typedef struct {
+    uintptr_t beg;
+    size_t size;
+    size_t sizeWithRedzone;
+    const char * name;
+    const char * moduleName;
+    size_t hasDynamicInit;
+    void * location;
+    uintptr_t odrIndicator;
+} sim_asan_global_t;
+
+#define GLOBALS_MAX             256
+
+static struct {
+    void * address;
+    uint8_t * initial;
+    size_t size;
+} globals[GLOBALS_MAX];
+static uint16_t globalCount = 0;
+
+void __asan_register_globals(void * descriptors, size_t count)
+{
+    const sim_asan_global_t * global = descriptors;
+
+    for (size_t i = 0; i < count; i++, global++) {
+        if (globalCount >= GLOBALS_MAX) {
+            abort();
+        }
+        globals[globalCount].address = (void *)global->beg;
+        globals[globalCount].size = global->size;
+        globals[globalCount].initial = malloc(global->size);
+        if (globals[globalCount].initial == NULL) {
+            abort();
+        }
+        memcpy(globals[globalCount].initial, (void *)global->beg, global->size);
+        globalCount++;
+    }
+}
+
+void __asan_unregister_globals(void * globals, size_t count) { (void)globals; (void)count; }
+void __asan_handle_no_return(void) {}
+
+void sim_reset(void)
+{
+    sim_pin_observer_t observer = sim.observer;
+    void * profiled = sim.profiled;
+
+    memset(&sim, 0, sizeof(sim));
+    memset(sim_regs, 0, sizeof(sim_regs));
+
+    // only what the firmware changed, the constants are in read-only pages
+    for (uint16_t i = 0; i < globalCount; i++) {
+        if (memcmp(globals[i].address, globals[i].initial, globals[i].size) != 0) {
+            memcpy(globals[i].address, globals[i].initial, globals[i].size);
+        }
+    }
+    sim.observer = observer;
+    sim.profiled = profiled;
+
+    // power-on reset values
+    sim_regs[SFR_OPTION_REG] = 0xFF;
+    sim_regs[SFR_TRISA] = 0x3F;
+    sim_regs[SFR_TRISC] = 0x3F;
+    sim_regs[SFR_OSCCON] = 0x60;
+    sim_regs[SFR_PR2] = 0xFF;
+    sim_regs[SFR_WPUA] = 0x37;
+    sim_regs[SFR_ANSEL] = 0xFF;
+    sim_regs[SFR_WDTCON] = 0x08;
+    sim_regs[SFR_STATUS] = 0x18;
+
+    for (uint8_t pin = 0; pin < SIM_PIN_COUNT; pin++) {
+        sim.external[pin] = SIM_RELEASE;
+        sim.level[pin] = 'x';
+    }
+    sim.intPinLast = 1;
+    sim.iocLatchA = 0x3F;
+    sim.stats.tcyFs = _instructionCycleFs();
+}
+
+void sim_setOscillatorError(int32_t ppm)
+{
+    sim.oscErrorPpm = ppm;
+    sim.stats.tcyFs = _instructionCycleFs();
+}
+
+/**
+ * Blank part, every EEPROM byte FFh
+ */
+void sim_eepromErase(void)
+{
+    memset(eeprom, 0xFF, sizeof(eeprom));
+}
+
+uint8_t * sim_eeprom(void)
+{
+    return eeprom;
+}
+
+void sim_setObserver(sim_pin_observer_t observer)
+{
+    sim.observer = observer;
+}
+
+/**
+ * Count the calls and the cycles of one firmware function
+ */
+void sim_profile(void (*function)(void))
+{
+    sim.profiled = (void *)function;
+}
+
+void sim_drivePin(uint8_t pin, int8_t level)
+{
+    sim.external[pin] = level;
+}
+
+void sim_schedule(uint64_t timeFs, uint8_t pin, int8_t level)
+{
+    if (sim.stimulusCount >= STIMULI_MAX) {
+        return;
+    }
+
+    // keep the list ordered, stimuli are usually added in time order
+    uint16_t i = sim.stimulusCount++;
+    while (i > sim.stimulusNext && sim.stimuli[i - 1].timeFs > timeFs) {
+        sim.stimuli[i] = sim.stimuli[i - 1];
+        i--;
+    }
+    sim.stimuli[i].timeFs = timeFs;
+    sim.stimuli[i].pin = pin;
+    sim.stimuli[i].level = level;
+}
+
+char sim_pinLevel(uint8_t pin)
+{
+    return _pinLevel(pin);
+}
+
+const char * sim_pinName(uint8_t pin)
+{
+    return pinNames[pin];
+}
+
+const sim_stats_t * sim_getStats(void)
+{
+    return &sim.stats;
+}
+
+void sim_run(void (*entry)(void), uint64_t endFs)
+{
+    sim.endFs = endFs;
+    if (setjmp(sim.exitJump) == 0) {
+        entry();
+    }
+}
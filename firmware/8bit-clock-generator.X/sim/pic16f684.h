@@ -0,0 +1,185 @@
+/*
+ * File:   pic16f684.h
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ *
+ * Host-side model of the PIC16F684 peripherals used by the firmware.
+ *
+ * The register file is a plain byte array. Every access done by the
+ * firmware goes through sim_sfr(), which commits the previous write,
+ * advances the simulated time and returns a pointer into the array.
+ * Peripherals (TMR0, TMR1, TMR2, CCP1/ECCP, INT, PORTA, PORTC) are stepped
+ * once per instruction cycle, PWM edges are placed with Tosc resolution.
+ * SLEEP stops the oscillator and with it every timer, the core only wakes
+ * up on INT or on a PORTA change (IOCA).
+ * The data EEPROM reads at once and writes in SIM_EEPROM_WRITE_FS after the
+ * 55h / AAh unlock sequence, its content survives sim_reset().
+ * sim_reset() also puts the globals of the firmware back to the values
+ * they had before main() - the firmware objects are built with
+ * -fsanitize=address, whose constructors announce every global here.
+ *
+ * The firmware itself runs natively, so its execution time is estimated:
+ * every SFR access, loop iteration, call and return is charged a fixed
+ * number of instruction cycles (see SIM_COST_* below).
+ */
+
+#ifndef PIC16F684_H
+#define	PIC16F684_H
+
+#include <stdint.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+// bank 0
+#define SFR_TMR0            0x01
+#define SFR_STATUS          0x03
+#define SFR_PORTA           0x05
+#define SFR_PORTC           0x07
+#define SFR_INTCON          0x0B
+#define SFR_PIR1            0x0C
+#define SFR_TMR1L           0x0E
+#define SFR_TMR1H           0x0F
+#define SFR_T1CON           0x10
+#define SFR_TMR2            0x11
+#define SFR_T2CON           0x12
+#define SFR_CCPR1L          0x13
+#define SFR_CCPR1H          0x14
+#define SFR_CCP1CON         0x15
+#define SFR_PWM1CON         0x16
+#define SFR_ECCPAS          0x17
+#define SFR_WDTCON          0x18
+#define SFR_CMCON0          0x19
+#define SFR_CMCON1          0x1A
+// bank 1
+#define SFR_OPTION_REG      0x81
+#define SFR_TRISA           0x85
+#define SFR_TRISC           0x87
+#define SFR_PIE1            0x8C
+#define SFR_PCON            0x8E
+#define SFR_OSCCON          0x8F
+#define SFR_OSCTUNE         0x90
+#define SFR_ANSEL           0x91
+#define SFR_PR2             0x92
+#define SFR_WPUA            0x95
+#define SFR_IOCA            0x96
+#define SFR_EEDAT           0x9A
+#define SFR_EEADR           0x9B
+#define SFR_EECON1          0x9C
+#define SFR_EECON2          0x9D
+
+// instruction cycles charged to the firmware for its own execution
+#define SIM_COST_SFR            1       // one MOVF/MOVWF/BSF/BCF on a register
+#define SIM_COST_LOOP           2       // GOTO at the end of a loop iteration
+#define SIM_COST_CALL           2       // CALL
+#define SIM_COST_RETURN         2       // RETURN
+#define SIM_COST_ISR_LATENCY    3       // interrupt latency (synchronous source)
+#define SIM_COST_ISR_PROLOGUE   12      // XC8 context save, estimated
+#define SIM_COST_ISR_EPILOGUE   10      // XC8 context restore + RETFIE, estimated
+#define SIM_COST_WAKE           4       // INTOSC start-up after SLEEP (~2us at 8MHz)
+
+// OSCTUNE step of the HFINTOSC, taken as linear - the part only gives the
+// range, about +-12.5 % over the 32 steps
+#define SIM_OSCTUNE_STEP_PPM    8000
+
+// femtoseconds per second
+#define SIM_FS_PER_S            1000000000000000ULL
+#define SIM_FS_PER_MS           1000000000000ULL
+#define SIM_FS_PER_US           1000000000ULL
+
+// data EEPROM size and write time (TDEW, typical)
+#define SIM_EEPROM_SIZE         256
+#define SIM_EEPROM_WRITE_FS     (5 * SIM_FS_PER_MS)
+
+// pin identifiers (port << 3 | bit)
+#define SIM_PIN(port, bit)      (((port) << 3) | (bit))
+#define SIM_PORTA               0
+#define SIM_PORTC               1
+#define SIM_PIN_COUNT           16
+
+// external drive levels for input pins
+#define SIM_RELEASE             (-1)
+
+/**
+ * Observer called on every output level change of a pin
+ * (level is 0, 1 or 'z' for not driven)
+ */
+typedef void (*sim_pin_observer_t)(uint8_t pin, char level, uint64_t timeFs);
+
+// ISR() entries by the one enabled interrupt flag that was set at the
+// entry, SIM_ISR_SHARED when there were more
+typedef enum {
+    SIM_ISR_INT = 0,
+    SIM_ISR_TMR1,
+    SIM_ISR_IOC,                // PORTA interrupt on change
+    SIM_ISR_TMR0,
+    SIM_ISR_CCP1,
+    SIM_ISR_TMR2,
+    SIM_ISR_SHARED,
+    SIM_ISR_PATHS
+} sim_isr_path_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t maxCycles;         // latency, context save and restore included
+} sim_isr_path_stats_t;
+
+typedef struct {
+    uint64_t nowFs;             // simulated time
+    uint64_t cycles;            // instruction cycles executed
+    uint64_t isrCycles;         // instruction cycles spent inside ISR()
+    uint32_t isrCount;          // number of ISR() invocations
+    uint64_t tcyFs;             // current instruction cycle length
+    uint64_t sleepFs;           // simulated time spent in SLEEP
+    uint32_t sleepCount;        // number of SLEEP instructions which stopped the core
+    uint32_t profileCalls;      // calls of the profiled function (sim_profile)
+    uint64_t profileCycles;     // cycles inside it, call + return, without ISR()
+    uint64_t profileLastCycles; // the same for the last call only
+    uint32_t eepromWrites;      // data EEPROM bytes written
+    sim_isr_path_stats_t isrPaths[SIM_ISR_PATHS];
+} sim_stats_t;
+
+// 16-bit register pairs (TMR1, CCPR1) are not aligned in the register file
+typedef uint16_t __attribute__((aligned(1), may_alias)) sim_u16_t;
+
+// register file, indexed by the SFR_* addresses
+extern uint8_t sim_regs[256];
+
+/**
+ * Firmware side hooks (used by the xc.h shim)
+ */
+uint8_t * sim_sfr(uint8_t address);
+sim_u16_t * sim_sfr16(uint8_t address);
+void sim_loop(void);
+void sim_cycles(uint32_t cycles);
+void sim_asm(const char * instruction);
+
+/**
+ * Harness side API
+ */
+void sim_reset(void);
+void sim_setOscillatorError(int32_t ppm);  // HFINTOSC error at OSCTUNE 0, cleared by sim_reset()
+void sim_eepromErase(void);
+uint8_t * sim_eeprom(void);
+void sim_setObserver(sim_pin_observer_t observer);
+void sim_profile(void (*function)(void));
+void sim_drivePin(uint8_t pin, int8_t level);
+void sim_schedule(uint64_t timeFs, uint8_t pin, int8_t level);
+char sim_pinLevel(uint8_t pin);
+const char * sim_pinName(uint8_t pin);
+const sim_stats_t * sim_getStats(void);
+
+/**
+ * Runs the firmware entry point until the simulated time reaches endFs.
+ * The firmware never returns on its own, it is unwound when the time is up.
+ */
+void sim_run(void (*entry)(void), uint64_t endFs);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* PIC16F684_H */
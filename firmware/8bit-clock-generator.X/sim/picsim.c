@@ -0,0 +1,146 @@
+/*
+ * File:   picsim.c
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ *
+ * Command line front end of the simulator.
+ *
+ *   picsim [-t seconds] [-m seconds] [-o trace.vcd] [time:action ...]
+ *
+ *   -t     simulated time (default 1 s)
+ *   -m     start measuring the clock output at this time (default 0)
+ *   -o     write all pin changes to a VCD file
+ *
+ * Actions: up, down, mode (button click), modehold (long press - burst),
+ * halt (nHALT low), resume (nHALT released). Example - go to 10 Hz and
+ * dump the waveform:
+ *
+ *   picsim -t 3 -m 1 -o 10hz.vcd 0.1:up
+ *
+ * picsim-trace runs the GENERATOR_TRACE firmware (RC4 trace pin in the
+ * VCD) and prints its traceStats[] at the end.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "harness.h"
+
+#ifdef GENERATOR_TRACE
+#include "../trace.h"
+#endif
+
+// firmware function timed per call (buttons.c)
+extern void buttons_scan(void);
+
+
+static void _usage(void)
+{
+    fprintf(stderr,
+        "usage: picsim [-t seconds] [-m seconds] [-o trace.vcd] [time:action ...]\n"
+        "actions: up, down, mode, modehold, halt, resume\n");
+    exit(2);
+}
+
+static uint64_t _seconds(const char * text)
+{
+    return (uint64_t)(strtod(text, NULL) * SIM_FS_PER_S);
+}
+
+static void _scheduleAction(const char * event)
+{
+    const char * action = strchr(event, ':');
+    if (action == NULL) {
+        _usage();
+    }
+    uint64_t atFs = _seconds(event);
+    action++;
+
+    if (strcmp(action, "up") == 0) {
+        harness_press(HARNESS_PIN_UP, atFs);
+    } else if (strcmp(action, "down") == 0) {
+        harness_press(HARNESS_PIN_DOWN, atFs);
+    } else if (strcmp(action, "mode") == 0) {
+        harness_press(HARNESS_PIN_MODE, atFs);
+    } else if (strcmp(action, "modehold") == 0) {
+        harness_hold(HARNESS_PIN_MODE, atFs);
+    } else if (strcmp(action, "halt") == 0) {
+        sim_schedule(atFs, HARNESS_PIN_HALT, 0);
+    } else if (strcmp(action, "resume") == 0) {
+        sim_schedule(atFs, HARNESS_PIN_HALT, SIM_RELEASE);
+    } else {
+        _usage();
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    uint64_t endFs = SIM_FS_PER_S;
+    uint64_t measureFs = 0;
+    const char * vcdPath = NULL;
+    int i;
+
+    harness_reset();
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            endFs = _seconds(argv[++i]);
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            measureFs = _seconds(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            vcdPath = argv[++i];
+        } else if (argv[i][0] == '-') {
+            _usage();
+        } else {
+            _scheduleAction(argv[i]);
+        }
+    }
+
+    if (vcdPath && harness_traceVcd(vcdPath) != 0) {
+        perror(vcdPath);
+        return 1;
+    }
+    sim_profile(buttons_scan);
+    harness_recordFrom(measureFs);
+    harness_run(endFs);
+
+    const sim_stats_t * stats = sim_getStats();
+    printf("simulated      %.6f s, %llu instruction cycles\n",
+        (double)stats->nowFs / SIM_FS_PER_S, (unsigned long long)stats->cycles);
+    printf("interrupts     %u, %llu cycles in ISR (%.2f %%)\n",
+        stats->isrCount, (unsigned long long)stats->isrCycles,
+        stats->cycles ? 100.0 * (double)stats->isrCycles / (double)stats->cycles : 0.0);
+    printf("awake          %.3f %% of the time, %u sleeps\n",
+        stats->nowFs ? 100.0 * (double)(stats->nowFs - stats->sleepFs) / (double)stats->nowFs : 0.0,
+        stats->sleepCount);
+
+    printf("button scan    %u ticks, %.1f cycles per tick\n", stats->profileCalls,
+        stats->profileCalls ? (double)stats->profileCycles / stats->profileCalls : 0.0);
+
+    harness_measure_t measure;
+    if (harness_measure(&measure) == 0) {
+        printf("clock out      %.6f Hz, high %.2f %%, %u periods (min %.9f s, max %.9f s)\n",
+            measure.frequencyHz, 100.0 * measure.highRatio, measure.periods,
+            measure.periodMinS, measure.periodMaxS);
+        printf("jitter         %.0f ns cycle-to-cycle\n", measure.jitterS * 1e9);
+    } else {
+        printf("clock out      no complete period\n");
+    }
+
+    harness_pulses_t pulses;
+    harness_pulses(&pulses);
+    printf("pulses         %u (min high %.9f s, min low %.9f s), ends %s\n",
+        pulses.count, pulses.highMinS, pulses.lowMinS, pulses.endLevel ? "high" : "low");
+
+#ifdef GENERATOR_TRACE
+    static const char * slots[TRACE_COUNT] = {
+        "INT", "TMR1", "CCP1", "TMR2", "TMR0", "serial", "main (TMR0 counts)"
+    };
+    for (i = 0; i < TRACE_COUNT; i++) {
+        printf("trace %-18s max %5u, avg %5u\n", slots[i], traceStats[i].max, traceStats[i].avg);
+    }
+#endif
+
+    return 0;
+}
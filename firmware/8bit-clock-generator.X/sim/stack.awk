@@ -0,0 +1,237 @@
+#
+# Compiled stack estimate for `make ram`.
+#
+# Input: readelf --debug-dump=info of the firmware objects built at -O0,
+# then the -fcallgraph-info files (*.ci) of the same objects, then the
+# firmware sources (for the functions declared inline). -v statics= is the
+# .bss and .data total, -v runtime= the allowance for what the objects do
+# not show.
+#
+# A frame is the arguments (or the return value, whichever is larger) and
+# the automatic locals of one function, sized as XC8 does: int 2 bytes,
+# long 4, enums 1, structs unpadded, pointers 1 byte into RAM and 2 into
+# program memory (pointers to const). XC8 overlays the frames along the
+# call graph, so the stack is the largest sum along one chain, once from
+# main() and once from ISR(). It knows nothing of XC8's own temporaries
+# and library routines, the caller adds an allowance for them.
+#
+# The same chains give the depth of the 8-level return stack: a call is a
+# level unless the callee is inline (XC8 merges it into the caller), the
+# interrupt is one more level on top of whatever main() has in use, and a
+# library routine (the 32-bit divide and multiply) one more below main().
+#
+
+function size(k,    t, n, s, bits, m) {
+    t = tag[k]
+    if (t == "DW_TAG_typedef") {
+        n = name[k]
+        if (n ~ /^u?int(8|16|32|64)_t$/) {
+            sub(/^u?int/, "", n)
+            return int(n) / 8
+        }
+        return size(type[k])
+    }
+    if (t == "DW_TAG_const_type" || t == "DW_TAG_volatile_type")
+        return size(type[k])
+    if (t == "DW_TAG_pointer_type")
+        return tag[type[k]] == "DW_TAG_const_type" ? 2 : 1
+    if (t == "DW_TAG_base_type") {
+        n = name[k]
+        if (n ~ /long long/)
+            return 8
+        if (n ~ /long/)
+            return 4
+        if (n ~ /int/ && n !~ /short/)
+            return 2
+        return bytes[k]
+    }
+    if (t == "DW_TAG_array_type")
+        return size(type[k]) * count[k]
+    if (t == "DW_TAG_structure_type" || t == "DW_TAG_union_type") {
+        s = 0
+        bits = 0
+        for (m = 1; m <= members[k]; m++) {
+            if (bitsize[k, m])
+                bits += bitsize[k, m]
+            else if (t == "DW_TAG_union_type")
+                s = s < size(member[k, m]) ? size(member[k, m]) : s
+            else
+                s += size(member[k, m])
+        }
+        return s + int((bits + 7) / 8)
+    }
+    return bytes[k]
+}
+
+function chain(f,    i, c, best, g) {
+    if (f in depth)
+        return depth[f]
+    depth[f] = 0
+    best = 0
+    g = ""
+    for (i = 1; i <= callees[f]; i++) {
+        c = callee[f, i]
+        if (!(c in frame))
+            continue
+        if (chain(c) > best) {
+            best = depth[c]
+            g = c
+        }
+    }
+    deepest[f] = g
+    depth[f] = frame[f] + best
+    return depth[f]
+}
+
+function calls(f,    i, c, best, g, n) {
+    if (f in level)
+        return level[f]
+    level[f] = 0
+    best = 0
+    g = ""
+    for (i = 1; i <= callees[f]; i++) {
+        c = callee[f, i]
+        if (!(c in frame))
+            continue
+        n = calls(c) + !(c in inline)
+        if (n > best) {
+            best = n
+            g = c
+        }
+    }
+    nested[f] = g
+    level[f] = best
+    return best
+}
+
+function report(label, root,    f, path) {
+    chain(root)
+    path = root
+    for (f = deepest[root]; f != ""; f = deepest[f])
+        path = path " > " f
+    printf "%-12s %4d  %s\n", label, depth[root], path
+    return depth[root]
+}
+
+function nesting(label, root,    f, path) {
+    calls(root)
+    path = root
+    for (f = nested[root]; f != ""; f = nested[f])
+        path = path ((f in inline) ? " + " : " > ") f
+    printf "%-12s %4d  %s\n", label, level[root], path
+    return level[root]
+}
+
+# readelf: one unit per object, DIE offsets are per object
+/^File: / { unit++; next }
+
+FILENAME ~ /[.]c$/ {
+    if (/^(static )?inline .*\(/) {
+        f = $0
+        sub(/ *\(.*/, "", f)
+        sub(/.*[ *]/, "", f)
+        inline[f] = 1
+    }
+    next
+}
+
+FILENAME !~ /[.]ci$/ && /^ *<[0-9]+><[0-9a-f]+>: Abbrev Number: [1-9]/ {
+    d = $1
+    gsub(/^<|>.*/, "", d)
+    d = int(d)
+    k = $1
+    sub(/^<[0-9]+></, "", k)
+    sub(/>:$/, "", k)
+    k = unit ":" k
+    die[d] = k
+    tag[k] = $NF
+    gsub(/[()]/, "", tag[k])
+    static = 0
+    if (tag[k] == "DW_TAG_subprogram" && d == 1)
+        function_die = k
+    if (tag[k] == "DW_TAG_member") {
+        p = die[d - 1]
+        member[p, ++members[p]] = k
+    }
+    if (tag[k] == "DW_TAG_subrange_type")
+        array = die[d - 1]
+    next
+}
+
+FILENAME !~ /[.]ci$/ && /DW_AT_/ && k != "" {
+    attribute = $2
+    value = $0
+    sub(/^[^:]*: */, "", value)
+    sub(/^\(indirect[^)]*\): */, "", value)
+    if (attribute == "DW_AT_name")
+        name[k] = value
+    else if (attribute == "DW_AT_byte_size")
+        bytes[k] = value + 0
+    else if (attribute == "DW_AT_bit_size")
+        bitsize[die[d - 1], members[die[d - 1]]] = value + 0
+    else if (attribute == "DW_AT_type") {
+        gsub(/[<>]|0x/, "", value)
+        type[k] = unit ":" value
+        if (tag[k] == "DW_TAG_member")
+            member[die[d - 1], members[die[d - 1]]] = type[k]
+    }
+    else if (attribute == "DW_AT_upper_bound" && tag[k] == "DW_TAG_subrange_type")
+        count[array] = value + 1
+    else if (attribute == "DW_AT_count" && tag[k] == "DW_TAG_subrange_type")
+        count[array] = value + 0
+    else if (attribute == "DW_AT_location" && value ~ /DW_OP_addr/)
+        static = 1
+    # a local is complete with its type and its location
+    if ((tag[k] == "DW_TAG_formal_parameter" || tag[k] == "DW_TAG_variable") && d > 1 \
+            && attribute == "DW_AT_location" && !static) {
+        if (tag[k] == "DW_TAG_formal_parameter")
+            arguments[name[function_die]] += size(type[k])
+        else
+            locals[name[function_die]] += size(type[k])
+    }
+    if (tag[k] == "DW_TAG_subprogram" && d == 1 && attribute == "DW_AT_type")
+        returns[name[k]] = type[k]
+    next
+}
+
+FILENAME ~ /[.]ci$/ && /^edge:/ {
+    match($0, /sourcename: "[^"]*"/)
+    from = substr($0, RSTART + 13, RLENGTH - 14)
+    sub(/.*:/, "", from)
+    match($0, /targetname: "[^"]*"/)
+    to = substr($0, RSTART + 13, RLENGTH - 14)
+    sub(/.*:/, "", to)
+    if (!((from, to) in edge)) {
+        edge[from, to] = 1
+        callee[from, ++callees[from]] = to
+    }
+}
+
+END {
+    for (f in arguments)
+        frame[f] = 0
+    for (f in locals)
+        frame[f] = 0
+    for (f in returns)
+        frame[f] = 0
+    for (f in callees)
+        if (!(f in frame))
+            frame[f] = 0
+    for (f in frame) {
+        if (f ~ /^sim_/) {
+            delete frame[f]
+            continue
+        }
+        r = (f in returns) ? size(returns[f]) : 0
+        frame[f] = (arguments[f] > r ? arguments[f] : r) + locals[f]
+    }
+    total = statics
+    total += report("stack main", "firmware_main")
+    total += report("stack ISR", "ISR")
+    printf "%-12s %4d  XC8 library routine and interrupt context\n", "runtime", runtime
+    total += runtime
+    printf "%-12s %4d of 128\n", "total", total
+    levels = nesting("calls main", "firmware_main") + 1
+    levels += nesting("calls ISR", "ISR") + 1
+    printf "%-12s %4d of 8, with a library routine and the interrupt\n", "calls", levels
+}
@@ -0,0 +1,75 @@
+/*
+ * File:   vcd.c
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ */
+
+#include "vcd.h"
+#include "pic16f684.h"
+
+// signal names matching the board (see the pin map in main.c)
+static const char * signalNames[SIM_PIN_COUNT] = {
+    "RA0_tx", "RA1_rx", "RA2_nHALT", "RA3_btn_mode",
+    "RA4_btn_up", "RA5_btn_down", NULL, NULL,
+    "RC0_led_manual_red", "RC1_led_manual_green", "RC2_led_auto_red",
+    "RC3_led_auto_green", "RC4", "RC5_clk", NULL, NULL
+};
+
+static FILE * vcdFile = NULL;
+static uint64_t lastNs = 0;
+static uint8_t timeWritten = 0;
+
+
+static void _writeTime(uint64_t timeFs)
+{
+    uint64_t ns = timeFs / 1000000;
+
+    // PWM edges of a finished period may be reported slightly late
+    if (timeWritten && ns <= lastNs) {
+        return;
+    }
+    fprintf(vcdFile, "#%llu\n", (unsigned long long)ns);
+    lastNs = ns;
+    timeWritten = 1;
+}
+
+int vcd_open(const char * path)
+{
+    vcdFile = fopen(path, "w");
+    if (vcdFile == NULL) {
+        return -1;
+    }
+
+    fprintf(vcdFile, "$timescale 1ns $end\n");
+    fprintf(vcdFile, "$scope module pic16f684 $end\n");
+    for (uint8_t pin = 0; pin < SIM_PIN_COUNT; pin++) {
+        if (signalNames[pin]) {
+            fprintf(vcdFile, "$var wire 1 %c %s $end\n", '!' + pin, signalNames[pin]);
+        }
+    }
+    fprintf(vcdFile, "$upscope $end\n$enddefinitions $end\n");
+    lastNs = 0;
+    timeWritten = 0;
+
+    return 0;
+}
+
+void vcd_change(uint8_t pin, char level, uint64_t timeFs)
+{
+    if (vcdFile == NULL || signalNames[pin] == NULL) {
+        return;
+    }
+    _writeTime(timeFs);
+    fprintf(vcdFile, "%c%c\n", level, '!' + pin);
+}
+
+void vcd_close(uint64_t endFs)
+{
+    if (vcdFile == NULL) {
+        return;
+    }
+    _writeTime(endFs);
+    fclose(vcdFile);
+    vcdFile = NULL;
+}
@@ -0,0 +1,46 @@
+/*
+ * File:   vcd.h
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ *
+ * Value change dump writer for the simulated pins.
+ */
+
+#ifndef VCD_H
+#define	VCD_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/**
+ * Open the dump and write the header with all PORTA / PORTC pins
+ * @param path
+ * @return 0 on success
+ */
+int vcd_open(const char * path);
+
+/**
+ * Record a level change ('0', '1' or 'z')
+ * @param pin
+ * @param level
+ * @param timeFs
+ */
+void vcd_change(uint8_t pin, char level, uint64_t timeFs);
+
+/**
+ * Flush and close the dump
+ * @param endFs
+ */
+void vcd_close(uint64_t endFs);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* VCD_H */
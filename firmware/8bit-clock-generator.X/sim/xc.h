@@ -0,0 +1,182 @@
+/*
+ * File:   xc.h
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ *
+ * Stand-in for the XC8 <xc.h> when the firmware is compiled for the host
+ * simulator. Register and bit names expand to accesses of the simulated
+ * register file, so the firmware sources build unmodified.
+ */
+
+#ifndef SIM_XC_H
+#define	SIM_XC_H
+
+#include <stdint.h>
+#include "pic16f684.h"
+
+// one bit of a register, used for the single bit names below
+typedef struct {
+    uint8_t b0:1;
+    uint8_t b1:1;
+    uint8_t b2:1;
+    uint8_t b3:1;
+    uint8_t b4:1;
+    uint8_t b5:1;
+    uint8_t b6:1;
+    uint8_t b7:1;
+} __attribute__((may_alias)) sim_bits_t;
+
+#define SIM_REG(address)        (*sim_sfr(address))
+#define SIM_REG16(address)      (*sim_sfr16(address))
+#define SIM_BIT(address, n)     (((sim_bits_t *)sim_sfr(address))->b##n)
+
+// XC8 keywords and intrinsics
+#define __interrupt(...)
+#define __at(address)
+#define __near
+#define __persistent
+#define __bit                   uint8_t
+#define asm(instruction)        sim_asm(instruction)
+#define NOP()                   sim_asm("NOP")
+#define CLRWDT()                sim_asm("CLRWDT")
+#define SLEEP()                 sim_asm("SLEEP")
+#define _delay(cycles)          sim_cycles(cycles)
+#define ei()                    (GIE = 1)
+#define di()                    (GIE = 0)
+
+// loop iterations are charged to the simulated instruction counter
+#define while(condition)        while (sim_loop(), (condition))
+
+// registers
+#define TMR0                    SIM_REG(SFR_TMR0)
+#define STATUS                  SIM_REG(SFR_STATUS)
+#define PORTA                   SIM_REG(SFR_PORTA)
+#define PORTC                   SIM_REG(SFR_PORTC)
+#define INTCON                  SIM_REG(SFR_INTCON)
+#define PIR1                    SIM_REG(SFR_PIR1)
+#define TMR1L                   SIM_REG(SFR_TMR1L)
+#define TMR1H                   SIM_REG(SFR_TMR1H)
+#define TMR1                    SIM_REG16(SFR_TMR1L)
+#define T1CON                   SIM_REG(SFR_T1CON)
+#define TMR2                    SIM_REG(SFR_TMR2)
+#define T2CON                   SIM_REG(SFR_T2CON)
+#define CCPR1L                  SIM_REG(SFR_CCPR1L)
+#define CCPR1H                  SIM_REG(SFR_CCPR1H)
+#define CCPR1                   SIM_REG16(SFR_CCPR1L)
+#define CCP1CON                 SIM_REG(SFR_CCP1CON)
+#define PWM1CON                 SIM_REG(SFR_PWM1CON)
+#define ECCPAS                  SIM_REG(SFR_ECCPAS)
+#define WDTCON                  SIM_REG(SFR_WDTCON)
+#define CMCON0                  SIM_REG(SFR_CMCON0)
+#define CMCON1                  SIM_REG(SFR_CMCON1)
+#define OPTION_REG              SIM_REG(SFR_OPTION_REG)
+#define TRISA                   SIM_REG(SFR_TRISA)
+#define TRISC                   SIM_REG(SFR_TRISC)
+#define PIE1                    SIM_REG(SFR_PIE1)
+#define PCON                    SIM_REG(SFR_PCON)
+#define OSCCON                  SIM_REG(SFR_OSCCON)
+#define OSCTUNE                 SIM_REG(SFR_OSCTUNE)
+#define ANSEL                   SIM_REG(SFR_ANSEL)
+#define PR2                     SIM_REG(SFR_PR2)
+#define WPUA                    SIM_REG(SFR_WPUA)
+#define IOCA                    SIM_REG(SFR_IOCA)
+#define EEDAT                   SIM_REG(SFR_EEDAT)
+#define EEADR                   SIM_REG(SFR_EEADR)
+#define EECON1                  SIM_REG(SFR_EECON1)
+#define EECON2                  SIM_REG(SFR_EECON2)
+
+// STATUS
+#define nPD                     SIM_BIT(SFR_STATUS, 3)
+#define nTO                     SIM_BIT(SFR_STATUS, 4)
+
+// PORTA
+#define RA0                     SIM_BIT(SFR_PORTA, 0)
+#define RA1                     SIM_BIT(SFR_PORTA, 1)
+#define RA2                     SIM_BIT(SFR_PORTA, 2)
+#define RA3                     SIM_BIT(SFR_PORTA, 3)
+#define RA4                     SIM_BIT(SFR_PORTA, 4)
+#define RA5                     SIM_BIT(SFR_PORTA, 5)
+
+// PORTC
+#define RC0                     SIM_BIT(SFR_PORTC, 0)
+#define RC1                     SIM_BIT(SFR_PORTC, 1)
+#define RC2                     SIM_BIT(SFR_PORTC, 2)
+#define RC3                     SIM_BIT(SFR_PORTC, 3)
+#define RC4                     SIM_BIT(SFR_PORTC, 4)
+#define RC5                     SIM_BIT(SFR_PORTC, 5)
+
+// INTCON
+#define RAIF                    SIM_BIT(SFR_INTCON, 0)
+#define INTF                    SIM_BIT(SFR_INTCON, 1)
+#define T0IF                    SIM_BIT(SFR_INTCON, 2)
+#define TMR0IF                  SIM_BIT(SFR_INTCON, 2)
+#define RAIE                    SIM_BIT(SFR_INTCON, 3)
+#define INTE                    SIM_BIT(SFR_INTCON, 4)
+#define T0IE                    SIM_BIT(SFR_INTCON, 5)
+#define TMR0IE                  SIM_BIT(SFR_INTCON, 5)
+#define PEIE                    SIM_BIT(SFR_INTCON, 6)
+#define GIE                     SIM_BIT(SFR_INTCON, 7)
+
+// PIR1
+#define TMR1IF                  SIM_BIT(SFR_PIR1, 0)
+#define TMR2IF                  SIM_BIT(SFR_PIR1, 1)
+#define OSFIF                   SIM_BIT(SFR_PIR1, 2)
+#define C1IF                    SIM_BIT(SFR_PIR1, 3)
+#define C2IF                    SIM_BIT(SFR_PIR1, 4)
+#define CCP1IF                  SIM_BIT(SFR_PIR1, 5)
+#define ADIF                    SIM_BIT(SFR_PIR1, 6)
+#define EEIF                    SIM_BIT(SFR_PIR1, 7)
+
+// PIE1
+#define TMR1IE                  SIM_BIT(SFR_PIE1, 0)
+#define TMR2IE                  SIM_BIT(SFR_PIE1, 1)
+#define OSFIE                   SIM_BIT(SFR_PIE1, 2)
+#define C1IE                    SIM_BIT(SFR_PIE1, 3)
+#define C2IE                    SIM_BIT(SFR_PIE1, 4)
+#define CCP1IE                  SIM_BIT(SFR_PIE1, 5)
+#define ADIE                    SIM_BIT(SFR_PIE1, 6)
+#define EEIE                    SIM_BIT(SFR_PIE1, 7)
+
+// T1CON
+#define TMR1ON                  SIM_BIT(SFR_T1CON, 0)
+#define TMR1CS                  SIM_BIT(SFR_T1CON, 1)
+
+// T2CON
+#define TMR2ON                  SIM_BIT(SFR_T2CON, 2)
+
+// PWM1CON
+#define PRSEN                   SIM_BIT(SFR_PWM1CON, 7)
+
+// ECCPAS
+#define ECCPASE                 SIM_BIT(SFR_ECCPAS, 7)
+
+// WDTCON
+#define SWDTEN                  SIM_BIT(SFR_WDTCON, 0)
+
+// OPTION_REG
+#define PSA                     SIM_BIT(SFR_OPTION_REG, 3)
+#define T0CS                    SIM_BIT(SFR_OPTION_REG, 5)
+#define INTEDG                  SIM_BIT(SFR_OPTION_REG, 6)
+
+// TRISC
+#define TRISC4                  SIM_BIT(SFR_TRISC, 4)
+#define TRISC5                  SIM_BIT(SFR_TRISC, 5)
+
+// OSCCON
+#define HTS                     SIM_BIT(SFR_OSCCON, 2)
+#define LTS                     SIM_BIT(SFR_OSCCON, 1)
+
+// IOCA
+#define IOCA2                   SIM_BIT(SFR_IOCA, 2)
+#define IOCA3                   SIM_BIT(SFR_IOCA, 3)
+#define IOCA4                   SIM_BIT(SFR_IOCA, 4)
+#define IOCA5                   SIM_BIT(SFR_IOCA, 5)
+
+// EECON1
+#define RD                      SIM_BIT(SFR_EECON1, 0)
+#define WR                      SIM_BIT(SFR_EECON1, 1)
+#define WREN                    SIM_BIT(SFR_EECON1, 2)
+#define WRERR                   SIM_BIT(SFR_EECON1, 3)
+
+#endif	/* SIM_XC_H */
@@ -0,0 +1,139 @@
+/**
+ * File:   sweep.c
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ */
+
+#include <xc.h>
+#include "types.h"
+#include "generator.h"
+#include "sweep.h"
+
+typedef struct {
+    uint8_t state : 2;          // sweep_state_t
+    // nHALT stopped the generator in the sweep - the auto mode restarts
+    // on lastGood once nHALT is high again
+    uint8_t haltRestart : 1;
+} sweep_flags_t;
+
+static sweep_flags_t sweepFlags = {SWEEP_IDLE, FALSE};
+static uint8_t sweepStep = 0;
+static uint8_t lastGood = SWEEP_NONE;
+static uint16_t dwell = 1;
+// ticks left on sweepStep
+static uint16_t dwellLeft = 0;
+
+/**
+ * The auto mode runs from the current step, it is the first one swept
+ * @param dwellTicks
+ */
+void sweep_start(uint16_t dwellTicks)
+{
+    dwell = dwellTicks ? dwellTicks : 1;
+    dwellLeft = dwell;
+    lastGood = SWEEP_NONE;
+    sweepFlags.haltRestart = FALSE;
+    generator_setAutoMode();
+    sweepStep = generator_getFrequency();
+    sweepFlags.state = SWEEP_RUNNING;
+}
+
+/**
+ * Called from the main loop when nHALT stopped the generator
+ */
+void sweep_halted(void)
+{
+    if (sweepFlags.state == SWEEP_RUNNING) {
+        sweepFlags.haltRestart = TRUE;
+    }
+}
+
+/**
+ * A held or stopped generator and a step or mode changed by anyone else
+ * fail the step. Otherwise the step passes once its dwell ran out and
+ * the next one is selected, the table end passes the sweep. After an
+ * nHALT stop the auto mode restarts on the last good step when RA2 is
+ * high, unless the operator took over in the meantime.
+ * @return uint8_t
+ */
+uint8_t sweep_tick(void)
+{
+    if (sweepFlags.state != SWEEP_RUNNING) {
+        if (sweepFlags.haltRestart && RA2) {
+            sweepFlags.haltRestart = FALSE;
+            if (generator_getMode() == GEN_MODE_MANUAL
+                && generator_getState() == GEN_STATE_MANUAL_LOW
+                && generator_getFrequency() == lastGood
+            ) {
+                generator_setAutoMode();
+            }
+        }
+        return FALSE;
+    }
+
+    if (generator_isHeld()
+        || generator_getMode() != GEN_MODE_AUTO
+        || generator_getFrequency() != sweepStep
+    ) {
+        // a stopped generator keeps the step for the next auto mode,
+        // a held one switches to it when nHALT rises
+        if (lastGood != SWEEP_NONE) {
+            generator_setFrequency(lastGood);
+        } else {
+            sweepFlags.haltRestart = FALSE;
+        }
+        sweepFlags.state = SWEEP_FAILED;
+        return TRUE;
+    }
+
+    if (--dwellLeft) {
+        return FALSE;
+    }
+    lastGood = sweepStep;
+    generator_setFrequency(sweepStep + 1);
+    if (generator_getFrequency() == sweepStep) {
+        // no step above
+        sweepFlags.state = SWEEP_PASSED;
+        return TRUE;
+    }
+    sweepStep++;
+    dwellLeft = dwell;
+    return FALSE;
+}
+
+/**
+ *
+ * @return sweep_state_t
+ */
+sweep_state_t sweep_getState(void)
+{
+    return (sweep_state_t)sweepFlags.state;
+}
+
+/**
+ *
+ * @return uint8_t
+ */
+uint8_t sweep_getStep(void)
+{
+    return sweepStep;
+}
+
+/**
+ *
+ * @return uint8_t
+ */
+uint8_t sweep_getLastGood(void)
+{
+    return lastGood;
+}
+
+/**
+ * No sweep running and no restart waiting for nHALT
+ * @return uint8_t
+ */
+uint8_t sweep_isIdle(void)
+{
+    return sweepFlags.state != SWEEP_RUNNING && !sweepFlags.haltRestart;
+}
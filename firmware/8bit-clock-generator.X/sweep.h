@@ -0,0 +1,89 @@
+/*
+ * File:   sweep.h
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ *
+ * Frequency sweep for qualifying a target board: the auto mode steps up
+ * the frequency table from the current step, dwelling the same number of
+ * button ticks on each one.
+ *
+ * The sweep fails as soon as the target pulls nHALT LOW (held or stopped
+ * generator) or the operator takes over - a button, a serial command or
+ * any other change of the mode or the step. It then selects the last step
+ * that ran its whole dwell, the one below the failed step, and ends. A
+ * generator stopped by nHALT restarts the auto mode on that step once
+ * nHALT is high again. It passes when the last step of the table ran its
+ * dwell and keeps it.
+ *
+ * The steps are the ones of frequencies.h - the engines are prepared from
+ * the table, there is no finer setting in between.
+ */
+
+#ifndef SWEEP_H
+#define	SWEEP_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+// no step ran its dwell
+#define SWEEP_NONE                  0xFF
+
+typedef enum {
+    SWEEP_IDLE = 0,             // no sweep since power-on
+    SWEEP_RUNNING,
+    SWEEP_PASSED,
+    SWEEP_FAILED
+} sweep_state_t;
+
+/**
+ * Start a sweep in the auto mode from the current step
+ * @param dwellTicks button ticks (32.768 ms) on each step, at least 1
+ */
+void sweep_start(uint16_t dwellTicks);
+
+/**
+ * nHALT stopped the generator, called from the main loop before the next
+ * sweep_tick()
+ */
+void sweep_halted(void);
+
+/**
+ * Check the running sweep and move it on, called at the TMR0 tick rate
+ * after the buttons
+ * @return TRUE when the sweep ended at this tick
+ */
+uint8_t sweep_tick(void);
+
+/**
+ *
+ * @return sweep_state_t
+ */
+sweep_state_t sweep_getState(void);
+
+/**
+ * Step running, or the one the sweep ended at
+ * @return uint8_t
+ */
+uint8_t sweep_getStep(void);
+
+/**
+ * Last step that ran its whole dwell
+ * @return uint8_t, SWEEP_NONE when none did
+ */
+uint8_t sweep_getLastGood(void);
+
+/**
+ * No sweep running and no restart waiting for nHALT to rise - the core
+ * may SLEEP, the rising edge does not wake it
+ * @return uint8_t
+ */
+uint8_t sweep_isIdle(void);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SWEEP_H */
@@ -0,0 +1,456 @@
+/*
+ * File:   freqtable.c
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ *
+ * Generates frequencies.h - the register setup of every frequency step.
+ *
+ *   freqtable [-f fosc] [-d default] [frequency ...]
+ *
+ *   -f     oscillator frequency in Hz (default 8000000, INTOSC)
+ *   -d     power-on frequency (default 2)
+ *
+ * Without frequencies the 1-2-5 ladder from 10 mHz to 2 MHz is used.
+ * The header goes to stdout, the accuracy report to stderr:
+ *
+ *   freqtable > ../frequencies.h
+ *
+ * Steps the PWM (TMR2 + CCP1) can not reach are generated with TMR1 and
+ * the CCP1 compare match (slow engine), these have to come first. A slow
+ * half period is up to COMPARE_CHUNKS_MAX compare matches (a 16-bit
+ * postscaler), the period has to fit 32 bits of Tosc - about 9 minutes
+ * at 8 MHz.
+ *
+ * A step no exact register setting can hit (e.g. 115200 Hz from 8 MHz) is
+ * dithered: a 16-bit phase accumulator adds a fraction of a timer tick per
+ * compare match (slow) or per group of PWM periods (fast, PR2 alternates
+ * between two neighbouring values). The long-run average is within the
+ * reported error, single periods differ by one timer tick (the jitter).
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STEPS_MAX               64
+
+// the CCP1 interrupt has to be done before the next compare match
+#define COMPARE_STEP_MIN_TCY    256
+// compare matches per half period, a duty cycle other than 50 % may take
+// twice as many (generator.c _prepareHalf)
+#define COMPARE_CHUNKS_MAX      32767
+// the firmware reports high and low time in Tosc, 32 bits
+#define SLOW_PERIOD_MAX_TOSC    4294967295.0
+
+// LEDs follow the output up to this frequency, above they just light
+#define BLINK_MAX_HZ            10.0
+
+// steps with a larger error are dithered
+#define DITHER_ABOVE_PPM        1.0
+
+// TMR2 interrupt period needed by the dithering ISR
+#define DITHER_GROUP_MIN_TCY    256
+// shortest PWM period which can be dithered (TMR2 ticks)
+#define DITHER_PERIOD_MIN       16
+
+typedef struct {
+    double targetHz;
+    double actualHz;
+    char name[16];
+    int slow;
+
+    // slow engine
+    unsigned t1Prescaler;
+    unsigned compareStep;
+    unsigned compareChunks;
+
+    // fast engine
+    unsigned t2Prescaler;
+    unsigned t2Postscaler;
+    unsigned period;            // PR2 + 1
+
+    // dithering, 1/65536 of a TMR1 / TMR2 tick
+    unsigned fraction;
+    double jitterS;             // worst case cycle-to-cycle
+} step_t;
+
+static const double ladder[] = {
+    0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1, 2, 5, 10, 20, 50, 100, 200, 500,
+    1e3, 2e3, 5e3, 10e3, 20e3, 50e3, 100e3, 200e3, 500e3, 1e6, 2e6
+};
+
+static const unsigned t1Prescalers[] = {1, 2, 4, 8};
+static const unsigned t2Prescalers[] = {1, 4, 16};
+
+
+/**
+ * Step name used for the enum - 500mHz, 2Hz, 10KHz, 1MHz
+ */
+static void _name(double hz, char * name, size_t size)
+{
+    if (hz < 1.0) {
+        snprintf(name, size, "%gmHz", hz * 1e3);
+    } else if (hz < 1e3) {
+        snprintf(name, size, "%gHz", hz);
+    } else if (hz < 1e6) {
+        snprintf(name, size, "%gKHz", hz / 1e3);
+    } else {
+        snprintf(name, size, "%gMHz", hz / 1e6);
+    }
+    // fractional values (e.g. 1.5KHz) become 1_5KHz
+    for (char * c = name; *c; c++) {
+        if (*c == '.') {
+            *c = '_';
+        }
+    }
+}
+
+/**
+ * PWM: f = Fcy / (prescaler * (PR2 + 1)), the closest match wins,
+ * on a tie the smaller prescaler (better duty cycle resolution)
+ */
+static int _fitFast(step_t * step, double fcy)
+{
+    double bestError = INFINITY;
+
+    for (size_t i = 0; i < sizeof(t2Prescalers) / sizeof(t2Prescalers[0]); i++) {
+        unsigned prescaler = t2Prescalers[i];
+        double ticks = fcy / (prescaler * step->targetHz);
+        unsigned period = (unsigned)lround(ticks);
+
+        if (period < 1 || period > 256) {
+            continue;
+        }
+        double actual = fcy / (prescaler * period);
+        double error = fabs(actual - step->targetHz);
+        if (error < bestError) {
+            bestError = error;
+            step->t2Prescaler = prescaler;
+            step->period = period;
+            step->actualHz = actual;
+        }
+    }
+    if (isinf(bestError)) {
+        return -1;
+    }
+    step->t2Postscaler = 16;
+    step->fraction = 0;
+    step->jitterS = 0.0;
+    step->slow = 0;
+    return 0;
+}
+
+/**
+ * Dithered PWM: the period alternates between PR2 + 1 and PR2 + 2 ticks,
+ * the TMR2 interrupt (every postscaler periods) picks the next one
+ */
+static int _fitFastDithered(step_t * step, double fcy)
+{
+    for (size_t i = 0; i < sizeof(t2Prescalers) / sizeof(t2Prescalers[0]); i++) {
+        unsigned prescaler = t2Prescalers[i];
+        double ticks = fcy / (prescaler * step->targetHz);
+        unsigned period = (unsigned)ticks;
+        unsigned fraction = (unsigned)lround((ticks - period) * 65536.0);
+
+        if (fraction == 65536) {
+            period++;
+            fraction = 0;
+        }
+        if (period < DITHER_PERIOD_MIN || period + 1 > 256) {
+            continue;
+        }
+        unsigned postscaler = (DITHER_GROUP_MIN_TCY + period * prescaler - 1) / (period * prescaler);
+        if (postscaler > 16) {
+            postscaler = 16;
+        }
+        step->t2Prescaler = prescaler;
+        step->t2Postscaler = postscaler;
+        step->period = period;
+        step->fraction = fraction;
+        step->actualHz = fcy / (prescaler * (period + fraction / 65536.0));
+        step->jitterS = fraction ? prescaler / fcy : 0.0;
+        step->slow = 0;
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * TMR1 + compare: half period = prescaler * compareStep * compareChunks,
+ * the closest match wins, then the fewest interrupts, then the smaller
+ * prescaler
+ */
+static int _fitSlow(step_t * step, double fcy)
+{
+    double bestError = INFINITY;
+    double halfTicks = fcy / (2.0 * step->targetHz);
+
+    if (halfTicks * 8.0 > SLOW_PERIOD_MAX_TOSC) {
+        return -1;
+    }
+    for (size_t i = 0; i < sizeof(t1Prescalers) / sizeof(t1Prescalers[0]); i++) {
+        unsigned prescaler = t1Prescalers[i];
+
+        for (unsigned chunks = 1; chunks <= COMPARE_CHUNKS_MAX; chunks++) {
+            double ticks = halfTicks / (prescaler * chunks);
+            unsigned compareStep = (unsigned)lround(ticks);
+
+            if (compareStep > 0xFFFF) {
+                continue;
+            }
+            if (compareStep * prescaler < COMPARE_STEP_MIN_TCY) {
+                break;
+            }
+            double actual = fcy / (2.0 * prescaler * compareStep * chunks);
+            double error = fabs(actual - step->targetHz);
+            if (error < bestError
+                || (error == bestError && chunks < step->compareChunks)
+            ) {
+                bestError = error;
+                step->t1Prescaler = prescaler;
+                step->compareStep = compareStep;
+                step->compareChunks = chunks;
+                step->actualHz = actual;
+            }
+        }
+    }
+    if (isinf(bestError)) {
+        return -1;
+    }
+    step->fraction = 0;
+    step->jitterS = 0.0;
+    step->slow = 1;
+    return 0;
+}
+
+/**
+ * Dithered compare: every compare match advances CCPR1 by compareStep
+ * plus the carry of the phase accumulator. TMR1 runs at 1:1 for the
+ * lowest jitter, the fewest chunks which fit the 16-bit step are used.
+ */
+static int _fitSlowDithered(step_t * step, double fcy)
+{
+    double halfTicks = fcy / (2.0 * step->targetHz);
+    unsigned chunks = (unsigned)ceil(halfTicks / 65535.0);
+
+    if (chunks > COMPARE_CHUNKS_MAX) {
+        return -1;
+    }
+    double ticks = halfTicks / chunks;
+    unsigned compareStep = (unsigned)ticks;
+    unsigned fraction = (unsigned)lround((ticks - compareStep) * 65536.0);
+
+    if (fraction == 65536) {
+        compareStep++;
+        fraction = 0;
+    }
+    if (compareStep < COMPARE_STEP_MIN_TCY) {
+        return -1;
+    }
+    step->t1Prescaler = 1;
+    step->compareStep = compareStep;
+    step->compareChunks = chunks;
+    step->fraction = fraction;
+    step->actualHz = fcy / (2.0 * chunks * (compareStep + fraction / 65536.0));
+    step->jitterS = fraction ? 1.0 / fcy : 0.0;
+    step->slow = 1;
+    return 0;
+}
+
+static double _errorPpm(const step_t * step)
+{
+    return 1e6 * (step->actualHz - step->targetHz) / step->targetHz;
+}
+
+static unsigned _prescalerBits(unsigned prescaler)
+{
+    unsigned bits = 0;
+
+    while ((1u << bits) < prescaler) {
+        bits++;
+    }
+    return bits;
+}
+
+static void _usage(void)
+{
+    fprintf(stderr, "usage: freqtable [-f fosc] [-d default] [frequency ...]\n");
+    exit(2);
+}
+
+int main(int argc, char * argv[])
+{
+    step_t steps[STEPS_MAX];
+    size_t count = 0;
+    double fosc = 8e6;
+    double defaultHz = 2.0;
+    size_t defaultStep = 0;
+    size_t slowLast = 0;
+    size_t blinkLast = 0;
+    int haveSlow = 0;
+    int i;
+
+    memset(steps, 0, sizeof(steps));
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            fosc = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            defaultHz = strtod(argv[++i], NULL);
+        } else if (argv[i][0] == '-' || count == STEPS_MAX) {
+            _usage();
+        } else {
+            steps[count++].targetHz = strtod(argv[i], NULL);
+        }
+    }
+    if (count == 0) {
+        for (count = 0; count < sizeof(ladder) / sizeof(ladder[0]); count++) {
+            steps[count].targetHz = ladder[count];
+        }
+    }
+
+    double fcy = fosc / 4.0;
+    for (size_t n = 0; n < count; n++) {
+        step_t * step = &steps[n];
+
+        if (step->targetHz <= 0.0 || (n > 0 && step->targetHz <= steps[n - 1].targetHz)) {
+            fprintf(stderr, "frequencies have to be positive and ascending\n");
+            return 1;
+        }
+        _name(step->targetHz, step->name, sizeof(step->name));
+
+        // a step is slow only if the PWM can not do it
+        if (_fitFast(step, fcy) != 0 && _fitSlow(step, fcy) != 0) {
+            fprintf(stderr, "%s: can not be generated\n", step->name);
+            return 1;
+        }
+        if (fabs(_errorPpm(step)) > DITHER_ABOVE_PPM) {
+            step_t dithered = *step;
+            int fitted = step->slow
+                ? _fitSlowDithered(&dithered, fcy)
+                : _fitFastDithered(&dithered, fcy);
+            if (fitted == 0 && fabs(_errorPpm(&dithered)) < fabs(_errorPpm(step))) {
+                *step = dithered;
+            }
+        }
+        if (step->slow) {
+            if (n > 0 && !steps[n - 1].slow) {
+                fprintf(stderr, "%s: slow steps have to come first\n", step->name);
+                return 1;
+            }
+            slowLast = n;
+            haveSlow = 1;
+        }
+        if (step->targetHz <= BLINK_MAX_HZ) {
+            blinkLast = n;
+        }
+        if (fabs(step->targetHz - defaultHz) < 1e-9 * defaultHz) {
+            defaultStep = n;
+        }
+    }
+    if (!haveSlow) {
+        fprintf(stderr, "at least the first step has to use the slow engine\n");
+        return 1;
+    }
+
+    // report
+    fprintf(stderr, "%-8s %14s %18s %12s %11s  %s\n",
+        "step", "target Hz", "actual Hz", "error ppm", "jitter ns", "setup");
+    printf("/*\n");
+    printf(" * File:   frequencies.h\n");
+    printf(" *\n");
+    printf(" * Generated by tools/freqtable.c for FOSC %.0f Hz, do not edit.\n", fosc);
+    printf(" * Regenerate with \"make frequencies\".\n");
+    printf(" *\n");
+    printf(" * step     %14s %18s %12s %11s  setup\n",
+        "target Hz", "actual Hz", "error ppm", "jitter ns");
+
+    for (size_t n = 0; n < count; n++) {
+        step_t * step = &steps[n];
+        double ppm = _errorPpm(step);
+        double jitterNs = step->jitterS * 1e9;
+        char setup[80];
+        int length;
+
+        if (step->slow) {
+            length = snprintf(setup, sizeof(setup), "TMR1 1:%u, %u x %u", step->t1Prescaler,
+                step->compareStep, step->compareChunks);
+        } else {
+            length = snprintf(setup, sizeof(setup), "TMR2 1:%u, PR2 %u", step->t2Prescaler,
+                step->period - 1);
+        }
+        if (step->fraction) {
+            snprintf(setup + length, sizeof(setup) - (size_t)length, ", +%u/65536%s",
+                step->fraction, step->slow ? "" : " per period");
+        }
+        fprintf(stderr, "%-8s %14.3f %18.6f %12.2f %11.0f  %s\n",
+            step->name, step->targetHz, step->actualHz, ppm, jitterNs, setup);
+        printf(" * %-8s %14.3f %18.6f %12.2f %11.0f  %s\n",
+            step->name, step->targetHz, step->actualHz, ppm, jitterNs, setup);
+    }
+    printf(" */\n\n");
+
+    printf("#ifndef FREQUENCIES_H\n");
+    printf("#define\tFREQUENCIES_H\n\n");
+    printf("#include <stdint.h>\n\n");
+    printf("#ifdef\t__cplusplus\nextern \"C\" {\n#endif\n\n");
+
+    printf("typedef enum {\n");
+    for (size_t n = 0; n < count; n++) {
+        printf("    FREQ_%s%s\n", steps[n].name, n + 1 < count ? "," : "");
+    }
+    printf("} frequency_value_t;\n\n");
+
+    printf("#define FREQ_COUNT              %zu\n", count);
+    printf("#define FREQ_DEFAULT            FREQ_%s\n", steps[defaultStep].name);
+    printf("// last step generated by TMR1 + CCP1 compare, the rest is PWM\n");
+    printf("#define FREQ_SLOW_LAST          FREQ_%s\n", steps[slowLast].name);
+    printf("// last step the LEDs follow the output\n");
+    printf("#define FREQ_BLINK_LAST         FREQ_%s\n\n", steps[blinkLast].name);
+
+    printf("// target frequencies and names, for the host tools\n");
+    printf("#define FREQ_TARGETS_HZ         {");
+    for (size_t n = 0; n < count; n++) {
+        printf("%s%.10g", n ? ", " : "", steps[n].targetHz);
+    }
+    printf("}\n");
+    printf("#define FREQ_NAMES              {");
+    for (size_t n = 0; n < count; n++) {
+        printf("%s\"%s\"", n ? ", " : "", steps[n].name);
+    }
+    printf("}\n\n");
+
+    printf("typedef struct {\n");
+    printf("    uint8_t timerControl;       // T1CON (slow) / T2CON (fast)\n");
+    printf("    uint8_t period;             // PR2\n");
+    printf("    uint16_t compareStep;       // TMR1 ticks between compare matches\n");
+    printf("    uint16_t compareChunks;     // compare matches per half period\n");
+    printf("    uint16_t fraction;          // dithering, 1/65536 TMR1 / TMR2 tick, 0 - exact\n");
+    printf("} frequency_setup_t;\n\n");
+
+    printf("static const frequency_setup_t frequencyTable[FREQ_COUNT] = {\n");
+    for (size_t n = 0; n < count; n++) {
+        step_t * step = &steps[n];
+
+        if (step->slow) {
+            // TMR1ON, T1CKPS
+            unsigned t1con = 0x01 | (_prescalerBits(step->t1Prescaler) << 4);
+            printf("    {0x%02X, 0x00, %5u, %3u, %5u},     // %s\n",
+                t1con, step->compareStep, step->compareChunks, step->fraction, step->name);
+        } else {
+            // TOUTPS, TMR2ON, T2CKPS
+            unsigned t2con = ((step->t2Postscaler - 1) << 3) | 0x04
+                | (_prescalerBits(step->t2Prescaler) >> 1);
+            printf("    {0x%02X, 0x%02X, %5u, %3u, %5u},     // %s\n",
+                t2con, step->period - 1, 0, 0, step->fraction, step->name);
+        }
+    }
+    printf("};\n\n");
+
+    printf("#ifdef\t__cplusplus\n}\n#endif\n\n");
+    printf("#endif\t/* FREQUENCIES_H */\n");
+
+    return 0;
+}
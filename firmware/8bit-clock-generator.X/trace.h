@@ -0,0 +1,76 @@
+/* 
+ * File:   trace.h
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ *
+ * Optional instrumentation, compiled in only with GENERATOR_TRACE defined.
+ *
+ * RC4 (unused otherwise) is HIGH while an ISR() branch runs. Inside a
+ * branch, the generator callback is marked by a LOW pulse on RC4, so a
+ * logic analyzer shows the branch and the callback cost separately.
+ *
+ * traceStats[] keeps the maximum and a running average per ISR branch in
+ * instruction cycles, timed with TMR1 (only while the generator runs it,
+ * the prescaler is taken into account), and the main loop backlog - the
+ * time from the TMR0 overflow to the button scan - in TMR0 counts
+ * (256 cycles, the scan forced after SLEEP included). Read it with the
+ * debugger.
+ *
+ * The trace adds cycles to every ISR branch, the fast burst length is not
+ * exact in a trace build.
+ */
+
+#ifndef TRACE_H
+#define	TRACE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#ifdef GENERATOR_TRACE
+
+#define TRACE_PIN_MASK          0b00010000      // RC4 in PORTC
+
+typedef enum {
+    TRACE_INT = 0,
+    TRACE_TMR1,
+    TRACE_CCP1,
+    TRACE_TMR2,
+    TRACE_TMR0,
+    TRACE_SERIAL,               // RA1 start bit and the TMR0 bit clock
+    TRACE_MAIN,                 // main loop backlog, TMR0 counts
+    TRACE_COUNT
+} trace_slot_t;
+
+typedef struct {
+    uint16_t max;
+    uint16_t avg;               // avg += (sample - avg) / 8
+} trace_stat_t;
+
+extern trace_stat_t traceStats[TRACE_COUNT];
+
+void trace_begin(void);
+void trace_mark(void);
+void trace_end(trace_slot_t slot);
+void trace_backlog(void);
+
+#define TRACE_BEGIN()           trace_begin()
+#define TRACE_MARK()            trace_mark()
+#define TRACE_END(slot)         trace_end(slot)
+#define TRACE_BACKLOG()         trace_backlog()
+
+#else
+
+#define TRACE_BEGIN()
+#define TRACE_MARK()
+#define TRACE_END(slot)
+#define TRACE_BACKLOG()
+
+#endif
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TRACE_H */
@@ -0,0 +1,333 @@
+/**
+ * File:   uart.c
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ */
+
+#include <xc.h>
+#include <stddef.h>
+#include "types.h"
+#include "uart.h"
+#include "interrupts.h"
+#include "hardware.h"
+
+// 8 MHz / 4 / 38400 = 52.08 instruction cycles per bit, TMR0 at 1:2. The
+// reload is added to TMR0, so the counts since the overflow are kept.
+#define UART_BIT_TCY                52
+#define UART_BIT_RELOAD             (uint8_t)(256 - UART_BIT_TCY / 2)
+// TMR0 written right after the TX start bit edge, the next overflow one
+// bit later - the interrupt latency up to the write is taken off, measured
+// with the simulator
+#define UART_FRAME_RELOAD           (uint8_t)(UART_BIT_RELOAD + 14)
+// TMR0 at the start edge, the first overflow is the middle of bit 0. The
+// interrupt latency of the edge and of the sample is taken off, measured
+// with the simulator: the middle of the reloads that still receive a
+// sender 2 % off - check with a logic analyzer after a compiler change.
+#define UART_START_RELOAD           (uint8_t)(256 - 6)
+// TMR0 counts added after the last data bit, the next overflow is in the
+// middle of a start bit right after the stop bit
+#define UART_STOP_SKIP              (uint8_t)(UART_BIT_TCY * 3 / 4)
+// TMR0 when the start edge of a character right after the stop bit is
+// served in time, measured with the simulator. The entry of the last data
+// bit runs the interrupts held over the frame and delays the mismatch of
+// the stop bit, it may be served after the start edge - no earlier than
+// this. A start edge of a faster sender comes up to 5 counts earlier.
+#define UART_HUNT_START             (uint8_t)(UART_START_RELOAD + 4)
+// bit times after the stop bit the line has to stay idle before the
+// peripheral interrupts run again
+#define UART_HUNT_BITS              2
+
+#define UART_LINE_SIZE              8
+#define UART_TX_SIZE                4           // power of 2
+
+// OPTION_REG PS - TMR0 prescaler
+#define OPTION_PS_MASK              0b00000111  // 1:256 - button tick, 000 - 1:2 bit clock
+
+typedef enum {
+    UART_IDLE,
+    UART_TX,
+    UART_RX,
+    UART_HUNT                   // after the data bits, waiting for the next start bit
+} uart_mode_t;
+
+__near volatile uart_flags_t uartFlags;
+static uint8_t uartBit = 0;
+static uint8_t rxShift = 0;
+// button tick time elapsed while TMR0 is the bit clock, in Tcy
+static uint16_t uartTick = 0;
+
+// start bit, 8 data bits, stop bit - LSB first. The character at txTail
+// is shifted out in place and leaves the queue with its stop bit.
+static char txBuffer[UART_TX_SIZE];
+static volatile uint8_t txHead = 0;
+static volatile uint8_t txTail = 0;
+
+// received line, stored by the interrupt. Characters are dropped while
+// the main loop holds a line (uartFlags.ready).
+static char rxLine[UART_LINE_SIZE];
+static volatile uint8_t rxLength = 0;
+
+static const uint32_t powersOf10[] = {
+    1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10
+};
+
+static void _tick(void);
+static void _clockStart(void);
+static void _clockStop(void);
+static void _listen(void);
+
+/**
+ * One bit time of the button tick, TMR0 overflows every 256 * 256 Tcy
+ */
+static void _tick(void)
+{
+    uartTick += UART_BIT_TCY;
+    if (uartTick < UART_BIT_TCY) {
+        INTERRUPT_RAISE(EVENT_TICK);
+    }
+}
+
+/**
+ * TMR0 from the button tick to the bit clock, the tick continues in uartTick
+ */
+static void _clockStart(void)
+{
+    uartTick = (uint16_t)TMR0 << 8;
+    if (T0IF) {
+        INTERRUPT_RAISE(EVENT_TICK);
+    }
+    OPTION_REG &= (uint8_t)~OPTION_PS_MASK;
+    uartFlags.clocked = TRUE;
+}
+
+/**
+ * TMR0 back to the button tick, at the phase the tick has reached
+ */
+static void _clockStop(void)
+{
+    OPTION_REG |= OPTION_PS_MASK;
+    TMR0 = (uint8_t)(uartTick >> 8);
+    T0IF = 0;
+    uartFlags.clocked = FALSE;
+    uartFlags.mode = UART_IDLE;
+}
+
+/**
+ * Next start bit on RA1 raises RAIF
+ */
+static void _listen(void)
+{
+    (void)PORTA;                // end the mismatch of the last edges
+    RAIF = 0;
+    RAIE = 1;
+}
+
+/**
+ * Start bit edge on RA1 (called from the ISR). Button changes raise RAIF
+ * as well, only a low RA1 starts a frame. No frame starts during a fast
+ * burst, TMR0 and the TMR1 interrupt belong to it, or below 8 MHz.
+ */
+inline void uart_edgeCallback(uint8_t port)
+{
+    RAIF = 0;
+    if ((port & UART_RX_MASK) || uartFlags.paused || TMR1IE || !T0IE || hardwareClockShift) {
+        return;
+    }
+    if (!uartFlags.clocked) {
+        _clockStart();
+    }
+    if (uartFlags.mode == UART_HUNT && uartBit == 0 && (int8_t)(TMR0 - UART_HUNT_START) < 0) {
+        // the mismatch of the stop bit was served after the start edge -
+        // the frame follows the stop bit
+        TMR0 = (uint8_t)(TMR0 - UART_HUNT_START + UART_START_RELOAD);
+    } else {
+        TMR0 = UART_START_RELOAD;
+    }
+    T0IF = 0;
+    PEIE = 0;
+    RAIE = 0;
+    uartFlags.mode = UART_RX;
+    uartBit = 0;
+}
+
+/**
+ * One bit time (called from the ISR). RX samples RA1 and TX sets RA0
+ * first, the bit clock is reloaded relative to the overflow, so the
+ * interrupt latency does not add up.
+ * @return TRUE when the peripheral interrupts are served in this entry -
+ *      PEIE, or the last data bit of a received character
+ */
+inline uint8_t uart_bitCallback(void)
+{
+    uint8_t level = PORTA & UART_RX_MASK;
+
+    if (uartFlags.mode == UART_TX && uartBit == 0) {
+        // start bit, late when a compare interrupt ran in the last stop
+        // bit - the frame is timed from this edge
+        RA0 = 0;
+        TMR0 = UART_FRAME_RELOAD;
+    } else {
+        if (uartFlags.mode == UART_TX) {
+            RA0 = (uartBit > 8) || (txBuffer[txTail] & 0x01);
+        }
+        TMR0 += UART_BIT_RELOAD;
+    }
+    T0IF = 0;
+    _tick();
+
+    if (uartFlags.mode == UART_TX) {
+        if (uartBit == 0) {
+            // start bit - the peripheral interrupts wait for the stop bit
+            PEIE = 0;
+        } else {
+            txBuffer[txTail] = (char)((uint8_t)txBuffer[txTail] >> 1);
+        }
+        if (++uartBit < 10) {
+            return FALSE;
+        }
+        // stop bit - the peripheral interrupts run in it
+        PEIE = 1;
+        txTail = (txTail + 1) & (UART_TX_SIZE - 1);
+        uartBit = 0;
+        if (txHead == txTail) {
+            _clockStop();
+            _listen();
+        }
+    } else if (uartFlags.mode == UART_RX) {
+        rxShift >>= 1;
+        if (level) {
+            rxShift |= 0x80;
+        }
+        if (++uartBit < 8) {
+            return FALSE;
+        }
+        // last data bit - listen for the next start bit and skip the stop
+        // bit, no bit interrupt may run at the next start edge. The edge
+        // reloads TMR0 before the next overflow. The stop bit is not checked.
+        _listen();
+        TMR0 -= UART_STOP_SKIP;
+        _tick();
+        // into the line, no call before the next start edge. A line ends
+        // with CR or LF, one too long is handed over empty.
+        if (!uartFlags.ready) {
+            if (rxShift == '\r' || rxShift == '\n') {
+                if (rxLength != 0) {
+                    rxLine[rxLength < UART_LINE_SIZE ? rxLength : 0] = 0;
+                    uartFlags.ready = TRUE;
+                }
+            } else if (rxLength < UART_LINE_SIZE - 1) {
+                rxLine[rxLength++] = (char)rxShift;
+            } else {
+                rxLength = UART_LINE_SIZE;
+            }
+        }
+        uartFlags.mode = UART_HUNT;
+        uartBit = 0;
+        // the interrupts held since the start bit run in this entry. PEIE
+        // stays clear, one that comes later in the stop bit would serve
+        // the next start edge late.
+        return TRUE;
+    } else {
+        // no start edge in the stop bit
+        if (++uartBit >= UART_HUNT_BITS) {
+            // line idle
+            PEIE = 1;
+            _clockStop();
+        }
+    }
+    return PEIE;
+}
+
+/**
+ * Start sending when the line is idle, nothing is sent during a fast burst
+ */
+void uart_service(void)
+{
+    di();
+    if (uartFlags.mode == UART_IDLE && txHead != txTail && !TMR1IE && T0IE) {
+        _clockStart();
+        RAIE = 0;
+        uartBit = 0;
+        TMR0 = UART_BIT_RELOAD;
+        T0IF = 0;
+        uartFlags.mode = UART_TX;
+    }
+    ei();
+}
+
+char * uart_getLine(void)
+{
+    return uartFlags.ready ? rxLine : NULL;
+}
+
+/**
+ * The length first, the interrupt stores again once the line is released
+ */
+void uart_releaseLine(void)
+{
+    rxLength = 0;
+    uartFlags.ready = FALSE;
+}
+
+void uart_putc(char c)
+{
+    uint8_t head = (txHead + 1) & (UART_TX_SIZE - 1);
+
+    if (hardwareClockShift) {
+        // the port is off below 8 MHz
+        return;
+    }
+    while (head == txTail) {
+        uart_service();
+    }
+    txBuffer[txHead] = c;
+    txHead = head;
+}
+
+void uart_puts(const char * text)
+{
+    while (*text) {
+        uart_putc(*text++);
+    }
+}
+
+/**
+ * Decimal digits by subtraction, there is no divide instruction
+ * @param value
+ */
+void uart_putNumber(uint32_t value)
+{
+    uint8_t started = FALSE;
+
+    for (uint8_t i = 0; i < sizeof(powersOf10) / sizeof(powersOf10[0]); i++) {
+        char digit = '0';
+        while (value >= powersOf10[i]) {
+            value -= powersOf10[i];
+            digit++;
+        }
+        if (started || digit != '0') {
+            uart_putc(digit);
+            started = TRUE;
+        }
+    }
+    uart_putc((char)('0' + value));
+}
+
+void uart_pause(void)
+{
+    uartFlags.paused = TRUE;
+    while (uartFlags.mode != UART_IDLE || txHead != txTail) {
+        uart_service();
+    }
+}
+
+void uart_resume(void)
+{
+    uartFlags.paused = FALSE;
+}
+
+uint8_t uart_isIdle(void)
+{
+    return uartFlags.mode == UART_IDLE && txHead == txTail && !uartFlags.ready;
+}
@@ -0,0 +1,113 @@
+/*
+ * File:   uart.h
+ * Author: krasi.yosifov@gmail.com
+ *
+ * Created on 17.10.2026
+ *
+ * Software UART on the ICSP pins, 38400 baud 8N1, half duplex:
+ * RA0 - TX, RA1 - RX.
+ *
+ * There is no free timer, so TMR0 is taken over as the bit clock while a
+ * frame is on the line and keeps the button tick running in software. A
+ * start bit is found by the interrupt on change of RA1.
+ *
+ * The slow output edges are switched by CCP1 in hardware. Only the ISR
+ * that schedules the next match can collide with a serial bit, it takes
+ * longer than a bit time. So PEIE is cleared over the bit edges of one
+ * character: from the start bit of a sent one to its stop bit, and from
+ * a received start bit to the last data bit. The interrupts held meanwhile
+ * run in the stop bit, the compare interrupt runs late by at most one
+ * character and moves no edge.
+ */
+
+#ifndef UART_H
+#define	UART_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define UART_TX_MASK                0b00000001      // RA0 in PORTA
+#define UART_RX_MASK                0b00000010      // RA1 in PORTA
+
+typedef struct {
+    uint8_t clocked : 1;        // TMR0 runs as the bit clock
+    uint8_t mode : 2;           // sending, receiving or idle
+    uint8_t ready : 1;          // a received line waits for uart_releaseLine()
+    uint8_t paused : 1;         // no frame until uart_resume()
+} uart_flags_t;
+
+// clocked is tested by every ISR entry that gets past the INT, TMR1 and
+// RA branches, __near
+extern __near volatile uart_flags_t uartFlags;
+
+/**
+ * RA1 interrupt on change - a start bit, called from the ISR
+ * @param port PORTA read by the ISR, the mismatch is ended
+ */
+inline void uart_edgeCallback(uint8_t port);
+
+/**
+ * TMR0 overflow while uartFlags.clocked, one bit time, called from the ISR
+ * @return TRUE when the peripheral interrupts are served in this entry
+ */
+inline uint8_t uart_bitCallback(void);
+
+/**
+ * Start sending the queued characters, called from the main loop
+ */
+void uart_service(void);
+
+/**
+ * Received command line without the line end, NULL while there is none.
+ * Characters received before uart_releaseLine() are dropped.
+ */
+char * uart_getLine(void);
+
+/**
+ *
+ */
+void uart_releaseLine(void);
+
+/**
+ * Queue one character, waits while the queue is full. Dropped while the
+ * core runs below 8 MHz.
+ * @param c
+ */
+void uart_putc(char c);
+
+/**
+ *
+ * @param text
+ */
+void uart_puts(const char * text);
+
+/**
+ * Queue a number in decimal
+ * @param value
+ */
+void uart_putNumber(uint32_t value);
+
+/**
+ * Wait until the line is idle and start no frame until uart_resume(),
+ * nothing may hold TMR0 or the peripheral interrupts during a fast burst
+ */
+void uart_pause(void);
+
+/**
+ *
+ */
+void uart_resume(void);
+
+/**
+ * Nothing to send or to receive - the core may SLEEP
+ * @return TRUE when idle
+ */
+uint8_t uart_isIdle(void);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* UART_H */